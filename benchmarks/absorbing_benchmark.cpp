@@ -0,0 +1,172 @@
+#include <iostream>
+#include <print>
+#include <vector>
+#include <string>
+#include <optional>
+#include "crank_nicolson_builder.hpp"
+#include "crank_nicolson_stepper.hpp"
+#include "linear_solvers.hpp"
+#include "absorbing_layer.hpp"
+#include "benchmark_utils.hpp"
+
+// Grid size and time to solution needed to keep wall reflections out of a region of interest, hard Dirichlet walls
+// pushed away by a margin against an absorbing layer just outside the region.
+// The default packet crosses the 151x101 region (6 x 4 at dr = 0.04) and leaves it by the end; every few steps psi over
+// the region is compared to a run on a domain so large that no reflection comes back before the end.
+//      error = max over the samples of |psi - psi_reference| over the region / |psi(0)|
+// Crank-Nicolson with SparseLU, the engine the layer enters the diagonal of.
+// Usage: absorbing_benchmark [steps] [precision single|double]
+
+constexpr Grid REGION{151, 101};
+constexpr size_t REFERENCE_MARGIN = 150;
+constexpr size_t SAMPLE_EVERY     = 10;
+
+struct Domain
+{
+    std::string name{};
+    size_t margin{};            // cells added on every side of the region
+    AbsorbingLayer layer{};     // within the margin
+};
+
+struct DomainResult
+{
+    size_t Nx{};
+    size_t Ny{};
+    double setup_ms{};
+    double run_ms{};
+    double error{};
+};
+
+template<typename Scalar>
+auto run(const Domain& domain, const VectorX<Scalar>& region_psi0, size_t steps, std::vector<MatrixX<Scalar>>& samples) -> DomainResult
+{
+    DomainResult result{};
+    result.Nx = REGION.Nx + 2*domain.margin;
+    result.Ny = REGION.Ny + 2*domain.margin;
+    const Eigen::Index rows = result.Ny-2;
+    const Eigen::Index cols = result.Nx-2;
+    const Eigen::Index margin = domain.margin;
+    const bool reference = samples.empty();
+
+    Stopwatch watch{};
+    CrankNicolsonCoefficients<Scalar> coeffs{DR};
+    CrankNicolsonBuilder<Scalar> matrix_builder{};
+    StencilOperator<Scalar> stencil_M{result.Nx, result.Ny, coeffs.b0, coeffs.rx, coeffs.ry};
+    matrix_builder.set_num_elements(result.Nx, result.Ny);
+    matrix_builder.set_diagonal_elements(coeffs.a0, coeffs.b0);
+    matrix_builder.set_off_diag_elements(coeffs.rx, coeffs.ry);
+    if (domain.layer.is_enabled())
+    {
+        const Real<Scalar> dt = Real<Scalar>(DR)*Real<Scalar>(DR)/Real<Scalar>(4);
+        const VectorX<Scalar> absorption = (dt/Real<Scalar>(2))*domain.layer.get_potential<Scalar>(result.Nx, result.Ny);
+        matrix_builder.set_absorption(absorption);
+        stencil_M.set_absorption(absorption, domain.layer.thickness);
+    }
+    auto [sparse_A, sparse_M] = matrix_builder.get_sparse_matrices();
+    CrankNicolsonStepper<Scalar> stepper{sparse_A, stencil_M, make_linear_solver<Scalar>(SolverOptions{.solver = SOLVER::SPARSE_LU})};
+    result.setup_ms = watch.elapsed_ms();
+
+    // the region's packet, embedded in the larger domain
+    VectorX<Scalar> psi = VectorX<Scalar>::Zero(rows*cols);
+    Eigen::Map<MatrixX<Scalar>> grid(psi.data(), rows, cols);
+    grid.block(margin, margin, REGION.Ny-2, REGION.Nx-2) = region_psi0.reshaped(REGION.Ny-2, REGION.Nx-2);
+    const double norm0 = region_psi0.norm();
+
+    watch.restart();
+    for (size_t n = 1; n <= steps; n++)
+    {
+        stepper.step(psi);
+        if (n % SAMPLE_EVERY != 0)
+            continue;
+        const auto region = grid.block(margin, margin, REGION.Ny-2, REGION.Nx-2);
+        if (reference)
+            samples.push_back(region);
+        else
+            result.error = std::max(result.error, static_cast<double>((region - samples[n/SAMPLE_EVERY - 1]).norm())/norm0);
+    }
+    result.run_ms = watch.elapsed_ms();
+    return result;
+}
+
+template<typename Scalar>
+void run_domains(size_t steps)
+{
+    const VectorX<Scalar> psi0 = make_initial_packet<Scalar>(REGION.Nx, REGION.Ny);
+
+    // strength 10 v/(thickness dx), v = 2 sin(k dx)/dx the group velocity on the grid:
+    // exp(-20/3) ~ 1e-3 of the amplitude left after crossing the layer twice
+    auto tuned = [](size_t thickness, float factor = 1.f)
+    {
+        const float velocity = 2.f*std::sin(DEFAULT_WAVE_NUMBER*DR)/DR;
+        return AbsorbingLayer{.thickness = thickness, .strength = factor*10.f*velocity/(thickness*DR)};
+    };
+    const std::vector<Domain> domains{
+        {"walls",        0},
+        {"walls",        25},
+        {"walls",        50},
+        {"walls",        100},
+        {"layer",        8,  tuned(8)},
+        {"layer",        16, tuned(16)},
+        {"layer",        24, tuned(24)},
+        {"layer",        32, tuned(32)},
+        {"layer x0.5",   16, tuned(16, 0.5f)},
+        {"layer x2",     16, tuned(16, 2.f)},
+    };
+
+    std::vector<MatrixX<Scalar>> samples{};
+    const DomainResult reference = run(Domain{"reference", REFERENCE_MARGIN}, psi0, steps, samples);
+    std::println("reference: {}x{}, {:.0f}ms", reference.Nx, reference.Ny, reference.setup_ms + reference.run_ms);
+    std::println("{:>12} {:>7} {:>9} {:>10} {:>10} {:>10} {:>10} {:>12}", "domain", "margin", "strength", "grid", "unknowns", "setup[ms]", "total[ms]", "error");
+
+    std::vector<DomainResult> results{};
+    for (const auto& domain : domains)
+    {
+        const DomainResult result = run(domain, psi0, steps, samples);
+        std::println("{:>12} {:>7} {:>9.0f} {:>10} {:>10} {:>10.1f} {:>10.1f} {:>12.3e}", domain.name, domain.margin, domain.layer.strength,
+                     std::to_string(result.Nx) + "x" + std::to_string(result.Ny), (result.Nx-2)*(result.Ny-2), result.setup_ms, result.setup_ms + result.run_ms, result.error);
+        results.push_back(result);
+    }
+
+    // cheapest domain of each kind within a reflection tolerance
+    for (double tolerance : {1e-1, 1e-2, 1e-3})
+    {
+        std::print("tolerance {:.0e}:", tolerance);
+        for (std::string_view kind : {"walls", "layer"})
+        {
+            std::optional<size_t> best{};
+            for (size_t d = 0; d < domains.size(); d++)
+            {
+                const double total = results[d].setup_ms + results[d].run_ms;
+                if (domains[d].name.starts_with(kind) && results[d].error <= tolerance && (!best || total < results[*best].setup_ms + results[*best].run_ms))
+                    best = d;
+            }
+            if (best)
+                std::print("  {} {}x{} in {:.0f}ms", kind, results[*best].Nx, results[*best].Ny, results[*best].setup_ms + results[*best].run_ms);
+            else
+                std::print("  {} none", kind);
+        }
+        std::println("");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t steps    = (argc > 1)? std::stoul(argv[1]) : 700;
+    const bool use_double = (argc > 2) && std::string{argv[2]} == "double";
+
+    flush_denormals();     // as the viewer and the headless runner
+    std::println("{} steps, region {}x{}, {} precision", steps, REGION.Nx, REGION.Ny, use_double? "double" : "single");
+    try
+    {
+        if (use_double)
+            run_domains<std::complex<double>>(steps);
+        else
+            run_domains<std::complex<float>>(steps);
+    }
+    catch(const std::exception& e)
+    {
+        std::println(stderr, "Benchmark failure: {}", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <print>
+#include <vector>
+#include <string>
+#include "adi_stepper.hpp"
+#include "benchmark_utils.hpp"
+
+// Cost and error of stepping only the active window of the packet, ADI engine, against the same stepper over the
+// whole grid. The default packet starts at (Lx/5, Ly/2): the first half of the run is the sparse phase, the packet
+// covering a small part of the domain, the second half the one where it has spread (on the default grid, up to the walls).
+//      error     = |psi - psi_full|/|psi_full| at the end of the run
+//      discarded = fraction of the norm dropped outside the window over the run
+//      window    = mean fraction of the grid stepped, in each phase
+// Usage: activity_benchmark [steps] [precision single|double]
+
+const std::vector<Grid> GRIDS{{151, 101}, {601, 401}};
+const std::vector<float> THRESHOLDS{1e-2f, 1e-3f, 1e-4f, 1e-6f};
+
+struct ActivityResult
+{
+    double early_ms{};
+    double late_ms{};
+    double early_window{};
+    double late_window{};
+    double discarded{};
+};
+
+template<typename Scalar>
+auto run(const Grid& grid, const VectorX<Scalar>& psi0, size_t steps, const ActivityOptions& activity, VectorX<Scalar>& psi) -> ActivityResult
+{
+    CrankNicolsonCoefficients<Scalar> coeffs{DR};
+    AdiStepper<Scalar> stepper{grid.Nx, grid.Ny, coeffs.rx, coeffs.ry, activity};
+    const double cells = static_cast<double>(psi0.size());
+    ActivityResult result{};
+    psi = psi0;
+
+    Stopwatch watch{};
+    for (size_t n = 0; n < steps; n++)
+    {
+        watch.restart();
+        stepper.step(psi);
+        const double elapsed = watch.elapsed_ms();
+        const double window  = stepper.get_active_window(0).value_or(ActiveWindow{.width = grid.Nx-2, .height = grid.Ny-2}).get_cells()/cells;
+        if (2*n < steps)
+        {
+            result.early_ms     += elapsed;
+            result.early_window += window/(steps - steps/2);
+        }
+        else
+        {
+            result.late_ms     += elapsed;
+            result.late_window += window/(steps/2);
+        }
+    }
+    result.discarded = stepper.get_discarded_probability();
+    return result;
+}
+
+template<typename Scalar>
+void run_grids(size_t steps)
+{
+    for (const Grid& grid : GRIDS)
+    {
+        const VectorX<Scalar> psi0 = make_initial_packet<Scalar>(grid.Nx, grid.Ny);
+
+        VectorX<Scalar> reference{};
+        const ActivityResult full = run(grid, psi0, steps, ActivityOptions{}, reference);
+        const double reference_norm = reference.norm();
+        std::println("grid {}x{}: full grid early {:.1f}ms, late {:.1f}ms", grid.Nx, grid.Ny, full.early_ms, full.late_ms);
+        std::println("{:>10} {:>10} {:>10} {:>9} {:>10} {:>10} {:>9} {:>12} {:>12}", "threshold", "early[ms]", "window", "speedup", "late[ms]", "window", "speedup", "error", "discarded");
+
+        for (float threshold : THRESHOLDS)
+        {
+            VectorX<Scalar> psi{};
+            const ActivityOptions activity{.threshold = threshold};
+            const ActivityResult result = run(grid, psi0, steps, activity, psi);
+
+            std::println("{:>10.0e} {:>10.1f} {:>9.1f}% {:>8.2f}x {:>10.1f} {:>9.1f}% {:>8.2f}x {:>12.3e} {:>12.3e}", threshold,
+                         result.early_ms, 100.0*result.early_window, full.early_ms/result.early_ms,
+                         result.late_ms,  100.0*result.late_window,  full.late_ms/result.late_ms,
+                         static_cast<double>((psi - reference).norm())/reference_norm, result.discarded);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t steps    = (argc > 1)? std::stoul(argv[1]) : 1000;
+    const bool use_double = (argc > 2) && std::string{argv[2]} == "double";
+
+    flush_denormals();     // as the viewer and the headless runner
+    std::println("{} steps, dr = {}, {} precision", steps, DR, use_double? "double" : "single");
+    try
+    {
+        if (use_double)
+            run_grids<std::complex<double>>(steps);
+        else
+            run_grids<std::complex<float>>(steps);
+    }
+    catch(const std::exception& e)
+    {
+        std::println(stderr, "Benchmark failure: {}", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
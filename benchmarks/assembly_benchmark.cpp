@@ -0,0 +1,37 @@
+#include <iostream>
+#include <print>
+#include <vector>
+#include <string>
+#include "crank_nicolson_builder.hpp"
+#include "benchmark_utils.hpp"
+
+// Startup cost of the Crank-Nicolson operators: assembly time and peak RSS.
+// Usage: assembly_benchmark [Nx Ny]   (default: 150x100, 300x200, 600x400)
+// Peak RSS is process-wide, so grids are run from small to large; run a single grid for an isolated figure.
+
+int main(int argc, char* argv[])
+{
+    std::vector<Grid> grids{{150, 100}, {300, 200}, {600, 400}};
+    if (argc == 3)
+    {
+        grids = {{std::stoul(argv[1]), std::stoul(argv[2])}};
+    }
+
+    CrankNicolsonCoefficients coeffs{0.04f};
+    std::println("{:>10} {:>12} {:>12} {:>14} {:>14}", "grid", "unknowns", "nnz(A)", "assembly[ms]", "peak RSS[MB]");
+    for (const auto& grid : grids)
+    {
+        CrankNicolsonBuilder<std::complex<float>> builder{};
+        builder.set_num_elements(grid.Nx, grid.Ny);
+        builder.set_diagonal_elements(coeffs.a0, coeffs.b0);
+        builder.set_off_diag_elements(coeffs.rx, coeffs.ry);
+
+        Stopwatch watch{};
+        auto [sparse_A, sparse_M] = builder.get_sparse_matrices();
+        double assembly_ms = watch.elapsed_ms();
+
+        std::string name = std::to_string(grid.Nx) + "x" + std::to_string(grid.Ny);
+        std::println("{:>10} {:>12} {:>12} {:>14.3f} {:>14.1f}", name, sparse_A.rows(), sparse_A.nonZeros(), assembly_ms, get_peak_rss()/1.0e6);
+    }
+    return EXIT_SUCCESS;
+}
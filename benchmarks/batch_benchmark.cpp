@@ -0,0 +1,106 @@
+#include <iostream>
+#include <print>
+#include <vector>
+#include <string>
+#include "crank_nicolson_builder.hpp"
+#include "crank_nicolson_stepper.hpp"
+#include "linear_solvers.hpp"
+#include "benchmark_utils.hpp"
+
+// Throughput of K wavepackets (differing by their wave number) propagated as one (Ndof x K) batch through
+// CrankNicolsonStepper::step_batch, against the same K packets stepped one after the other with step().
+// Both share a single SparseLU factorization, whose setup time is reported apart: the sequential runs are
+// the best case of K independent runs, the batch only gains by sweeping the factors once per step for all columns.
+// Usage: batch_benchmark [steps] [precision single|double]   (thread count is taken from OMP_NUM_THREADS)
+
+struct BatchResult
+{
+    double setup_ms{};
+    double sequential_ms{};     // per step of the K packets
+    double batched_ms{};
+    double max_difference{};    // batched vs sequential psi, relative
+};
+
+template<typename Scalar>
+auto run(const Grid& grid, size_t packets, size_t steps) -> BatchResult
+{
+    CrankNicolsonCoefficients<Scalar> coeffs{DR};
+    MatrixX<Scalar> psi0((grid.Nx-2)*(grid.Ny-2), packets);
+    for (size_t k = 0; k < packets; k++)
+    {
+        psi0.col(k) = make_initial_packet<Scalar>(grid.Nx, grid.Ny, DEFAULT_WAVE_NUMBER*(1.f + 0.1f*k));
+    }
+
+    BatchResult result{};
+    Stopwatch watch{};
+    CrankNicolsonBuilder<Scalar> matrix_builder{};
+    matrix_builder.set_num_elements(grid.Nx, grid.Ny);
+    matrix_builder.set_diagonal_elements(coeffs.a0, coeffs.b0);
+    matrix_builder.set_off_diag_elements(coeffs.rx, coeffs.ry);
+    auto [sparse_A, sparse_M] = matrix_builder.get_sparse_matrices();
+    CrankNicolsonStepper<Scalar> stepper{sparse_A, StencilOperator<Scalar>(grid.Nx, grid.Ny, coeffs.b0, coeffs.rx, coeffs.ry),
+                                         make_linear_solver<Scalar>(SolverOptions{.solver = SOLVER::SPARSE_LU})};
+    result.setup_ms = watch.elapsed_ms();
+
+    std::vector<VectorX<Scalar>> sequential(packets);
+    for (size_t k = 0; k < packets; k++)
+    {
+        sequential[k] = psi0.col(k);
+    }
+    watch.restart();
+    for (size_t n = 0; n < steps; n++)
+    {
+        for (auto& psi : sequential)
+        {
+            stepper.step(psi);
+        }
+    }
+    result.sequential_ms = watch.elapsed_ms()/steps;
+
+    MatrixX<Scalar> batch = psi0;
+    watch.restart();
+    for (size_t n = 0; n < steps; n++)
+    {
+        stepper.step_batch(Eigen::Map<MatrixX<Scalar>>(batch.data(), batch.rows(), batch.cols()));
+    }
+    result.batched_ms = watch.elapsed_ms()/steps;
+
+    for (size_t k = 0; k < packets; k++)
+    {
+        const double difference = (batch.col(k) - sequential[k]).norm()/sequential[k].norm();
+        result.max_difference   = std::max(result.max_difference, difference);
+    }
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t steps = (argc > 1)? std::stoul(argv[1]) : 100;
+    const bool use_double = (argc > 2) && std::string{argv[2]} == "double";
+    const std::vector<Grid> grids{{150, 100}, {300, 200}};
+    const std::vector<size_t> batch_sizes{1, 2, 4, 8, 16};
+
+    flush_denormals();     // as the viewer and the headless runner
+    std::println("{} steps per run, {} precision", steps, use_double? "double" : "single");
+    std::println("{:>10} {:>4} {:>11} {:>16} {:>16} {:>9} {:>12}", "grid", "K", "setup[ms]", "sequential[p/s]", "batched[p/s]", "speedup", "max diff");
+    try
+    {
+        for (const auto& grid : grids)
+        {
+            const std::string name = std::to_string(grid.Nx) + "x" + std::to_string(grid.Ny);
+            for (size_t packets : batch_sizes)
+            {
+                const BatchResult result = use_double? run<std::complex<double>>(grid, packets, steps)
+                                                     : run<std::complex<float>>(grid, packets, steps);
+                std::println("{:>10} {:>4} {:>11.2f} {:>16.1f} {:>16.1f} {:>9.2f} {:>12.3e}", name, packets, result.setup_ms,
+                             1e3*packets/result.sequential_ms, 1e3*packets/result.batched_ms, result.sequential_ms/result.batched_ms, result.max_difference);
+            }
+        }
+    }
+    catch(const std::exception& e)
+    {
+        std::println(stderr, "Benchmark failure: {}", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,272 @@
+#include <iostream>
+#include <print>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <optional>
+#include "crank_nicolson_builder.hpp"
+#include "crank_nicolson_stepper.hpp"
+#include "adi_stepper.hpp"
+#include "split_operator_stepper.hpp"
+#include "schrodinger_equation.hpp"
+#include "simulation_config.hpp"
+#include "framebuffer.hpp"
+#include "absorbing_layer.hpp"
+#include "benchmark_utils.hpp"
+
+// Every phase of a run timed separately, over a matrix of grid sizes, with machine readable output:
+//      assembly        CrankNicolsonBuilder::get_sparse_matrices
+//      factorization   time stepper construction (linear solver setup / Thomas coefficients / DST phases)
+//      evolve          SchodingerEquation::evolve
+//      interaction     Interferometer::activate_interaction
+//      observables     SchodingerEquation::observe (fused |psi|, max and norm sweep)
+//      color_pass      RGBA framebuffer of the viewer
+// Usage: benchmark_suite [--grids 150x100,300x200] [--repetitions 50] [--setup_repetitions 3]
+//                        [--format table|csv|json] [--output file] [--engine cn|adi|fft --solver lu|bicgstab|cocg ...]
+//                        [--eliminate_obstacle true]     assembly, factorization and evolve over the free cells only
+//                        [--precision single|double]
+//                        [--absorbing_layer 16 --absorbing_strength 750]   cn and fft only
+//                        [--active_threshold 1e-4 --active_margin 8]       adi only
+//                        [--dr 0.04] [--dt 0.0004]       square cells, dt dr^2/4 unless set; Lx and Ly follow from the grids
+// Peak RSS is process-wide, so it is the high-water mark after each grid, grids being run from small to large.
+
+struct SuiteOptions
+{
+    std::vector<Grid> grids{{150, 100}, {300, 200}, {600, 400}};
+    size_t repetitions{50};
+    size_t setup_repetitions{3};
+    std::string format{"table"};
+    std::string output{};
+    SimulationConfig config{};
+};
+
+struct Record
+{
+    std::string grid{};
+    std::string phase{};
+    Summary summary{};
+    double peak_rss_mb{};
+};
+
+auto parse_grids(const std::string& value) -> std::vector<Grid>
+{
+    std::vector<Grid> grids{};
+    size_t begin = 0;
+    while (begin < value.size())
+    {
+        size_t end = value.find(',', begin);
+        std::string item = value.substr(begin, end == std::string::npos? std::string::npos : end - begin);
+        size_t x = item.find('x');
+        if (x == std::string::npos)
+        {
+            throw std::invalid_argument("grid '" + item + "' is not of the form NxxNy");
+        }
+        grids.push_back({std::stoul(item.substr(0, x)), std::stoul(item.substr(x+1))});
+        begin = (end == std::string::npos)? value.size() : end + 1;
+    }
+    return grids;
+}
+auto parse_options(int argc, char* argv[]) -> SuiteOptions
+{
+    SuiteOptions options{};
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key{argv[i]};
+        std::string value{argv[i+1]};
+        if      (key == "--grids")             options.grids             = parse_grids(value);
+        else if (key == "--repetitions")       options.repetitions       = std::stoul(value);
+        else if (key == "--setup_repetitions") options.setup_repetitions = std::stoul(value);
+        else if (key == "--format")            options.format            = value;
+        else if (key == "--output")            options.output            = value;
+        else if (key == "--Lx" || key == "--Ly")
+            throw std::invalid_argument("'" + key.substr(2) + "' is set by --grids and dr, (Nx-1)*dr x (Ny-1)*dr");
+        else if (key.starts_with("--"))        options.config.set_option(key.substr(2), value);
+        else throw std::invalid_argument("expected '--key value' pairs, got '" + key + "'");
+    }
+    if (options.config.dr.x != options.config.dr.y)
+    {
+        throw std::invalid_argument("the suite runs square cells, dx and dy must be equal");
+    }
+    if (options.format != "table" && options.format != "csv" && options.format != "json")
+    {
+        throw std::invalid_argument("unknown format '" + options.format + "' (table, csv, json)");
+    }
+    return options;
+}
+
+template<typename Setup, typename Work>
+auto time_phase(size_t repetitions, Setup&& setup, Work&& work) -> Summary
+{
+    std::vector<double> timings{};
+    timings.reserve(repetitions);
+    for (size_t n = 0; n < repetitions; n++)
+    {
+        setup();
+        Stopwatch watch{};
+        work();
+        timings.push_back(watch.elapsed_ms());
+    }
+    return summarize(std::move(timings));
+}
+
+template<typename Scalar>
+auto run_grid(const SuiteOptions& options, const Grid& grid) -> std::vector<Record>
+{
+    const SimulationConfig& config = options.config;
+    const std::string name = std::to_string(grid.Nx) + "x" + std::to_string(grid.Ny);
+    const float dr       = config.dr.x;
+    const float dt_scale = (config.dt > 0.f)? config.dt/(dr*dr/4.f) : 1.f;
+    CrankNicolsonCoefficients<Scalar> coeffs{dr, dt_scale};
+    const Real<Scalar> dt = Real<Scalar>(dt_scale)*Real<Scalar>(dr)*Real<Scalar>(dr)/Real<Scalar>(4);    // the time step of coeffs
+    std::vector<Record> records{};
+    auto add = [&](std::string phase, Summary summary)
+    {
+        records.push_back({name, std::move(phase), summary, 0.0});
+    };
+
+    VectorX<Scalar> psi0 = make_initial_packet<Scalar>(grid.Nx, grid.Ny, config.wave_number, dr);
+
+    Interferometer double_slit = build_interferometer(config, grid.Nx, grid.Ny);
+    CrankNicolsonBuilder<Scalar> matrix_builder{};
+    matrix_builder.set_num_elements(grid.Nx, grid.Ny);
+    matrix_builder.set_diagonal_elements(coeffs.a0, coeffs.b0);
+    matrix_builder.set_off_diag_elements(coeffs.rx, coeffs.ry);
+    StencilOperator<Scalar> stencil_M{grid.Nx, grid.Ny, coeffs.b0, coeffs.rx, coeffs.ry};
+    if (config.absorbing_layer.is_enabled())
+    {
+        if (config.engine == ENGINE::ADI)
+        {
+            throw std::invalid_argument("the absorbing layer needs the Crank-Nicolson or the split-operator engine");
+        }
+        const VectorX<Scalar> absorption = (dt/Real<Scalar>(2))*config.absorbing_layer.get_potential<Scalar>(grid.Nx, grid.Ny);
+        matrix_builder.set_absorption(absorption);
+        stencil_M.set_absorption(absorption, config.absorbing_layer.thickness);
+    }
+    if (config.activity.is_enabled() && config.engine != ENGINE::ADI)
+    {
+        throw std::invalid_argument("active windows need the ADI engine");
+    }
+    std::optional<FreeCellMap> free_cells{};
+    if (config.eliminate_obstacle && config.engine == ENGINE::CRANK_NICOLSON)
+    {
+        free_cells.emplace((grid.Nx-2)*(grid.Ny-2), double_slit.get_mask());
+        matrix_builder.set_free_cells(*free_cells);
+        double_slit.get_mask().apply(psi0);
+    }
+    SparseMatrix<Scalar> sparse_A{};
+    add("assembly", time_phase(options.setup_repetitions, []{}, [&]
+    {
+        auto [A, M] = matrix_builder.get_sparse_matrices();
+        sparse_A = std::move(A);
+    }));
+
+    std::unique_ptr<ITimeStepper<Scalar>> stepper{};
+    add("factorization", time_phase(options.setup_repetitions, [&]{ stepper.reset(); }, [&]
+    {
+        if (config.engine == ENGINE::ADI)
+            stepper = std::make_unique<AdiStepper<Scalar>>(grid.Nx, grid.Ny, coeffs.rx, coeffs.ry, config.activity);
+        else if (config.engine == ENGINE::SPLIT_OPERATOR)
+        {
+            auto split_operator = std::make_unique<SplitOperatorStepper<Scalar>>(grid.Nx, grid.Ny, dr, dr, dt);
+            if (config.absorbing_layer.is_enabled())
+                split_operator->set_absorption(config.absorbing_layer.get_potential<Scalar>(grid.Nx, grid.Ny), dt);
+            stepper = std::move(split_operator);
+        }
+        else
+            stepper = std::make_unique<CrankNicolsonStepper<Scalar>>(sparse_A, stencil_M, make_linear_solver<Scalar>(config.solver_options), free_cells);
+    }));
+
+    SchodingerEquation<Scalar> schrodinger{grid.Nx, grid.Ny, std::move(stepper), VectorX<Scalar>(psi0)};
+
+    add("evolve",        time_phase(options.repetitions, []{}, [&]{ schrodinger.evolve(); }));
+    add("interaction",   time_phase(options.repetitions, []{}, [&]{ schrodinger.interact(double_slit); }));
+
+    // marked stale before every sample, so that each one recomputes the observables: interact() would not with an eliminated obstacle
+    add("observables",   time_phase(options.repetitions, [&]{ schrodinger.mark_stale(); }, [&]{ schrodinger.observe(); }));
+
+    const Observables& observables = schrodinger.observe();
+    std::vector<Rgba>  pixels(grid.Nx*grid.Ny);
+    const ObstacleMask& barrier = double_slit.get_mask();
+    add("color_pass",    time_phase(options.repetitions, []{}, [&]
+    {
+        build_framebuffer(observables.modulus, observables.max_modulus, barrier.get_pixel_spans(), grid.Nx, grid.Ny, FramebufferStyle{}, pixels);
+    }));
+
+    const double peak_rss_mb = get_peak_rss()/1.0e6;
+    for (auto& record : records)
+    {
+        record.peak_rss_mb = peak_rss_mb;
+    }
+    return records;
+}
+
+void write_records(std::FILE* out, const std::string& format, const std::vector<Record>& records)
+{
+    if (format == "csv")
+    {
+        std::println(out, "grid,phase,samples,min_ms,median_ms,p99_ms,mean_ms,peak_rss_mb");
+        for (const auto& r : records)
+            std::println(out, "{},{},{},{:.6f},{:.6f},{:.6f},{:.6f},{:.1f}", r.grid, r.phase, r.summary.samples, r.summary.min, r.summary.median, r.summary.p99, r.summary.mean, r.peak_rss_mb);
+    }
+    else if (format == "json")
+    {
+        std::println(out, "[");
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            const auto& r = records[i];
+            std::println(out, "  {{\"grid\": \"{}\", \"phase\": \"{}\", \"samples\": {}, \"min_ms\": {:.6f}, \"median_ms\": {:.6f}, \"p99_ms\": {:.6f}, \"mean_ms\": {:.6f}, \"peak_rss_mb\": {:.1f}}}{}",
+                         r.grid, r.phase, r.summary.samples, r.summary.min, r.summary.median, r.summary.p99, r.summary.mean, r.peak_rss_mb, (i+1 < records.size())? "," : "");
+        }
+        std::println(out, "]");
+    }
+    else
+    {
+        std::println(out, "{:>10} {:>14} {:>8} {:>12} {:>12} {:>12} {:>12} {:>14}", "grid", "phase", "samples", "min[ms]", "median[ms]", "p99[ms]", "mean[ms]", "peak RSS[MB]");
+        for (const auto& r : records)
+            std::println(out, "{:>10} {:>14} {:>8} {:>12.3f} {:>12.3f} {:>12.3f} {:>12.3f} {:>14.1f}", r.grid, r.phase, r.summary.samples, r.summary.min, r.summary.median, r.summary.p99, r.summary.mean, r.peak_rss_mb);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    SuiteOptions options{};
+    try
+    {
+        options = parse_options(argc, argv);
+    }
+    catch(const std::exception& e)
+    {
+        std::println(stderr, "Invalid parameters: {}", e.what());
+        return EXIT_FAILURE;
+    }
+
+    flush_denormals();     // as the viewer and the headless runner
+    std::vector<Record> records{};
+    try
+    {
+        for (const auto& grid : options.grids)
+        {
+            auto grid_records = (options.config.precision == PRECISION::DOUBLE)? run_grid<std::complex<double>>(options, grid)
+                                                                               : run_grid<std::complex<float>>(options, grid);
+            records.insert(records.end(), grid_records.begin(), grid_records.end());
+        }
+    }
+    catch(const std::exception& e)
+    {
+        std::println(stderr, "Benchmark failure: {}", e.what());
+        return EXIT_FAILURE;
+    }
+
+    std::FILE* out = options.output.empty()? stdout : std::fopen(options.output.c_str(), "w");
+    if (!out)
+    {
+        std::println(stderr, "Cannot open '{}' for writing", options.output);
+        return EXIT_FAILURE;
+    }
+    write_records(out, options.format, records);
+    if (out != stdout)
+    {
+        std::fclose(out);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,120 @@
+#ifndef BENCHMARK_UTILS_HPP
+#define BENCHMARK_UTILS_HPP
+
+#include <iostream>
+#include <chrono>
+#include <complex>
+#include <vector>
+#include <algorithm>
+#include "scalar_types.hpp"
+#include "gaussian_wavefunction_builder.hpp"
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+struct Grid
+{
+    size_t Nx{};
+    size_t Ny{};
+};
+
+constexpr float DR = 0.04f;     // grid step of every benchmark
+
+// The packet of every benchmark: the default Gaussian of the viewer at (Lx/5, Ly/2), on an Nx x Ny grid of step dr.
+template<typename Scalar>
+auto make_initial_packet(size_t Nx, size_t Ny, float wave_number = DEFAULT_WAVE_NUMBER, float dr = DR) -> VectorX<Scalar>
+{
+    const float Lx = (Nx-1)*dr;
+    const float Ly = (Ny-1)*dr;
+    GaussianWfBuilder<Scalar> wf_builder{};
+    wf_builder.set_system_size(Lx, Ly);
+    wf_builder.set_initial_pos(Lx/5.f, Ly/2.f);
+    wf_builder.set_deviation(0.2f);
+    wf_builder.set_wave_number(wave_number);
+    return wf_builder.build_wavefunction(Ny, Nx);
+}
+
+// Peak resident set size of the whole process, in bytes.
+inline size_t get_peak_rss()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return static_cast<size_t>(counters.PeakWorkingSetSize);
+#elif defined(__APPLE__)
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_maxrss)*1024;
+#endif
+}
+
+class Stopwatch
+{
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point m_start{Clock::now()};
+public:
+    void restart() { m_start = Clock::now(); }
+    double elapsed_ms() const { return std::chrono::duration<double, std::milli>(Clock::now() - m_start).count(); }
+};
+
+// Order statistics of repeated timings, in ms.
+struct Summary
+{
+    size_t samples{};
+    double min{};
+    double median{};
+    double p99{};
+    double mean{};
+};
+
+inline Summary summarize(std::vector<double> timings)
+{
+    Summary summary{};
+    if (timings.empty())
+        return summary;
+
+    std::sort(timings.begin(), timings.end());
+    auto percentile = [&](double p)
+    {
+        size_t rank = static_cast<size_t>(p*(timings.size()-1) + 0.5);
+        return timings[rank];
+    };
+    summary.samples = timings.size();
+    summary.min     = timings.front();
+    summary.median  = percentile(0.5);
+    summary.p99     = percentile(0.99);
+    for (double t : timings)
+        summary.mean += t/timings.size();
+    return summary;
+}
+
+// Same Crank-Nicolson coefficients as SchodingerEquationBuilder, for a square step dr and dt = dt_scale dr^2/4.
+template<typename Scalar = std::complex<float>>
+struct CrankNicolsonCoefficients
+{
+    Scalar rx{};
+    Scalar ry{};
+    Scalar a0{};
+    Scalar b0{};
+
+    explicit CrankNicolsonCoefficients(float dr, float dt_scale = 1.f)
+    {
+        using Real = typename Scalar::value_type;
+        constexpr Scalar imaginary_unit{0, 1};
+        Real dx = dr;
+        Real dt = Real(dt_scale)*(dx*dx)/Real(4);
+        rx = - dt / ( Real(2)*imaginary_unit*(dx*dx));
+        ry = rx;
+        a0 = (Real(1) + Real(2)*rx + Real(2)*ry);
+        b0 = (Real(1) - Real(2)*rx - Real(2)*ry);
+    }
+};
+
+#endif
@@ -0,0 +1,202 @@
+#include <iostream>
+#include <print>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <filesystem>
+#include "crank_nicolson_builder.hpp"
+#include "gaussian_wavefunction_builder.hpp"
+#include "schrodinger_equation_builder.hpp"
+#include "checkpoint.hpp"
+#include "simulation_config.hpp"
+#include "benchmark_utils.hpp"
+
+// Cost of checkpointing to the solver: ADI steps with a checkpoint saved every few steps, against the same steps without,
+// then a restart check of each engine: the run checkpointed halfway, resumed from the file as the headless runner does
+// (apply_checkpoint on a default config, the equation rebuilt, restore) and compared bit for bit with the uninterrupted one.
+//      step    = median and p99 of a step, save included
+//      steps/s = over the whole run, the last checkpoint written (close) included
+//      written, stalls: checkpoints written, saves that waited for the previous write
+// The checkpoints are saved far more often than the few seconds apart a run takes them, to make their cost visible.
+// Checkpoint files go to the temporary directory and are deleted afterwards. Fails if a resumed run is not identical.
+// Usage: checkpoint_benchmark [steps]
+
+const std::vector<Grid> GRIDS{{301, 201}, {601, 401}};
+
+struct RestartCase
+{
+    std::string name{};
+    std::vector<std::pair<std::string, std::string>> options{};
+};
+const std::vector<RestartCase> RESTART_CASES{
+    {"cn",         {{"engine", "cn"}}},
+    {"adi",        {{"engine", "adi"}}},
+    {"adi active", {{"engine", "adi"}, {"active_threshold", "1e-4"}}},
+};
+
+using Scalar = std::complex<float>;
+
+// The equation and the barrier of a run, built from its config as the headless runner builds them
+struct Run
+{
+    Interferometer double_slit;
+    SchodingerEquation<Scalar> equation;
+    double dt{};
+
+    void step()
+    {
+        equation.interact(double_slit);
+        equation.evolve();
+    }
+};
+
+auto build_run(const SimulationConfig& config) -> Run
+{
+    SchodingerEquationBuilder<Scalar> eq_builder{config.L, config.dr, config.initial_pos(), std::make_unique<CrankNicolsonBuilder<Scalar>>(), std::make_unique<GaussianWfBuilder<Scalar>>()};
+    eq_builder.set_engine(config.engine);
+    if (config.dt != 0.f)
+        eq_builder.set_time_step(config.dt);
+    eq_builder.set_absorbing_layer(config.absorbing_layer);
+    eq_builder.set_activity(config.activity);
+    eq_builder.set_solver_options(config.solver_options);
+    eq_builder.set_wave_number(config.wave_number);
+    Interferometer double_slit = build_interferometer(config, eq_builder.get_Nx(), eq_builder.get_Ny());
+    if (config.eliminate_obstacle)
+    {
+        eq_builder.set_obstacle(double_slit.get_mask());
+    }
+    return {std::move(double_slit), eq_builder.build_equation(), eq_builder.get_time_step()};
+}
+
+auto make_config(const Grid& grid) -> SimulationConfig
+{
+    SimulationConfig config{};
+    config.L  = {.x = (grid.Nx-1)*DR, .y = (grid.Ny-1)*DR};
+    config.dr = {.x = DR, .y = DR};
+    return config;
+}
+
+auto make_header(const SimulationConfig& config, const Run& run) -> CheckpointHeader
+{
+    return make_checkpoint_header(config, run.double_slit, run.equation.get_packet_count());
+}
+
+void time_saves(const Grid& grid, size_t steps, const std::string& path)
+{
+    SimulationConfig config = make_config(grid);
+    config.set_option("engine", "adi");
+
+    std::println("{:>12} {:>10} {:>10} {:>9} {:>9} {:>8}", "checkpoint", "step[ms]", "p99[ms]", "steps/s", "written", "stalls");
+    for (size_t every : {size_t{0}, size_t{100}, size_t{10}, size_t{1}})
+    {
+        Run run = build_run(config);
+        std::unique_ptr<CheckpointWriter> checkpoints{};
+        if (every > 0)
+        {
+            checkpoints = std::make_unique<CheckpointWriter>(path, make_header(config, run), run.double_slit.get_mask(), config.wave_numbers, std::chrono::duration<float>(0.f));
+        }
+
+        std::vector<double> timings{};
+        Stopwatch total{};
+        for (size_t n = 0; n < steps; n++)
+        {
+            Stopwatch watch{};
+            run.step();
+            if (checkpoints && (n+1) % every == 0)
+                checkpoints->save<Scalar>(run.equation.get_wavefunction(), run.equation.get_stepper_state(), {n+1, (n+1)*run.dt});
+            timings.push_back(watch.elapsed_ms());
+        }
+        if (checkpoints)
+            checkpoints->close();
+        const double total_s  = 1e-3*total.elapsed_ms();
+        const Summary summary = summarize(timings);
+
+        const std::string name = (every == 0)? "none" : "every " + std::to_string(every);
+        std::println("{:>12} {:>10.3f} {:>10.3f} {:>9.1f} {:>9} {:>8}", name, summary.median, summary.p99, steps/total_s,
+                     checkpoints? checkpoints->get_written() : 0, checkpoints? checkpoints->get_stalls() : 0);
+    }
+}
+
+// Whether the run resumed halfway from its checkpoint ends exactly where the uninterrupted one does
+bool check_restart(const Grid& grid, size_t steps, const RestartCase& restart, const std::string& path)
+{
+    SimulationConfig config = make_config(grid);
+    for (const auto& [key, value] : restart.options)
+        config.set_option(key, value);
+
+    Run reference = build_run(config);
+    const size_t half = steps/2;
+    for (size_t n = 0; n < steps; n++)
+    {
+        reference.step();
+        if (n+1 == half)
+        {
+            CheckpointWriter checkpoints{path, make_header(config, reference), reference.double_slit.get_mask(), config.wave_numbers, std::chrono::duration<float>(0.f)};
+            checkpoints.save<Scalar>(reference.equation.get_wavefunction(), reference.equation.get_stepper_state(), {half, half*reference.dt});
+            checkpoints.close();
+        }
+    }
+
+    const Checkpoint checkpoint{path};
+    SimulationConfig resumed_config{};     // nothing of the run but what the checkpoint holds
+    apply_checkpoint(resumed_config, checkpoint);
+    Run resumed = build_run(resumed_config);
+    checkpoint.check_geometry(resumed.equation.Nx, resumed.equation.Ny, resumed.equation.get_packet_count(), resumed.double_slit.get_mask());
+    resumed.equation.restore(checkpoint.get_psi<Scalar>(), checkpoint.get_stepper_state());
+    for (size_t n = checkpoint.get_clock().step; n < steps; n++)
+    {
+        resumed.step();
+    }
+
+    const VectorX<Scalar>& psi         = reference.equation.get_wavefunction();
+    const VectorX<Scalar>& psi_resumed = resumed.equation.get_wavefunction();
+    const bool identical = psi.size() == psi_resumed.size()
+                           && std::memcmp(psi.data(), psi_resumed.data(), psi.size()*sizeof(Scalar)) == 0
+                           && reference.equation.get_discarded_probability() == resumed.equation.get_discarded_probability();
+    std::println("restart {:<10} at step {}: max |psi - psi resumed| = {:.3e}, discarded {:.3e} / {:.3e} after step {}: {}",
+                 restart.name, half, (psi - psi_resumed).cwiseAbs().maxCoeff(), reference.equation.get_discarded_probability(),
+                 resumed.equation.get_discarded_probability(), steps, identical? "identical" : "DIFFERENT");
+    return identical;
+}
+
+bool run_grid(const Grid& grid, size_t steps)
+{
+    const auto directory = std::filesystem::temp_directory_path()/"checkpoint_benchmark";
+    std::filesystem::create_directories(directory);
+    const std::string path = (directory/"run.ckpt").string();
+
+    std::println("grid {}x{}, {:.1f} MB of psi", grid.Nx, grid.Ny, (grid.Nx-2)*(grid.Ny-2)*sizeof(Scalar)/1e6);
+    time_saves(grid, steps, path);
+    bool identical = true;
+    for (const RestartCase& restart : RESTART_CASES)
+    {
+        identical = check_restart(grid, steps, restart, path) && identical;
+    }
+    std::filesystem::remove_all(directory);
+    return identical;
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t steps = (argc > 1)? std::stoul(argv[1]) : 500;
+
+    flush_denormals();     // as the viewer and the headless runner
+    std::println("{} steps", steps);
+    bool identical = true;
+    try
+    {
+        for (const Grid& grid : GRIDS)
+            identical = run_grid(grid, steps) && identical;
+    }
+    catch(const std::exception& e)
+    {
+        std::println(stderr, "Benchmark failure: {}", e.what());
+        return EXIT_FAILURE;
+    }
+    if (!identical)
+    {
+        std::println(stderr, "A resumed run did not follow the uninterrupted one");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
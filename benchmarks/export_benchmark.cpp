@@ -0,0 +1,101 @@
+#include <iostream>
+#include <print>
+#include <vector>
+#include <string>
+#include <filesystem>
+#include "adi_stepper.hpp"
+#include "simulation_config.hpp"
+#include "benchmark_utils.hpp"
+
+// Cost of the video export to the solver: ADI steps with a frame pushed after every one of them, against the same
+// steps without export. The ADI step is the cheapest of the engines, so the one a slow writer holds up the most.
+//      step    = median and p99 of a step, push included
+//      steps/s = over the whole run, the writer drained (close) included
+//      written, dropped, stalls: frames written, dropped by EXPORT_POLICY::DROP, waits of EXPORT_POLICY::BLOCK
+// Frames go to the temporary directory and are deleted afterwards.
+// Usage: export_benchmark [steps]
+
+const std::vector<Grid> GRIDS{{301, 201}, {601, 401}};
+
+struct ExportCase
+{
+    std::string name{};
+    std::string file{};             // empty: no export
+    size_t width{};
+    size_t height{};
+    EXPORT_POLICY policy{};
+};
+
+void run_grid(const Grid& grid, size_t steps)
+{
+    using Scalar = std::complex<float>;
+    const VectorX<Scalar> psi0 = make_initial_packet<Scalar>(grid.Nx, grid.Ny);
+    const Interferometer double_slit = build_interferometer(SimulationConfig{}, grid.Nx, grid.Ny);     // the default double slit
+
+    const auto directory = std::filesystem::temp_directory_path()/"export_benchmark";
+    std::filesystem::create_directories(directory);
+    const std::vector<ExportCase> cases{
+        {"none",            "",                   0,    0,   EXPORT_POLICY::BLOCK},
+        {"y4m block",       "run.y4m",            0,    0,   EXPORT_POLICY::BLOCK},
+        {"y4m drop",        "run.y4m",            0,    0,   EXPORT_POLICY::DROP},
+        {"y4m 1280 block",  "run.y4m",            1280, 854, EXPORT_POLICY::BLOCK},
+        {"y4m 1280 drop",   "run.y4m",            1280, 854, EXPORT_POLICY::DROP},
+        {"ppm block",       "frame",              0,    0,   EXPORT_POLICY::BLOCK},
+        {"ppm drop",        "frame",              0,    0,   EXPORT_POLICY::DROP},
+    };
+
+    std::println("grid {}x{}", grid.Nx, grid.Ny);
+    std::println("{:>16} {:>11} {:>10} {:>10} {:>9} {:>9} {:>8} {:>8}", "export", "frame", "step[ms]", "p99[ms]", "steps/s", "written", "dropped", "stalls");
+    for (const auto& test : cases)
+    {
+        CrankNicolsonCoefficients<Scalar> coeffs{DR};
+        AdiStepper<Scalar> stepper{grid.Nx, grid.Ny, coeffs.rx, coeffs.ry};
+        VectorX<Scalar> psi = psi0;
+        std::unique_ptr<FrameExporter> exporter{};
+        if (!test.file.empty())
+        {
+            const ExportOptions options{.path = (directory/test.file).string(), .width = test.width, .height = test.height, .policy = test.policy};
+            exporter = std::make_unique<FrameExporter>(options, grid.Nx, grid.Ny, double_slit.get_mask());
+        }
+
+        std::vector<double> timings{};
+        Stopwatch total{};
+        for (size_t n = 0; n < steps; n++)
+        {
+            Stopwatch watch{};
+            stepper.step(psi);
+            double_slit.activate_interaction(psi);
+            if (exporter)
+                exporter->push<Scalar>(psi, n+1);
+            timings.push_back(watch.elapsed_ms());
+        }
+        if (exporter)
+            exporter->close();
+        const double total_s  = 1e-3*total.elapsed_ms();
+        const Summary summary = summarize(timings);
+
+        const std::string frame = exporter? std::to_string(exporter->get_width()) + "x" + std::to_string(exporter->get_height()) : "-";
+        std::println("{:>16} {:>11} {:>10.3f} {:>10.3f} {:>9.1f} {:>9} {:>8} {:>8}", test.name, frame, summary.median, summary.p99, steps/total_s,
+                     exporter? exporter->get_frames_written() : 0, exporter? exporter->get_dropped() : 0, exporter? exporter->get_stalls() : 0);
+    }
+    std::filesystem::remove_all(directory);
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t steps = (argc > 1)? std::stoul(argv[1]) : 500;
+
+    flush_denormals();     // as the viewer and the headless runner
+    std::println("{} steps, a frame pushed after each", steps);
+    try
+    {
+        for (const Grid& grid : GRIDS)
+            run_grid(grid, steps);
+    }
+    catch(const std::exception& e)
+    {
+        std::println(stderr, "Benchmark failure: {}", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,131 @@
+#include <iostream>
+#include <print>
+#include <vector>
+#include <string>
+#include <functional>
+#include "stencil_operator.hpp"
+#include "split_field.hpp"
+#include "absorbing_layer.hpp"
+#include "interferometer.hpp"
+#include "crank_nicolson_builder.hpp"
+#include "benchmark_utils.hpp"
+
+// The per-step kernels over psi in its interleaved complex layout against the SplitField one:
+//      stencil  = M psi, StencilOperator::apply() with an absorbing layer
+//      modulus  = |psi|, its max and the norm, the loop of SchodingerEquation::observe()
+//      mask     = zeroing the double slit barrier, ObstacleMask::apply()
+//      convert  = assign() + store(), what going between the layouts costs at the solver boundary
+// Medians of the repetitions, the split results checked against the interleaved ones (max error, relative).
+// Usage: layout_benchmark [repetitions] [precision single|double]
+
+const std::vector<Grid> GRIDS{{150, 100}, {300, 200}, {600, 400}, {1200, 800}};
+
+auto time_median(size_t repetitions, const std::function<void()>& kernel) -> double
+{
+    std::vector<double> timings{};
+    for (size_t n = 0; n < repetitions; n++)
+    {
+        Stopwatch watch{};
+        kernel();
+        timings.push_back(watch.elapsed_ms());
+    }
+    return 1e3*summarize(timings).median;
+}
+
+// Interleaved reference, as SchodingerEquation::observe() over the whole grid
+template<typename Scalar>
+auto reduce_interleaved(const VectorX<Scalar>& psi, float* modulus) -> FieldSummary
+{
+    using Real = Real<Scalar>;
+    const Real* raw = reinterpret_cast<const Real*>(psi.data());
+    const Eigen::Index size = psi.size();
+    float vmax{};
+    double norm{};
+    #pragma omp parallel for schedule(static) reduction(max:vmax) reduction(+:norm)
+    for (Eigen::Index k = 0; k < size; k++)
+    {
+        const Real n2 = raw[2*k]*raw[2*k] + raw[2*k+1]*raw[2*k+1];
+        modulus[k] = static_cast<float>(std::sqrt(n2));
+        vmax  = std::max(vmax, modulus[k]);
+        norm += n2;
+    }
+    return FieldSummary{.max_modulus = vmax, .norm = norm};
+}
+
+template<typename Scalar>
+void run_grids(size_t repetitions)
+{
+    std::println("{:>10} {:>8} {:>16} {:>12} {:>10} {:>12}", "grid", "kernel", "interleaved[us]", "split[us]", "speedup", "max error");
+    CrankNicolsonCoefficients<Scalar> coeffs{DR};
+    for (const Grid& grid : GRIDS)
+    {
+        const std::string name = std::to_string(grid.Nx) + "x" + std::to_string(grid.Ny);
+        auto print_row = [&](std::string_view kernel, double interleaved_us, double split_us, double error)
+        {
+            std::println("{:>10} {:>8} {:>16.1f} {:>12.1f} {:>10.2f} {:>12.3e}", name, kernel, interleaved_us, split_us, interleaved_us/split_us, error);
+        };
+
+        StencilOperator<Scalar> stencil_M{grid.Nx, grid.Ny, coeffs.b0, coeffs.rx, coeffs.ry};
+        const AbsorbingLayer layer{.thickness = 16, .strength = DEFAULT_ABSORBING_STRENGTH};
+        stencil_M.set_absorption(Scalar{0, 1e-4f}*layer.get_potential<Scalar>(grid.Nx, grid.Ny), layer.thickness);
+
+        const size_t N = stencil_M.size();
+        const VectorX<Scalar> psi = VectorX<Scalar>::Random(N);
+        VectorX<Scalar> out(N), stored(N);
+        SplitField<Scalar> split_psi{grid.Nx, grid.Ny}, split_out{grid.Nx, grid.Ny};
+        split_psi.assign(psi);
+
+        // stencil
+        const double stencil_interleaved = time_median(repetitions, [&]{ stencil_M.apply(psi, out); });
+        const double stencil_split       = time_median(repetitions, [&]{ stencil_M.apply(split_psi, split_out); });
+        split_out.store(stored);
+        print_row("stencil", stencil_interleaved, stencil_split, (stored - out).cwiseAbs().maxCoeff()/out.cwiseAbs().maxCoeff());
+
+        // modulus, max and norm
+        std::vector<float> modulus(N), split_modulus(N);
+        FieldSummary interleaved_summary{}, split_summary{};
+        const double modulus_interleaved = time_median(repetitions, [&]{ interleaved_summary = reduce_interleaved(psi, modulus.data()); });
+        const double modulus_split       = time_median(repetitions, [&]{ split_summary = split_psi.reduce_modulus(split_modulus.data()); });
+        double modulus_error = std::abs(split_summary.norm - interleaved_summary.norm)/interleaved_summary.norm;
+        for (size_t k = 0; k < N; k++)
+            modulus_error = std::max(modulus_error, static_cast<double>(std::abs(split_modulus[k] - modulus[k])/interleaved_summary.max_modulus));
+        print_row("modulus", modulus_interleaved, modulus_split, modulus_error);
+
+        // mask: zeroing cells already zero costs the same, psi is not restored between repetitions
+        Interferometer double_slit{grid.Nx, grid.Ny};
+        double_slit.set_param(grid.Nx/60 + 1, grid.Ny/20 + 1, grid.Ny/8 + 1);
+        const ObstacleMask& mask = double_slit.get_mask();
+        VectorX<Scalar> masked = psi;
+        const double mask_interleaved = time_median(repetitions, [&]{ mask.apply(masked); });
+        const double mask_split       = time_median(repetitions, [&]{ mask.apply(split_psi); });
+        split_psi.store(stored);
+        print_row("mask", mask_interleaved, mask_split, (stored - masked).cwiseAbs().maxCoeff());
+
+        // conversion at the solver boundary, against a plain copy of psi
+        const double convert_copy  = time_median(repetitions, [&]{ out = masked; });
+        const double convert_split = time_median(repetitions, [&]{ split_psi.assign(masked); split_psi.store(stored); });
+        print_row("convert", convert_copy, convert_split, (stored - masked).cwiseAbs().maxCoeff());
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t repetitions = (argc > 1)? std::stoul(argv[1]) : 200;
+    const bool use_double    = (argc > 2) && std::string{argv[2]} == "double";
+
+    flush_denormals();     // as the viewer and the headless runner
+    std::println("{} repetitions per kernel, {} precision", repetitions, use_double? "double" : "single");
+    try
+    {
+        if (use_double)
+            run_grids<std::complex<double>>(repetitions);
+        else
+            run_grids<std::complex<float>>(repetitions);
+    }
+    catch(const std::exception& e)
+    {
+        std::println(stderr, "Benchmark failure: {}", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,135 @@
+#include <iostream>
+#include <print>
+#include <vector>
+#include <string>
+#include "crank_nicolson_builder.hpp"
+#include "linear_solvers.hpp"
+#include "benchmark_utils.hpp"
+
+// Fill-in and cost of the sparse LU of the Crank-Nicolson matrix A under each column ordering:
+//      analyze   = ordering + elimination tree (analyzePattern), the part a change of dt can keep
+//      factorize = numerical factorization, what a change of dt costs with the analysis kept
+//      rebuild   = both, what a change of dt costs from scratch
+//      solve     = median of the triangular solves, the cost of every time step
+// The solution of each ordering is checked against the COLAMD one (diff), the refactorized LU by its residual.
+// Usage: ordering_benchmark [solves] [precision single|double]
+
+const std::vector<Grid> GRIDS{{151, 101}, {301, 201}, {601, 401}};
+// AMD and the band ordering fill past memory on the large grids: only run up to this many unknowns
+constexpr size_t MAX_UNKNOWNS_ALL_ORDERINGS = 100000;
+
+template<typename Scalar>
+struct OrderingResult
+{
+    double analyze_ms{};
+    double factorize_ms{};
+    double refactorize_ms{};
+    double refactor_residual{};     // |A x - b|/|b| of a solve with the refactorized LU
+    size_t fill{};
+    Summary solve{};
+    VectorX<Scalar> x{};
+};
+
+template<typename Scalar, typename Ordering>
+auto run(const SparseMatrix<Scalar>& A, const SparseMatrix<Scalar>& A_retimed, const VectorX<Scalar>& b, size_t solves) -> OrderingResult<Scalar>
+{
+    OrderingResult<Scalar> result{};
+    PersistentSparseLU<Scalar, Ordering> lu{};
+    Stopwatch watch{};
+    lu.analyzePattern(A);
+    result.analyze_ms = watch.elapsed_ms();
+    watch.restart();
+    lu.factorize(A);
+    result.factorize_ms = watch.elapsed_ms();
+    if (lu.info() != Eigen::Success)
+    {
+        throw std::runtime_error("factorization failed: " + lu.lastErrorMessage());
+    }
+    result.fill = lu.get_factor_nonzeros();
+
+    std::vector<double> timings{};
+    for (size_t n = 0; n < solves; n++)
+    {
+        watch.restart();
+        result.x = lu.solve(b);
+        timings.push_back(watch.elapsed_ms());
+    }
+    result.solve = summarize(timings);
+
+    // another dt over the same analysis, as SparseLUSolver::refactorize()
+    PersistentSparseLU<Scalar, Ordering> retimed{};
+    watch.restart();
+    retimed.adopt_analysis(lu);
+    retimed.factorize(A_retimed);
+    result.refactorize_ms = watch.elapsed_ms();
+    if (retimed.info() != Eigen::Success)
+    {
+        throw std::runtime_error("refactorization failed: " + retimed.lastErrorMessage());
+    }
+    const VectorX<Scalar> x = retimed.solve(b);
+    result.refactor_residual = (A_retimed*x - b).norm()/b.norm();
+    return result;
+}
+
+template<typename Scalar>
+auto get_matrix(const Grid& grid, float dt_scale) -> SparseMatrix<Scalar>
+{
+    CrankNicolsonCoefficients<Scalar> coeffs{DR, dt_scale};
+    CrankNicolsonBuilder<Scalar> builder{};
+    builder.set_num_elements(grid.Nx, grid.Ny);
+    builder.set_diagonal_elements(coeffs.a0, coeffs.b0);
+    builder.set_off_diag_elements(coeffs.rx, coeffs.ry);
+    auto [sparse_A, sparse_M] = builder.get_sparse_matrices();
+    return sparse_A;
+}
+
+template<typename Scalar>
+void run_grids(size_t solves)
+{
+    std::println("{:>10} {:>8} {:>12} {:>12} {:>12} {:>13} {:>12} {:>10} {:>10} {:>12} {:>12}", "grid", "ordering", "L+U nnz", "analyze[ms]", "factor[ms]", "refactor[ms]",
+                 "rebuild[ms]", "solve[ms]", "p99[ms]", "diff", "residual");
+    for (const Grid& grid : GRIDS)
+    {
+        const SparseMatrix<Scalar> A         = get_matrix<Scalar>(grid, 1.f);
+        const SparseMatrix<Scalar> A_retimed = get_matrix<Scalar>(grid, 2.f);
+        const VectorX<Scalar> b = VectorX<Scalar>::Random(A.cols());
+        const std::string name  = std::to_string(grid.Nx) + "x" + std::to_string(grid.Ny);
+
+        const auto reference = run<Scalar, Eigen::COLAMDOrdering<int>>(A, A_retimed, b, solves);
+        auto print_row = [&](std::string_view ordering, const OrderingResult<Scalar>& result)
+        {
+            std::println("{:>10} {:>8} {:>12} {:>12.1f} {:>12.1f} {:>13.1f} {:>12.1f} {:>10.3f} {:>10.3f} {:>12.3e} {:>12.3e}", name, ordering, result.fill,
+                         result.analyze_ms, result.factorize_ms, result.refactorize_ms, result.analyze_ms + result.factorize_ms,
+                         result.solve.median, result.solve.p99, static_cast<double>((result.x - reference.x).norm()/reference.x.norm()), result.refactor_residual);
+        };
+        print_row("colamd",  reference);
+        if (static_cast<size_t>(A.cols()) <= MAX_UNKNOWNS_ALL_ORDERINGS)
+        {
+            print_row("amd",     run<Scalar, Eigen::AMDOrdering<int>>(A, A_retimed, b, solves));
+            print_row("natural", run<Scalar, BandOrdering<int>>(A, A_retimed, b, solves));
+        }
+        print_row("nd",      run<Scalar, NestedDissectionOrdering<int>>(A, A_retimed, b, solves));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t solves   = (argc > 1)? std::stoul(argv[1]) : 20;
+    const bool use_double = (argc > 2) && std::string{argv[2]} == "double";
+
+    flush_denormals();     // as the viewer and the headless runner
+    std::println("{} solves per ordering, {} precision", solves, use_double? "double" : "single");
+    try
+    {
+        if (use_double)
+            run_grids<std::complex<double>>(solves);
+        else
+            run_grids<std::complex<float>>(solves);
+    }
+    catch(const std::exception& e)
+    {
+        std::println(stderr, "Benchmark failure: {}", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <print>
+#include <vector>
+#include <string>
+#include "crank_nicolson_builder.hpp"
+#include "crank_nicolson_stepper.hpp"
+#include "linear_solvers.hpp"
+#include "adi_stepper.hpp"
+#include "benchmark_utils.hpp"
+
+// Throughput and accuracy of the single and double precision builds of each engine, side by side:
+// time per step, norm drift (no barrier, so any drift is the scheme's or the arithmetic's) and
+// the relative difference of the single precision psi to the double precision one after the same steps.
+// Usage: precision_benchmark [steps]   (thread count is taken from OMP_NUM_THREADS)
+
+enum class ENGINE_KIND
+{
+    LU,
+    ADI,
+};
+
+struct PrecisionResult
+{
+    double setup_ms{};
+    double step_ms{};
+    double norm_drift{};
+    VectorX<std::complex<double>> psi{};    // widened, to compare both precisions
+};
+
+template<typename Scalar>
+auto run(ENGINE_KIND engine, const Grid& grid, size_t steps) -> PrecisionResult
+{
+    CrankNicolsonCoefficients<Scalar> coeffs{DR};
+    VectorX<Scalar> psi = make_initial_packet<Scalar>(grid.Nx, grid.Ny);
+
+    PrecisionResult result{};
+    Stopwatch watch{};
+    std::unique_ptr<ITimeStepper<Scalar>> stepper{};
+    if (engine == ENGINE_KIND::ADI)
+    {
+        stepper = std::make_unique<AdiStepper<Scalar>>(grid.Nx, grid.Ny, coeffs.rx, coeffs.ry);
+    }
+    else
+    {
+        CrankNicolsonBuilder<Scalar> matrix_builder{};
+        matrix_builder.set_num_elements(grid.Nx, grid.Ny);
+        matrix_builder.set_diagonal_elements(coeffs.a0, coeffs.b0);
+        matrix_builder.set_off_diag_elements(coeffs.rx, coeffs.ry);
+        auto [sparse_A, sparse_M] = matrix_builder.get_sparse_matrices();
+        stepper = std::make_unique<CrankNicolsonStepper<Scalar>>(sparse_A, StencilOperator<Scalar>(grid.Nx, grid.Ny, coeffs.b0, coeffs.rx, coeffs.ry),
+                                                                 make_linear_solver<Scalar>(SolverOptions{.solver = SOLVER::SPARSE_LU}));
+    }
+    result.setup_ms = watch.elapsed_ms();
+
+    const double norm0 = psi.template cast<std::complex<double>>().squaredNorm();
+    watch.restart();
+    for (size_t n = 0; n < steps; n++)
+    {
+        stepper->step(psi);
+    }
+    result.step_ms    = watch.elapsed_ms()/steps;
+    result.psi        = psi.template cast<std::complex<double>>();
+    result.norm_drift = std::abs(result.psi.squaredNorm() - norm0)/norm0;
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t steps = (argc > 1)? std::stoul(argv[1]) : 200;
+    std::vector<Grid> grids{{150, 100}, {300, 200}, {600, 400}};
+    struct Engine
+    {
+        std::string_view name{};
+        ENGINE_KIND kind{};
+    };
+    const std::vector<Engine> engines{{"CN+LU", ENGINE_KIND::LU}, {"ADI", ENGINE_KIND::ADI}};
+
+    flush_denormals();     // as the viewer and the headless runner
+    std::println("{} steps per run", steps);
+    std::println("{:>10} {:>8} {:>10} {:>12} {:>12} {:>10} {:>12} {:>14}", "grid", "engine", "precision", "setup[ms]", "step[ms]", "steps/s", "norm drift", "diff vs double");
+    try
+    {
+        for (const auto& grid : grids)
+        {
+            const std::string name = std::to_string(grid.Nx) + "x" + std::to_string(grid.Ny);
+            for (const auto& engine : engines)
+            {
+                auto print_row = [&](std::string_view precision, const PrecisionResult& result, double diff)
+                {
+                    std::println("{:>10} {:>8} {:>10} {:>12.2f} {:>12.3f} {:>10.1f} {:>12.3e} {:>14.3e}", name, engine.name, precision,
+                                 result.setup_ms, result.step_ms, 1e3/result.step_ms, result.norm_drift, diff);
+                };
+                const PrecisionResult single    = run<std::complex<float>>(engine.kind, grid, steps);
+                const PrecisionResult reference = run<std::complex<double>>(engine.kind, grid, steps);
+                print_row("single", single, (single.psi - reference.psi).norm()/reference.psi.norm());
+                print_row("double", reference, 0.0);
+            }
+        }
+    }
+    catch(const std::exception& e)
+    {
+        std::println(stderr, "Benchmark failure: {}", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,144 @@
+#include <iostream>
+#include <print>
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include "crank_nicolson_builder.hpp"
+#include "crank_nicolson_stepper.hpp"
+#include "linear_solvers.hpp"
+#include "adi_stepper.hpp"
+#include "split_operator_stepper.hpp"
+#include "interferometer.hpp"
+#include "benchmark_utils.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Time to solution of the engines for the same physical end time T = steps dt0 (dt0 = dr^2/4), through the double slit:
+// Crank-Nicolson (SparseLU) and ADI at dt0 and at larger steps, the split-operator engine at dt0 and at larger steps.
+// Accuracy is the distance of the final psi to a split-operator run at dt0/4: the split-operator kinetic step being
+// exact in time, that reference only carries the splitting error of the barrier, a quarter of that of the dt0 run.
+// Usage: split_operator_benchmark [steps] [precision single|double]   (thread count is taken from OMP_NUM_THREADS)
+
+struct EngineResult
+{
+    double setup_ms{};
+    double run_ms{};            // all the steps to T, barrier included
+    double norm{};              // relative to the initial norm
+    VectorX<std::complex<double>> psi{};
+};
+
+template<typename Scalar>
+using StepperFactory = std::function<std::unique_ptr<ITimeStepper<Scalar>>(float dt_scale)>;
+
+template<typename Scalar>
+auto run(const StepperFactory<Scalar>& factory, float dt_scale, size_t steps, const VectorX<Scalar>& psi0, const Interferometer& double_slit) -> EngineResult
+{
+    EngineResult result{};
+    Stopwatch watch{};
+    auto stepper = factory(dt_scale);
+    result.setup_ms = watch.elapsed_ms();
+
+    VectorX<Scalar> psi = psi0;
+    watch.restart();
+    for (size_t n = 0; n < steps; n++)
+    {
+        double_slit.activate_interaction(psi);
+        stepper->step(psi);
+    }
+    result.run_ms = watch.elapsed_ms();
+    result.psi    = psi.template cast<std::complex<double>>();
+    result.norm   = result.psi.squaredNorm()/psi0.template cast<std::complex<double>>().squaredNorm();
+    return result;
+}
+
+template<typename Scalar>
+void run_grid(const Grid& grid, size_t steps)
+{
+    using Real = Real<Scalar>;
+    const VectorX<Scalar> psi0 = make_initial_packet<Scalar>(grid.Nx, grid.Ny);
+
+    // same geometry as the default slits of simulation_config
+    const size_t width   = static_cast<size_t>(0.18f*grid.Ny);
+    const size_t opening = static_cast<size_t>(0.04f*grid.Ny);
+    Interferometer double_slit{grid.Nx, grid.Ny};
+    double_slit.set_param(static_cast<size_t>(0.02f*grid.Nx), width, grid.Ny/2 - width/2 - opening);
+
+    StepperFactory<Scalar> crank_nicolson = [&](float dt_scale) -> std::unique_ptr<ITimeStepper<Scalar>>
+    {
+        CrankNicolsonCoefficients<Scalar> coeffs{DR, dt_scale};
+        CrankNicolsonBuilder<Scalar> matrix_builder{};
+        matrix_builder.set_num_elements(grid.Nx, grid.Ny);
+        matrix_builder.set_diagonal_elements(coeffs.a0, coeffs.b0);
+        matrix_builder.set_off_diag_elements(coeffs.rx, coeffs.ry);
+        auto [sparse_A, sparse_M] = matrix_builder.get_sparse_matrices();
+        return std::make_unique<CrankNicolsonStepper<Scalar>>(sparse_A, StencilOperator<Scalar>(grid.Nx, grid.Ny, coeffs.b0, coeffs.rx, coeffs.ry),
+                                                              make_linear_solver<Scalar>(SolverOptions{.solver = SOLVER::SPARSE_LU}));
+    };
+    StepperFactory<Scalar> adi = [&](float dt_scale) -> std::unique_ptr<ITimeStepper<Scalar>>
+    {
+        CrankNicolsonCoefficients<Scalar> coeffs{DR, dt_scale};
+        return std::make_unique<AdiStepper<Scalar>>(grid.Nx, grid.Ny, coeffs.rx, coeffs.ry);
+    };
+    StepperFactory<Scalar> split_operator = [&](float dt_scale) -> std::unique_ptr<ITimeStepper<Scalar>>
+    {
+        const Real dr = DR;
+        return std::make_unique<SplitOperatorStepper<Scalar>>(grid.Nx, grid.Ny, dr, dr, Real(dt_scale)*dr*dr/Real(4));
+    };
+
+    const EngineResult reference = run(split_operator, 0.25f, 4*steps, psi0, double_slit);
+    const std::string name = std::to_string(grid.Nx) + "x" + std::to_string(grid.Ny);
+    double baseline_ms{};
+    auto run_row = [&](std::string_view engine, const StepperFactory<Scalar>& factory, size_t dt_scale)
+    {
+        const EngineResult result = run(factory, static_cast<float>(dt_scale), steps/dt_scale, psi0, double_slit);
+        const double total_ms = result.setup_ms + result.run_ms;
+        if (baseline_ms == 0.0)
+            baseline_ms = total_ms;
+        const double error = (result.psi - reference.psi).norm()/reference.psi.norm();
+        std::println("{:>10} {:>6} {:>6} {:>7} {:>11.2f} {:>11.2f} {:>11.2f} {:>9.2f} {:>12.3e} {:>12.3e}", name, engine, dt_scale, steps/dt_scale,
+                     result.setup_ms, result.run_ms, total_ms, baseline_ms/total_ms, 1.0 - result.norm, error);
+    };
+    run_row("CN+LU", crank_nicolson, 1);
+    run_row("CN+LU", crank_nicolson, 4);
+    run_row("ADI",   adi,            1);
+    run_row("ADI",   adi,            4);
+    run_row("FFT",   split_operator, 1);
+    run_row("FFT",   split_operator, 4);
+    run_row("FFT",   split_operator, 16);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t steps = (argc > 1)? std::stoul(argv[1]) : 160;
+    const bool use_double = (argc > 2) && std::string{argv[2]} == "double";
+    // Nx-1 and Ny-1 with small prime factors only (direct FFTs), but for the last grid whose x lines need Bluestein's
+    const std::vector<Grid> grids{{151, 101}, {301, 201}, {601, 401}, {150, 100}};
+    steps = std::max<size_t>(steps/16, 1)*16;     // every dt of the table reaches the same T
+
+    flush_denormals();     // as the viewer and the headless runner
+#ifdef _OPENMP
+    std::println("threads: {}", omp_get_max_threads());
+#else
+    std::println("threads: 1 (built without OpenMP)");
+#endif
+    std::println("T = {} dt0 (dt0 = dr^2/4), {} precision", steps, use_double? "double" : "single");
+    std::println("{:>10} {:>6} {:>6} {:>7} {:>11} {:>11} {:>11} {:>9} {:>12} {:>12}", "grid", "engine", "dt/dt0", "steps", "setup[ms]", "run[ms]", "total[ms]", "speedup", "norm loss", "error");
+    try
+    {
+        for (const auto& grid : grids)
+        {
+            if (use_double)
+                run_grid<std::complex<double>>(grid, steps);
+            else
+                run_grid<std::complex<float>>(grid, steps);
+        }
+    }
+    catch(const std::exception& e)
+    {
+        std::println(stderr, "Benchmark failure: {}", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
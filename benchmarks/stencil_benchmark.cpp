@@ -0,0 +1,59 @@
+#include <iostream>
+#include <print>
+#include <vector>
+#include <string>
+#include "crank_nicolson_builder.hpp"
+#include "stencil_operator.hpp"
+#include "benchmark_utils.hpp"
+
+// Right hand side product of the Crank-Nicolson step: compressed sparse M*psi against the matrix-free stencil.
+// Usage: stencil_benchmark [repetitions]
+
+int main(int argc, char* argv[])
+{
+    size_t repetitions = (argc > 1)? std::stoul(argv[1]) : 200;
+    std::vector<Grid> grids{{150, 100}, {300, 200}, {600, 400}, {1200, 800}};
+
+    std::println("{:>10} {:>8} {:>12} {:>14} {:>12} {:>10} {:>12}", "grid", "kernel", "apply[us]", "bytes/step", "GB/s", "speedup", "max error");
+
+    CrankNicolsonCoefficients coeffs{DR};
+    for (const auto& grid : grids)
+    {
+        CrankNicolsonBuilder<std::complex<float>> matrix_builder{};
+        matrix_builder.set_num_elements(grid.Nx, grid.Ny);
+        matrix_builder.set_diagonal_elements(coeffs.a0, coeffs.b0);
+        matrix_builder.set_off_diag_elements(coeffs.rx, coeffs.ry);
+        auto [sparse_A, sparse_M] = matrix_builder.get_sparse_matrices();
+        StencilOperator<std::complex<float>> stencil_M{grid.Nx, grid.Ny, coeffs.b0, coeffs.rx, coeffs.ry};
+
+        const size_t N = stencil_M.size();
+        Eigen::VectorXcf psi = Eigen::VectorXcf::Random(N);
+        Eigen::VectorXcf out_sparse(N), out_stencil(N);
+
+        Stopwatch watch{};
+        for (size_t n = 0; n < repetitions; n++)
+        {
+            out_sparse.noalias() = sparse_M*psi;
+        }
+        double sparse_us = 1e3*watch.elapsed_ms()/repetitions;
+
+        watch.restart();
+        for (size_t n = 0; n < repetitions; n++)
+        {
+            stencil_M.apply(psi, out_stencil);
+        }
+        double stencil_us = 1e3*watch.elapsed_ms()/repetitions;
+
+        // Compulsory traffic: the sparse product streams values + inner indices + outer indices on top of psi in/out,
+        // the stencil only streams psi in and out.
+        const size_t vector_bytes  = 2*N*sizeof(std::complex<float>);
+        const size_t sparse_bytes  = vector_bytes + sparse_M.nonZeros()*(sizeof(std::complex<float>) + sizeof(int)) + (N+1)*sizeof(int);
+        const size_t stencil_bytes = vector_bytes;
+        float max_error = (out_sparse - out_stencil).cwiseAbs().maxCoeff()/out_sparse.cwiseAbs().maxCoeff();
+
+        std::string name = std::to_string(grid.Nx) + "x" + std::to_string(grid.Ny);
+        std::println("{:>10} {:>8} {:>12.1f} {:>14} {:>12.2f} {:>10} {:>12}", name, "sparse", sparse_us, sparse_bytes, sparse_bytes/(1e3*sparse_us), "-", "-");
+        std::println("{:>10} {:>8} {:>12.1f} {:>14} {:>12.2f} {:>10.2f} {:>12.3e}", name, "stencil", stencil_us, stencil_bytes, stencil_bytes/(1e3*stencil_us), sparse_us/stencil_us, max_error);
+    }
+    return EXIT_SUCCESS;
+}
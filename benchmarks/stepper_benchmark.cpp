@@ -0,0 +1,110 @@
+#include <iostream>
+#include <print>
+#include <vector>
+#include <string>
+#include <optional>
+#include "crank_nicolson_builder.hpp"
+#include "crank_nicolson_stepper.hpp"
+#include "linear_solvers.hpp"
+#include "adi_stepper.hpp"
+#include "benchmark_utils.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Time per step and accuracy of every engine / linear solver against the SparseLU Crank-Nicolson reference.
+// Usage: stepper_benchmark [steps] [tolerance]   (thread count is taken from OMP_NUM_THREADS)
+
+struct StepperResult
+{
+    double setup_ms{};
+    double step_ms{};
+    double iterations{};
+    double norm_drift{};
+    Eigen::VectorXcf psi{};
+};
+
+StepperResult run(ITimeStepper<std::complex<float>>& stepper, Eigen::VectorXcf psi, size_t steps, double setup_ms)
+{
+    StepperResult result{};
+    result.setup_ms = setup_ms;
+    float norm0     = psi.squaredNorm();
+    size_t iterations{};
+
+    Stopwatch watch{};
+    for (size_t n = 0; n < steps; n++)
+    {
+        stepper.step(psi);
+        iterations += stepper.get_iterations();
+    }
+    result.step_ms    = watch.elapsed_ms()/steps;
+    result.iterations = static_cast<double>(iterations)/steps;
+    result.norm_drift = std::abs(psi.squaredNorm() - norm0)/norm0;
+    result.psi        = std::move(psi);
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t steps    = (argc > 1)? std::stoul(argv[1]) : 100;
+    float tolerance = (argc > 2)? std::stof(argv[2])  : 1e-6f;
+    flush_denormals();     // as the viewer and the headless runner
+    std::vector<Grid> grids{{150, 100}, {300, 200}, {600, 400}, {300, 3}};   // the last one degenerate: a single interior row
+
+    struct Candidate
+    {
+        std::string_view name{};
+        SolverOptions options{};
+    };
+    const std::vector<Candidate> solvers{
+        {"LU",             {.solver = SOLVER::SPARSE_LU}},
+        {"BiCGSTAB+diag",  {.solver = SOLVER::BICGSTAB, .preconditioner = PRECONDITIONER::DIAGONAL, .tolerance = tolerance}},
+        {"BiCGSTAB+ILUT",  {.solver = SOLVER::BICGSTAB, .preconditioner = PRECONDITIONER::ILUT,     .tolerance = tolerance}},
+        {"COCG+diag",      {.solver = SOLVER::COCG,                                                 .tolerance = tolerance}},
+    };
+
+#ifdef _OPENMP
+    std::println("threads: {}", omp_get_max_threads());
+#else
+    std::println("threads: 1 (built without OpenMP)");
+#endif
+    std::println("{:>10} {:>14} {:>12} {:>12} {:>10} {:>10} {:>12} {:>12}", "grid", "engine", "setup[ms]", "step[ms]", "steps/s", "iter/step", "norm drift", "diff vs LU");
+
+    CrankNicolsonCoefficients coeffs{DR};
+    for (const auto& grid : grids)
+    {
+        std::string name = std::to_string(grid.Nx) + "x" + std::to_string(grid.Ny);
+        auto print_row = [&](std::string_view engine, const StepperResult& result, const StepperResult* reference)
+        {
+            double diff = reference? (result.psi - reference->psi).norm()/reference->psi.norm() : 0.0;
+            std::println("{:>10} {:>14} {:>12.2f} {:>12.3f} {:>10.1f} {:>10.1f} {:>12.3e} {:>12.3e}", name, engine, result.setup_ms, result.step_ms, 1e3/result.step_ms, result.iterations, result.norm_drift, diff);
+        };
+
+        Eigen::VectorXcf psi0 = make_initial_packet<std::complex<float>>(grid.Nx, grid.Ny);
+        if (psi0.squaredNorm() == 0.f)
+            psi0.setOnes();     // the packet's outer rows are zeroed: nothing is left of it on a single interior row
+        StencilOperator<std::complex<float>> stencil_M{grid.Nx, grid.Ny, coeffs.b0, coeffs.rx, coeffs.ry};
+
+        std::optional<StepperResult> reference{};
+        for (const auto& candidate : solvers)
+        {
+            Stopwatch watch{};
+            CrankNicolsonBuilder<std::complex<float>> matrix_builder{};
+            matrix_builder.set_num_elements(grid.Nx, grid.Ny);
+            matrix_builder.set_diagonal_elements(coeffs.a0, coeffs.b0);
+            matrix_builder.set_off_diag_elements(coeffs.rx, coeffs.ry);
+            auto [sparse_A, sparse_M] = matrix_builder.get_sparse_matrices();
+            CrankNicolsonStepper<std::complex<float>> stepper{sparse_A, stencil_M, make_linear_solver<std::complex<float>>(candidate.options)};
+            auto result = run(stepper, psi0, steps, watch.elapsed_ms());
+
+            print_row(candidate.name, result, reference? &*reference : nullptr);
+            if (!reference)
+                reference = std::move(result);
+        }
+
+        Stopwatch watch{};
+        AdiStepper<std::complex<float>> adi_stepper{grid.Nx, grid.Ny, coeffs.rx, coeffs.ry};
+        print_row("ADI", run(adi_stepper, psi0, steps, watch.elapsed_ms()), &*reference);
+    }
+    return EXIT_SUCCESS;
+}
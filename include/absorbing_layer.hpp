@@ -0,0 +1,27 @@
+#ifndef ABSORBING_LAYER_HPP
+#define ABSORBING_LAYER_HPP
+
+#include <iostream>
+#include "Eigen/SparseLU"
+#include "scalar_types.hpp"
+
+// Complex absorbing potential along the four domain walls: H = -laplacian - i W, with
+//      W = strength s^2,   s = (thickness + 1 - distance)/thickness
+// for the interior cells closer than thickness cells to a wall (distance 1 next to it), 0 elsewhere.
+// Outgoing waves are damped across the layer instead of bouncing off the Dirichlet walls, so that the domain
+// can end just past the region of interest. The quadratic ramp keeps the reflection off the layer itself small;
+// a layer of a few wavelengths with strength ~ 10 v/(thickness dx), v = 2 sin(k dx)/dx the group velocity on the grid,
+// leaves ~1e-3 of the amplitude.
+constexpr float DEFAULT_ABSORBING_STRENGTH = 750.f;    // 10 v/(thickness dx) for the default packet and a 16 cell layer
+
+struct AbsorbingLayer
+{
+    size_t thickness{};     // cells, no layer if 0
+    float strength{};       // W next to the walls, 1/time
+
+    bool is_enabled() const { return thickness > 0 && strength > 0.f; }
+    template<typename Scalar>
+    auto get_potential(size_t Nx, size_t Ny) const -> VectorX<Scalar>;    // W over the interior, column major
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef ADI_STEPPER_HPP
+#define ADI_STEPPER_HPP
+
+#include <iostream>
+#include <vector>
+#include "Eigen/SparseLU"
+#include "interface_time_stepper.hpp"
+
+constexpr size_t DEFAULT_ACTIVE_MARGIN = 8;
+
+// Restriction of the step to where the packet is: cells with |psi| above threshold times the initial max |psi|,
+// bounded by a rectangle grown by margin cells on every side. Disabled if the threshold is 0.
+struct ActivityOptions
+{
+    float threshold{};
+    size_t margin{DEFAULT_ACTIVE_MARGIN};
+
+    bool is_enabled() const { return threshold > 0.f; }
+};
+
+// Matrix-free Peaceman-Rachford ADI splitting of the 2D Crank-Nicolson step:
+//      (1 - rx Dx) psi*        = (1 + ry Dy) psi(t)
+//      (1 - ry Dy) psi(t+dt)   = (1 + rx Dx) psi*
+// Dx, Dy being the second differences along x and y with Dirichlet walls.
+// Each half step is a batch of independent, constant coefficient, tridiagonal systems (one per row or column),
+// solved with the Thomas algorithm and spread over threads. No matrix is stored or factorized.
+// With activity tracking, every packet is stepped over its active window only, as if its edges were walls: the line
+// systems shrink to the window and their elimination coefficients are a prefix of the full ones. The window is found
+// again after each step from the cells above the threshold, and what falls out of it is dropped (and accounted for).
+template<typename Scalar>
+class AdiStepper : public ITimeStepper<Scalar>
+{
+    struct ThomasCoefficients
+    {
+        Scalar off_diag{};              // sub- and super-diagonal, -r
+        std::vector<Scalar> c_prime{};  // modified super-diagonal
+        std::vector<Scalar> inv_denom{};// 1/(modified diagonal)
+    };
+    struct PacketActivity
+    {
+        bool started{};
+        ActiveWindow window{};
+        Real<Scalar> cutoff{};          // |psi|^2 of the threshold
+        double initial_norm{};
+        double discarded{};             // sum of the |psi|^2 dropped
+    };
+    size_t m_rows{};    // Ny-2, contiguous direction
+    size_t m_cols{};    // Nx-2
+    Scalar m_rx{};
+    Scalar m_ry{};
+    ThomasCoefficients m_x_line{};
+    ThomasCoefficients m_y_line{};
+    VectorX<Scalar> m_psi_temp{};
+    ActivityOptions m_activity{};
+    std::vector<PacketActivity> m_packets{};
+public:
+    explicit AdiStepper(size_t Nx, size_t Ny, Scalar rx, Scalar ry, const ActivityOptions& activity = {});
+    void step(VectorX<Scalar>& psi) override;
+    void step_batch(Eigen::Map<MatrixX<Scalar>> psi) override;
+    size_t get_iterations() const override { return 0; }
+    auto get_active_window(size_t packet) const -> std::optional<ActiveWindow> override;
+    double get_discarded_probability() const override;
+    void restart() override { m_packets.clear(); }
+    auto save_state() const -> std::vector<StepperPacketState> override;
+    void restore_state(std::span<const StepperPacketState> state) override;
+private:
+    static auto factorize(size_t N, Scalar r) -> ThomasCoefficients;
+    void advance(Scalar* psi, size_t packet);
+    void explicit_y(const Scalar* in, Scalar* out, const ActiveWindow& window) const;
+    void explicit_x(const Scalar* in, Scalar* out, const ActiveWindow& window) const;
+    void implicit_x(Scalar* psi, const ActiveWindow& window) const;
+    void implicit_y(Scalar* psi, const ActiveWindow& window) const;
+    auto find_window(const Scalar* psi, const ActiveWindow& within, Real<Scalar> cutoff) const -> ActiveWindow;
+    auto discard_outside(Scalar* psi, const ActiveWindow& from, const ActiveWindow& kept) const -> double;
+};
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <iostream>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <span>
+#include <chrono>
+#include <atomic>
+#include "Eigen/SparseLU"
+#include "scalar_types.hpp"
+#include "obstacle_mask.hpp"
+#include "interface_time_stepper.hpp"
+#include "writer_queue.hpp"
+
+// State of a running simulation, enough to rebuild its equation and carry on from the step it was taken at:
+//      CheckpointHeader | wave numbers (float x wave_number_count) | stepper state (StepperPacketState x stepper_state_count)
+//      | obstacle (MaskSpan x obstacle_spans) | psi (packets x (Nx-2)*(Ny-2) values)
+// psi is kept in the precision of the run, bit for bit, and with it what the stepper derived from the initial state
+// (the active windows of ADI and their cutoff), so that a resumed run follows the same trajectory. The obstacle is the
+// barrier's pixel spans, whatever its geometry, so that a run started from a bitmap resumes without it. The header is checked
+// against its own checksum, the rest against payload_checksum: a torn or corrupted file is refused, never half restored.
+constexpr char CHECKPOINT_MAGIC[8] = {'D', 'S', 'L', 'I', 'T', 'C', 'K', 'P'};
+constexpr uint32_t CHECKPOINT_VERSION = 3;
+
+struct CheckpointHeader
+{
+    char magic[8]{};
+    uint32_t version{CHECKPOINT_VERSION};
+    uint32_t scalar_bytes{};        // of psi: 8 single precision, 16 double
+    uint64_t Nx{};
+    uint64_t Ny{};
+    uint64_t packets{};
+    uint64_t step{};
+    double time{};                  // simulated, the sum of the dt of every step
+    float Lx{};
+    float Ly{};
+    float dx{};
+    float dy{};
+    float dt{};                     // as handed to the builder, 0 for its default dx^2/4: rebuilt with the same rounding
+    float x0{};                     // initial state
+    float y0{};
+    float wave_number{};
+    float slit_thickness{};         // SimulationConfig fractions, as set
+    float slit_width{};
+    float slit_opening{};
+    uint32_t engine{};              // ENGINE
+    uint32_t eliminate_obstacle{};
+    uint32_t absorbing_thickness{};
+    float absorbing_strength{};
+    uint32_t wave_number_count{};   // of a batch, 0 for a single packet
+    float active_threshold{};       // ActivityOptions
+    uint32_t active_margin{};
+    uint32_t solver{};              // SolverOptions
+    uint32_t preconditioner{};
+    uint32_t ordering{};
+    float tolerance{};
+    uint32_t max_iterations{};
+    uint32_t stepper_state_count{}; // packets the stepper keeps a state for, 0 if stateless
+    uint64_t obstacle_spans{};      // spans of the barrier following the stepper state
+    uint64_t obstacle_key{};        // hash of the barrier's pixel spans: the geometry a restart must find again
+    uint64_t payload_checksum{};    // wave numbers, stepper state, obstacle and psi
+    uint64_t header_checksum{};     // every byte above
+};
+static_assert(sizeof(CheckpointHeader) == 184, "CheckpointHeader is written as is, its layout must not change");
+
+// Where a run stands
+struct CheckpointClock
+{
+    uint64_t step{};
+    double time{};
+};
+
+auto get_obstacle_key(const ObstacleMask& barrier) -> uint64_t;
+
+
+// A checkpoint file read and verified in full.
+class Checkpoint
+{
+    CheckpointHeader m_header{};
+    std::vector<float> m_wave_numbers{};
+    std::vector<StepperPacketState> m_stepper_state{};
+    std::vector<MaskSpan> m_obstacle_spans{};
+    std::vector<std::byte> m_psi{};
+public:
+    explicit Checkpoint(const std::string& path);   // throws std::runtime_error on a file that is not a valid checkpoint
+    auto get_header() const -> const CheckpointHeader& { return m_header; }
+    auto get_clock() const -> CheckpointClock { return {m_header.step, m_header.time}; }
+    auto get_wave_numbers() const -> std::span<const float> { return m_wave_numbers; }
+    auto get_stepper_state() const -> std::span<const StepperPacketState> { return m_stepper_state; }
+    auto get_obstacle() const -> ObstacleMask;      // the barrier the run was taken with
+    template<typename Scalar>
+    auto get_psi() const -> VectorX<Scalar>;        // throws if the run was in the other precision
+    void check_geometry(size_t Nx, size_t Ny, size_t packets, const ObstacleMask& barrier) const;  // throws on a mismatch
+};
+
+
+// Writes checkpoints from a background thread: save() only copies psi into the one buffer, the writer thread
+// checksums it and writes a temporary file, flushed to the disk and renamed over the previous checkpoint, so the file on disk is always whole.
+// A save() arriving while the previous checkpoint is still being written waits for it.
+class CheckpointWriter
+{
+    struct State
+    {
+        CheckpointHeader header{};
+        std::vector<StepperPacketState> stepper_state{};
+        std::vector<std::byte> psi{};
+    };
+    std::string m_path{};
+    CheckpointHeader m_header{};            // caller side: copied into the buffer by save()
+    std::vector<float> m_wave_numbers{};
+    std::vector<MaskSpan> m_obstacle_spans{};
+    size_t m_psi_bytes{};
+    std::chrono::steady_clock::duration m_interval{};
+    std::chrono::steady_clock::time_point m_last_save{};
+    std::atomic<size_t> m_written{};
+    std::string m_error{};                  // failure of the last write, reported by close()
+    WriterQueue<State> m_queue{};           // a single buffer; last: its thread is joined before the members it writes through go
+public:
+    // header: the build parameters, the clock and checksums being filled by save()
+    explicit CheckpointWriter(const std::string& path, const CheckpointHeader& header, const ObstacleMask& barrier,
+                              std::span<const float> wave_numbers, std::chrono::duration<float> interval);
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+    ~CheckpointWriter();
+    bool is_due() const { return m_interval.count() > 0 && std::chrono::steady_clock::now() - m_last_save >= m_interval; }
+    void set_time_step(float dt);           // after a retime, for the checkpoints that follow
+    template<typename Scalar>
+    void save(const VectorX<Scalar>& psi, std::span<const StepperPacketState> stepper_state, const CheckpointClock& clock);  // every packet
+    void close();                           // waits for the last checkpoint, throws std::runtime_error if a write failed
+    size_t get_stalls() const { return m_queue.get_stalls(); }
+    size_t get_written() const { return m_written.load(); }
+    auto get_path() const -> const std::string& { return m_path; }
+private:
+    void write(const State& state);
+};
+
+#endif
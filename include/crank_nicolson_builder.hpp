@@ -2,29 +2,37 @@
 #define CN_MANAGER_HPP
 
 #include <iostream>
+#include <vector>
+#include <optional>
 #include "Eigen/SparseLU"
 #include "interface_matrix_builder.hpp"
-using SparseMatrix = Eigen::SparseMatrix<std::complex<float>>;
 
  
-class CrankNicolsonBuilder : public IMatrixBuilder
+template<typename Scalar>
+class CrankNicolsonBuilder : public IMatrixBuilder<Scalar>
 {
-    std::complex<float> m_a0{};
-    std::complex<float> m_b0{};
-    std::complex<float> m_rx{};
-    std::complex<float> m_ry{};
+    Scalar m_a0{};
+    Scalar m_b0{};
+    Scalar m_rx{};
+    Scalar m_ry{};
     size_t N_center{};
     size_t m_Nx{};
     size_t m_Ny{};
+    std::optional<FreeCellMap> m_free_cells{};
+    VectorX<Scalar> m_absorption{};     // dt/2 W of an absorbing layer, none if empty
 public:
     explicit CrankNicolsonBuilder();
     void set_num_elements(size_t Nx, size_t Ny) override;
-    void set_diagonal_elements(std::complex<float> a0, std::complex<float> b0) override; // define
-    void set_off_diag_elements(std::complex<float> rx, std::complex<float> ry) override;
-    auto get_sparse_matrices() const -> std::tuple<SparseMatrix,SparseMatrix>  override;
+    void set_diagonal_elements(Scalar a0, Scalar b0) override; // define
+    void set_off_diag_elements(Scalar rx, Scalar ry) override;
+    void set_free_cells(const FreeCellMap& free_cells) override;
+    void set_absorption(const VectorX<Scalar>& absorption) override;
+    auto get_sparse_matrices() const -> std::tuple<SparseMatrix<Scalar>,SparseMatrix<Scalar>>  override;
+    auto get_sparse_A() const -> SparseMatrix<Scalar> override;
 private:
-    void init_dense_matrices(Eigen::MatrixXcf& A, Eigen::MatrixXcf& M) const;
-    void set_dense_matrices(Eigen::MatrixXcf& A, Eigen::MatrixXcf& M) const;
+    void check_sizes() const;
+    size_t get_unknowns() const { return m_free_cells? m_free_cells->size() : N_center; }
+    void set_triplets(std::vector<Eigen::Triplet<Scalar>>& A, std::vector<Eigen::Triplet<Scalar>>* M) const;    // M skipped if null
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,43 @@
+#ifndef CN_STEPPER_HPP
+#define CN_STEPPER_HPP
+
+#include <iostream>
+#include <memory>
+#include <optional>
+#include "Eigen/SparseLU"
+#include "interface_time_stepper.hpp"
+#include "interface_linear_solver.hpp"
+#include "stencil_operator.hpp"
+#include "obstacle_mask.hpp"
+
+// Crank-Nicolson engine: A psi(t+dt) = M psi(t), solved globally by a pluggable linear solver (sparse LU, Krylov...).
+// The right hand side M psi(t) is applied matrix free by the stencil operator,
+// and the current psi is handed to the solver as the initial guess.
+// Given the free cells of an obstacle, A only spans those: the right hand side and the guess are gathered into
+// compact vectors around the solve and the result scattered back, obstacle cells of psi staying at zero.
+template<typename Scalar>
+class CrankNicolsonStepper : public ITimeStepper<Scalar>
+{
+    std::unique_ptr<ILinearSolver<Scalar>> m_solver{};
+    StencilOperator<Scalar> m_stencil_M{};
+    VectorX<Scalar> m_psi_temp{};
+    std::optional<FreeCellMap> m_free_cells{};
+    VectorX<Scalar> m_rhs{};
+    VectorX<Scalar> m_solution{};
+    MatrixX<Scalar> m_block_temp{};         // step_batch() counterparts of the vectors above
+    MatrixX<Scalar> m_block_rhs{};
+    MatrixX<Scalar> m_block_solution{};
+public:
+    explicit CrankNicolsonStepper(const SparseMatrix<Scalar>& sparse_A, const StencilOperator<Scalar>& stencil_M, std::unique_ptr<ILinearSolver<Scalar>> solver,
+                                  std::optional<FreeCellMap> free_cells = std::nullopt);
+    explicit CrankNicolsonStepper(const StencilOperator<Scalar>& stencil_M, std::unique_ptr<ILinearSolver<Scalar>> computed_solver,    // A already computed
+                                  std::optional<FreeCellMap> free_cells = std::nullopt);
+    // new coefficients over the same pattern of A (a change of dt): the solver keeps what only depends on the pattern
+    void refactorize(const SparseMatrix<Scalar>& sparse_A, const StencilOperator<Scalar>& stencil_M);
+    void step(VectorX<Scalar>& psi) override;
+    void step_batch(Eigen::Map<MatrixX<Scalar>> psi) override;  // one block solve for all the packets
+    size_t get_iterations() const override;
+    bool eliminates_obstacle() const override { return m_free_cells.has_value(); }
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef DETECTOR_SCREEN_HPP
+#define DETECTOR_SCREEN_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Eigen/SparseLU"
+#include "scalar_types.hpp"
+
+// Rectangle of interior grid cells, in grid indices: columns x0 .. x0+width-1, rows y0 .. y0+height-1.
+struct DetectorRegion
+{
+    size_t x0{};
+    size_t y0{};
+    size_t width{1};
+    size_t height{1};
+};
+
+// Time integrated observables over a few detector regions behind the interferometer, accumulated after every step
+// in place of full-field snapshots: a cost per step and an output proportional to the detector cells only.
+//      intensity   sum over the steps of |psi|^2 dt, per cell: the interference pattern on the screen
+//      current     sum over the steps of j_x dt, j_x = 2 Im(conj(psi) dpsi/dx) for H = -laplacian (hbar = 1, m = 1/2),
+//                  central differences with psi = 0 on the boundary: the probability crossing the screen, optional
+// Every packet of a batched psi has its own buffers.
+class DetectorScreen
+{
+    struct Detector
+    {
+        DetectorRegion region{};
+        std::vector<double> intensity{};    // column major over the region, packets back to back
+        std::vector<double> current{};
+    };
+    size_t m_Nx{};
+    size_t m_Ny{};
+    float m_dx{};
+    float m_dt{};
+    bool m_track_current{};
+    size_t m_packets{};
+    size_t m_steps{};
+    std::vector<Detector> m_detectors{};
+public:
+    explicit DetectorScreen(size_t Nx, size_t Ny, float dx, float dt, bool track_current = false);
+    void add_region(const DetectorRegion& region);      // throws unless the region lies in the interior
+    void add_column(size_t x);                          // the whole screen column x
+    template<typename Scalar>
+    void accumulate(const VectorX<Scalar>& psi);        // psi: one or more packets back to back
+    void write(const std::string& path) const;          // CSV of the accumulated values, replaced atomically
+    size_t get_cell_count() const;
+    size_t get_steps() const { return m_steps; }
+};
+
+#endif
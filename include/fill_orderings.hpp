@@ -0,0 +1,59 @@
+#ifndef FILL_ORDERINGS_HPP
+#define FILL_ORDERINGS_HPP
+
+#include <iostream>
+#include <span>
+#include <vector>
+#include <type_traits>
+#include "Eigen/SparseLU"
+
+// Column orderings for Eigen's SparseLU next to its COLAMD and AMD, as functors of its OrderingType parameter.
+// As Eigen's, they give the position perm.indices()(j) of the column j of A in A Pc.
+
+// Elimination order of the vertices of a graph given by its symmetric adjacency (CSR, self loops ignored):
+// order[k] is the vertex eliminated k-th. Recursive bisection by breadth-first level structures from a
+// pseudo-peripheral vertex, each separator ordered after both of its halves. Works on any graph, so on the
+// grid with an eliminated obstacle as well, where it finds the short cuts a 2D grid has.
+auto get_nested_dissection(std::span<const int> outer, std::span<const int> inner) -> std::vector<int>;
+
+// The column major order of psi, spelled out: the 5-point matrix is then banded, of half bandwidth Ny-2.
+// Eigen's NaturalOrdering returns an empty permutation, which SparseLU does not combine with its elimination tree postorder.
+template<typename StorageIndex>
+class BandOrdering
+{
+public:
+    using PermutationType = Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, StorageIndex>;
+
+    template<typename MatrixType>
+    void operator()(const MatrixType& mat, PermutationType& perm)
+    {
+        perm.resize(mat.cols());
+        perm.setIdentity();
+    }
+};
+
+template<typename StorageIndex>
+class NestedDissectionOrdering
+{
+public:
+    using PermutationType = Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, StorageIndex>;
+
+    template<typename MatrixType>
+    void operator()(const MatrixType& mat, PermutationType& perm)
+    {
+        static_assert(std::is_same_v<StorageIndex, int>, "nested dissection works on int indices");
+        Eigen::SparseMatrix<typename MatrixType::Scalar, Eigen::ColMajor, StorageIndex> symmetric{};
+        Eigen::internal::ordering_helper_at_plus_a(mat, symmetric);
+        symmetric.makeCompressed();
+
+        const Eigen::Index n = symmetric.cols();
+        const auto order = get_nested_dissection(std::span(symmetric.outerIndexPtr(), n+1), std::span(symmetric.innerIndexPtr(), symmetric.nonZeros()));
+        perm.resize(n);
+        for (Eigen::Index k = 0; k < n; k++)
+        {
+            perm.indices()(order[k]) = static_cast<StorageIndex>(k);
+        }
+    }
+};
+
+#endif
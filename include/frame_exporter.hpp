@@ -0,0 +1,101 @@
+#ifndef FRAME_EXPORTER_HPP
+#define FRAME_EXPORTER_HPP
+
+#include <iostream>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <array>
+#include <fstream>
+#include <atomic>
+#include "Eigen/SparseLU"
+#include "scalar_types.hpp"
+#include "obstacle_mask.hpp"
+#include "framebuffer.hpp"
+#include "writer_queue.hpp"
+
+// Video export of a run: |psi| with the barrier painted over, scaled to width x height (nearest grid point) and colored
+// through a colormap, each frame scaled to its own max as in the viewer.
+//      Y4M     path ending in .y4m: a single YUV4MPEG2 4:2:0 full range stream (ffmpeg -i run.y4m run.mp4), width and height rounded up to even
+//      PPM     any other path, as a prefix: one binary P6 image per frame named by its step, path000010.ppm, path000020.ppm, ...
+enum class EXPORT_FORMAT
+{
+    Y4M,
+    PPM,
+};
+enum class COLORMAP
+{
+    VIEWER,     // the viewer's wave color blended over its background
+    GRAYSCALE,
+    HEAT,       // black, red, yellow, white
+};
+// What push() does when all the frame buffers are still queued for the writer
+enum class EXPORT_POLICY
+{
+    BLOCK,      // waits for one: every frame is kept, the solver runs at the pace of the disk
+    DROP,       // drops the frame: the solver never waits, the video skips
+};
+
+struct ExportOptions
+{
+    std::string path{};             // no export if empty
+    size_t width{};                 // of the frames, Nx x Ny if 0
+    size_t height{};
+    COLORMAP colormap{COLORMAP::VIEWER};
+    EXPORT_POLICY policy{EXPORT_POLICY::BLOCK};
+    size_t every{1};                // steps between two exported frames
+    size_t fps{30};                 // Y4M frame rate
+    size_t queue_depth{4};          // frame buffers, in flight between the solver and the writer
+
+    bool is_enabled() const { return !path.empty(); }
+    auto get_format() const -> EXPORT_FORMAT { return path.ends_with(".y4m")? EXPORT_FORMAT::Y4M : EXPORT_FORMAT::PPM; }
+};
+
+// Exports frames from a background thread, as SnapshotWriter records them: push() only copies psi into a free buffer
+// of a pool sized once, the modulus, scaling, coloring and disk write all happen on the writer thread.
+// The frame buffers, the pixel buffer and the color tables are all sized once: only a PPM file is opened per frame.
+class FrameExporter
+{
+    struct Frame
+    {
+        uint64_t step{};
+        Eigen::VectorXcf psi{};
+    };
+    ExportOptions m_options{};
+    EXPORT_FORMAT m_format{};
+    size_t m_Nx{};
+    size_t m_Ny{};
+    std::ofstream m_file{};                 // the Y4M stream
+    std::atomic<size_t> m_dropped{};
+    std::atomic<size_t> m_frames_written{};
+    std::string m_error{};                  // first write failure of the writer thread, reported by close()
+    // writer thread only
+    std::vector<MaskSpan> m_barrier{};      // over the Nx x Ny image
+    std::vector<uint32_t> m_source{};       // grid point (iy*Nx + jx) of every pixel, row major
+    std::vector<uint16_t> m_level{};        // Nx x Ny colormap index: walls at 0, the barrier at BARRIER_LEVEL
+    std::array<Rgba, 257> m_palette{};      // 256 levels of |psi|/max, then the barrier
+    std::array<std::array<uint8_t, 3>, 257> m_yuv{};    // the palette in full range BT.601 Y, Cb, Cr
+    std::vector<char> m_buffer{};           // encoded frame: its header, then the pixels from m_pixel_offset
+    size_t m_pixel_offset{};
+    WriterQueue<Frame> m_queue{};           // last: its thread is joined before the members it writes through go
+public:
+    explicit FrameExporter(const ExportOptions& options, size_t Nx, size_t Ny, const ObstacleMask& barrier,
+                           const FramebufferStyle& style = {});
+    FrameExporter(const FrameExporter&) = delete;
+    FrameExporter& operator=(const FrameExporter&) = delete;
+    ~FrameExporter();
+    template<typename Scalar>
+    bool push(const Eigen::Ref<const VectorX<Scalar>>& psi, uint64_t step);     // false if dropped
+    void close();                           // drains the queue and flushes the stream, throws std::runtime_error if a write failed
+    size_t get_stalls() const { return m_queue.get_stalls(); }
+    size_t get_dropped() const { return m_dropped.load(); }
+    size_t get_frames_written() const { return m_frames_written.load(); }
+    size_t get_width() const { return m_options.width; }
+    size_t get_height() const { return m_options.height; }
+private:
+    void export_frame(const Frame& frame);
+    void encode(const Frame& frame);
+    void write(uint64_t step);
+};
+
+#endif
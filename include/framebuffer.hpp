@@ -0,0 +1,31 @@
+#ifndef FRAMEBUFFER_HPP
+#define FRAMEBUFFER_HPP
+
+#include <iostream>
+#include <cstdint>
+#include <span>
+#include "obstacle_mask.hpp"
+
+// 8-bit RGBA pixel, same layout as raylib's Color so the buffer can be uploaded as is.
+struct Rgba
+{
+    uint8_t r{};
+    uint8_t g{};
+    uint8_t b{};
+    uint8_t a{};
+};
+
+struct FramebufferStyle
+{
+    Rgba background{30, 30, 30, 255};
+    Rgba wave{255, 100, 100, 255};      // color at |psi| = vmax, blended over the background in proportion to |psi|/vmax
+    Rgba barrier{245, 245, 245, 255};
+};
+
+// Converts the interior modulus |psi| (column major, (Ny-2)x(Nx-2)) to an Nx x Ny row major RGBA image,
+// one pixel per grid point, walls in the background color and the barrier (ObstacleMask::get_pixel_spans) painted on top.
+// Pure function of its inputs, columns are spread over threads.
+void build_framebuffer(std::span<const float> modulus, float vmax, std::span<const MaskSpan> barrier,
+                       size_t Nx, size_t Ny, const FramebufferStyle& style, std::span<Rgba> pixels);
+
+#endif
@@ -9,24 +9,25 @@
 #endif
 
 
-class GaussianWfBuilder : public IWaveFunctionBuilder
+template<typename Scalar>
+class GaussianWfBuilder : public IWaveFunctionBuilder<Scalar>
 {
     float m_sigma {0.5};
-    float m_k     {15*PI};
+    float m_k     {DEFAULT_WAVE_NUMBER};
     float m_Lx{};
     float m_Ly{};
     float m_x0{};
     float m_y0{};
-    Eigen::MatrixXcf m_psi{};
 public:
     GaussianWfBuilder() = default;
     void set_system_size(float Lx, float Ly) override;
     void set_initial_pos(float x0, float y0) override;
     void set_deviation(float sigma) override;
-    auto build_wavefunction(size_t N_y, size_t N_x) const -> Eigen::Reshaped<Eigen::MatrixXcf, -1, 1>  override;  
+    void set_wave_number(float k) override;
+    auto build_wavefunction(size_t N_y, size_t N_x) const -> VectorX<Scalar>  override;  
 private:
-    void init_wavefunction(Eigen::MatrixXcf& Psi) const;
-    void zero_out_boundary(Eigen::MatrixXcf& Psi) const;
+    void init_wavefunction(MatrixX<Scalar>& Psi) const;
+    void zero_out_boundary(MatrixX<Scalar>& Psi) const;
 };
 
 #endif
\ No newline at end of file
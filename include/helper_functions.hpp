@@ -1,6 +1,14 @@
 #ifndef GET_SIZE_HPP
 #define GET_SIZE_HPP
 #include <iostream>
+#include <complex>
+
+// Plain 2D vector of the physical parameters (system size, step, position), so the solver side does not depend on raylib.
+struct Vec2f
+{
+    float x{};
+    float y{};
+};
 
 constexpr inline size_t get_num_elements(float low, float high, float step)
 {
@@ -13,11 +21,29 @@ template<typename T>
 concept has_size = requires(T matrix)
 {
     {matrix.size()} -> std::convertible_to<size_t>;
+    typename T::Scalar;
 };
 size_t get_size(const has_size auto& matrix)
 {
-    auto size = static_cast<float>(matrix.size()*sizeof(std::complex<float>));
-    return static_cast<size_t>(size);
+    using Scalar = typename std::remove_cvref_t<decltype(matrix)>::Scalar;
+    return static_cast<size_t>(matrix.size())*sizeof(Scalar);
+}
+
+// Compressed sparse matrices: their size() is rows*cols, what they hold is the values, inner indices and outer starts
+template<typename T>
+concept has_sparse_size = has_size<T> && requires(T matrix)
+{
+    {matrix.nonZeros()} -> std::convertible_to<size_t>;
+    {matrix.outerSize()} -> std::convertible_to<size_t>;
+    {matrix.outerIndexPtr()};
+    typename T::StorageIndex;
+};
+size_t get_size(const has_sparse_size auto& matrix)
+{
+    using Matrix = std::remove_cvref_t<decltype(matrix)>;
+    using Index  = typename Matrix::StorageIndex;
+    return static_cast<size_t>(matrix.nonZeros())*(sizeof(typename Matrix::Scalar) + sizeof(Index))
+         + static_cast<size_t>(matrix.outerSize() + 1)*sizeof(Index);
 }
 
 #endif
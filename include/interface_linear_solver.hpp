@@ -0,0 +1,47 @@
+#ifndef ILINEAR_SOLVER_HPP
+#define ILINEAR_SOLVER_HPP
+
+#include <iostream>
+#include <memory>
+#include "Eigen/SparseLU"
+#include "scalar_types.hpp"
+
+class OperatorCacheWriter;
+class OperatorCacheEntry;
+
+// Solves A x = b for the fixed Crank-Nicolson matrix A.
+// On entry x holds the initial guess (the current psi), which iterative backends use as a warm start.
+template<typename Scalar>
+class ILinearSolver
+{
+public:
+    virtual void compute(const SparseMatrix<Scalar>& A) = 0;
+    // A with new values and the sparsity pattern of the last compute(), e.g. after a change of dt:
+    // what only depends on the pattern is kept by the backends that have such a setup.
+    virtual void refactorize(const SparseMatrix<Scalar>& A) { compute(A); }
+    virtual void solve(const VectorX<Scalar>& b, VectorX<Scalar>& x) = 0;
+    // A X = B for a block of right hand sides, one per column. Column by column unless the backend can do better.
+    virtual void solve_batch(const MatrixX<Scalar>& B, MatrixX<Scalar>& X)
+    {
+        VectorX<Scalar> b{}, x{};
+        for (Eigen::Index k = 0; k < B.cols(); k++)
+        {
+            b = B.col(k);
+            x = X.col(k);
+            solve(b, x);
+            X.col(k) = x;
+        }
+    }
+    virtual size_t get_iterations() const = 0;  // of the last solve, 0 for direct solvers
+    virtual float get_error() const = 0;        // relative residual of the last solve, 0 for direct solvers
+    // Factorization persistence (operator_cache.hpp), for the backends that can restore it without recomputing:
+    // save() adds the computed state to a cache entry, load() replaces compute(A) and returns false when unsupported.
+    virtual void save(OperatorCacheWriter&) const {}
+    virtual bool load(const SparseMatrix<Scalar>&, const OperatorCacheEntry&) { return false; }
+    // Another solver over the same computed state, usable from another thread while this one solves (operator_pool.hpp).
+    // nullptr for the backends whose setup is not worth sharing or cannot be shared: the caller sets up its own.
+    virtual auto share() const -> std::unique_ptr<ILinearSolver<Scalar>> { return nullptr; }
+    virtual ~ILinearSolver() = default;
+};
+
+#endif
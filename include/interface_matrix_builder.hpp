@@ -3,19 +3,23 @@
 
 #include <iostream>
 #include "Eigen/SparseLU"
+#include "scalar_types.hpp"
+#include "obstacle_mask.hpp"
 
-using SparseMatrix = Eigen::SparseMatrix<std::complex<float>>;
-
+template<typename Scalar>
 class IMatrixBuilder
 {
 public:
     virtual void set_num_elements(size_t Nx, size_t Ny) = 0;
-    virtual void set_diagonal_elements(std::complex<float> a0, std::complex<float> b0) = 0;
-    virtual void set_off_diag_elements(std::complex<float> rx, std::complex<float> ry) = 0;
-    virtual auto get_sparse_matrices() const -> std::tuple<SparseMatrix,SparseMatrix> = 0;
+    virtual void set_diagonal_elements(Scalar a0, Scalar b0) = 0;
+    virtual void set_off_diag_elements(Scalar rx, Scalar ry) = 0;
+    virtual void set_free_cells(const FreeCellMap& free_cells) = 0;    // assemble over these cells only, obstacles as Dirichlet zeros
+    virtual void set_absorption(const VectorX<Scalar>& absorption) = 0; // per interior cell, added to the diagonal of A and taken from that of M
+    virtual auto get_sparse_matrices() const -> std::tuple<SparseMatrix<Scalar>,SparseMatrix<Scalar>> = 0;
+    virtual auto get_sparse_A() const -> SparseMatrix<Scalar> = 0;     // A alone, for M applied matrix free
     virtual ~IMatrixBuilder() = default;
 };
 
  
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,39 @@
+#ifndef ISIMULATION_WORKER_HPP
+#define ISIMULATION_WORKER_HPP
+
+#include <iostream>
+#include <vector>
+
+enum class COMMAND
+{
+    PAUSE,
+    RESUME,
+    RESET,
+    LONGER_STEP,    // dt doubled
+    SHORTER_STEP,   // dt halved
+    CHECKPOINT,     // written now, if the worker has a checkpoint writer
+};
+
+// What the renderer needs from a time step, published as a whole.
+struct PublishedFrame
+{
+    std::vector<float> modulus{};
+    float max_modulus{};
+    double norm_drift{};
+    size_t step{};
+    size_t solver_iterations{};
+    float dt{};
+};
+
+// The renderer's side of a simulation running on its own thread, whatever the precision it runs in.
+class ISimulationWorker
+{
+public:
+    virtual void send(COMMAND command) = 0;
+    virtual bool acquire_frame() = 0;                               // true if a newer frame came in
+    virtual auto get_frame() const -> const PublishedFrame& = 0;
+    virtual float get_steps_per_second() const = 0;
+    virtual ~ISimulationWorker() = default;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef ITIME_STEPPER_HPP
+#define ITIME_STEPPER_HPP
+
+#include <iostream>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+#include "Eigen/SparseLU"
+#include "scalar_types.hpp"
+
+// Rectangle of interior cells a stepper restricts a packet to, psi being exactly zero outside of it:
+// columns x0 .. x0+width-1 and rows y0 .. y0+height-1 of the (Ny-2)x(Nx-2) psi, 0-based.
+struct ActiveWindow
+{
+    size_t x0{};
+    size_t y0{};
+    size_t width{};
+    size_t height{};
+    size_t get_cells() const { return width*height; }
+};
+
+// What a stepper derived from the psi it started on and needs to carry on exactly, for one packet: plain values,
+// written as is in checkpoints. The cutoff is kept in double, which holds a float one exactly.
+struct StepperPacketState
+{
+    uint64_t x0{};          // active window
+    uint64_t y0{};
+    uint64_t width{};
+    uint64_t height{};
+    double cutoff{};        // |psi|^2 of the activity threshold
+    double initial_norm{};
+    double discarded{};
+    uint64_t started{};
+};
+static_assert(sizeof(StepperPacketState) == 64, "StepperPacketState is written as is, its layout must not change");
+
+// Advances the interior wavefunction psi (column major, (Ny-2)x(Nx-2)) by one time step dt.
+// step_batch() advances K independent packets at once, psi being the (Ndof x K) block of them.
+template<typename Scalar>
+class ITimeStepper
+{
+public:
+    virtual void step(VectorX<Scalar>& psi) = 0;
+    virtual void step_batch(Eigen::Map<MatrixX<Scalar>> psi)
+    {
+        VectorX<Scalar> packet{};
+        for (Eigen::Index k = 0; k < psi.cols(); k++)
+        {
+            packet = psi.col(k);
+            step(packet);
+            psi.col(k) = packet;
+        }
+    }
+    virtual size_t get_iterations() const = 0;  // linear solver iterations of the last step, 0 for direct solves
+    virtual bool eliminates_obstacle() const { return false; }  // obstacle cells kept at zero by the step itself
+    virtual auto get_active_window(size_t /*packet*/) const -> std::optional<ActiveWindow> { return std::nullopt; }   // whole grid if none
+    virtual double get_discarded_probability() const { return 0.0; }    // fraction of a packet's norm dropped outside its window, the worst packet
+    virtual void restart() {}                                           // psi replaced: forget what was derived from the previous one
+    virtual auto save_state() const -> std::vector<StepperPacketState> { return {}; }  // what was derived from psi, none if stateless
+    virtual void restore_state(std::span<const StepperPacketState> /*state*/) {}        // from save_state() of a stepper built alike
+    virtual ~ITimeStepper() = default;
+};
+
+#endif
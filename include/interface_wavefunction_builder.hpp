@@ -2,15 +2,21 @@
 #define IWF_BUILDER_HPP
 #include <iostream>
 #include "Eigen/SparseLU" 
+#include <numbers>
+#include "scalar_types.hpp"
 
+constexpr float DEFAULT_WAVE_NUMBER = 15*std::numbers::pi_v<float>;
+
+template<typename Scalar>
 class IWaveFunctionBuilder
 {
 public:
     virtual void set_system_size(float Lx, float Ly) = 0;
     virtual void set_initial_pos(float x0, float y0) = 0;
     virtual void set_deviation(float sigma) = 0;
-    virtual auto build_wavefunction(size_t N_y, size_t N_x) const -> Eigen::Reshaped<Eigen::MatrixXcf, -1, 1> = 0;  
+    virtual void set_wave_number(float k) = 0;
+    virtual auto build_wavefunction(size_t N_y, size_t N_x) const -> VectorX<Scalar> = 0;  
 };
  
 
-#endif
\ No newline at end of file
+#endif
@@ -2,8 +2,11 @@
 #define INTERFERRO_HPP
 
 #include <iostream>
-#include "raylib.h"
+#include <vector>
+#include <cstdint>
 #include "Eigen/SparseLU"
+#include "scalar_types.hpp"
+#include "obstacle_mask.hpp"
 struct Point
 {
     size_t x{};
@@ -22,13 +25,16 @@ struct Interferometer
     Point m_mid_point{};
     Point m_start{};
     Point m_slit_pt{};
+    ObstacleMask m_mask{};
 
     Interferometer(size_t Nx, size_t Ny);
-    void set_param(size_t thickness, size_t width, size_t height);
-    void activate_interaction(Eigen::VectorXcf& psi) const;
-    void draw(const RenderTexture2D& tile, Point start, size_t y, size_t x) const;
+    void set_param(size_t thickness, size_t width, size_t height);  // symmetric double slit
+    void set_mask(ObstacleMask mask);                               // any other geometry, the slit parameters are cleared
+    template<typename Scalar>
+    void activate_interaction(VectorX<Scalar>& psi) const;
+    auto get_mask() const -> const ObstacleMask& { return m_mask; }
 private:
-    static void zero_out(Eigen::VectorXcf& vec, size_t iy, size_t jx, size_t Ny);
+    auto rasterize() const -> std::vector<uint8_t>;                 // Nx x Ny row major, 1 on the barrier
 };
 
-#endif
\ No newline at end of file
+#endif
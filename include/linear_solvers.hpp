@@ -0,0 +1,109 @@
+#ifndef LINEAR_SOLVERS_HPP
+#define LINEAR_SOLVERS_HPP
+
+#include <iostream>
+#include <memory>
+#include "Eigen/SparseLU"
+#include "Eigen/IterativeLinearSolvers"
+#include "interface_linear_solver.hpp"
+#include "operator_cache.hpp"
+#include "fill_orderings.hpp"
+
+enum class SOLVER
+{
+    SPARSE_LU,  // direct, factorized once
+    BICGSTAB,   // Krylov, general complex matrices
+    COCG,       // Krylov, complex symmetric matrices (A^T = A), one product per iteration
+};
+enum class PRECONDITIONER
+{
+    DIAGONAL,   // Jacobi
+    ILUT,       // incomplete LU with threshold, BiCGSTAB only
+};
+enum class ORDERING
+{
+    COLAMD,             // Eigen's default for SparseLU
+    AMD,                // approximate minimum degree of A + A^T
+    NATURAL,            // column major grid order, banded
+    NESTED_DISSECTION,  // fill_orderings.hpp
+};
+struct SolverOptions
+{
+    SOLVER solver{SOLVER::SPARSE_LU};
+    PRECONDITIONER preconditioner{PRECONDITIONER::DIAGONAL};
+    ORDERING ordering{ORDERING::COLAMD};    // column ordering of the sparse LU
+    float tolerance{1e-6f};
+    size_t max_iterations{200};
+};
+
+template<typename Scalar>
+auto make_linear_solver(const SolverOptions& options) -> std::unique_ptr<ILinearSolver<Scalar>>;
+
+
+// Eigen's SparseLU, whose factors can be written to and restored from an operator cache entry.
+// They are saved in Eigen's own supernodal layout, hence the Eigen version recorded in the entries.
+// The symbolic analysis (ordering and elimination tree) of one can be taken over by another for a matrix of the same pattern.
+template<typename Scalar, typename Ordering = Eigen::COLAMDOrdering<int>>
+class PersistentSparseLU : public Eigen::SparseLU<SparseMatrix<Scalar>, Ordering>
+{
+public:
+    void save(OperatorCacheWriter& writer) const;
+    void load(const SparseMatrix<Scalar>& A, const OperatorCacheEntry& entry);
+    bool has_analysis(Eigen::Index n) const { return this->m_analysisIsOk && this->m_etree.size() == n; }  // not restored by load()
+    void adopt_analysis(const PersistentSparseLU& other);
+    size_t get_factor_nonzeros() const { return static_cast<size_t>(this->m_nnzL + this->m_nnzU); }    // fill of L + U
+};
+
+// The factors are held through a shared_ptr: share() hands them to other solvers without a copy, the triangular
+// solves only reading them. compute(), refactorize() and load() replace them with new factors, never modifying the shared ones.
+template<typename Scalar, typename Ordering = Eigen::COLAMDOrdering<int>>
+class SparseLUSolver : public ILinearSolver<Scalar>
+{
+    std::shared_ptr<PersistentSparseLU<Scalar, Ordering>> m_solver{std::make_shared<PersistentSparseLU<Scalar, Ordering>>()};
+public:
+    void compute(const SparseMatrix<Scalar>& A) override;
+    void refactorize(const SparseMatrix<Scalar>& A) override;  // numerical factorization only, over the current analysis
+    void solve(const VectorX<Scalar>& b, VectorX<Scalar>& x) override;
+    void solve_batch(const MatrixX<Scalar>& B, MatrixX<Scalar>& X) override;    // one sweep of the supernodes for all columns
+    size_t get_iterations() const override { return 0; }
+    float get_error() const override { return 0; }
+    void save(OperatorCacheWriter& writer) const override { m_solver->save(writer); }
+    bool load(const SparseMatrix<Scalar>& A, const OperatorCacheEntry& entry) override;
+    auto share() const -> std::unique_ptr<ILinearSolver<Scalar>> override;
+};
+
+// Iterative backends keep their own copy of A: Eigen's solvers only reference the matrix they were computed on.
+template<typename Scalar, typename Preconditioner>
+class BiCGSTABSolver : public ILinearSolver<Scalar>
+{
+    SparseMatrix<Scalar> m_A{};
+    Eigen::BiCGSTAB<SparseMatrix<Scalar>, Preconditioner> m_solver{};
+public:
+    explicit BiCGSTABSolver(float tolerance, size_t max_iterations);
+    void compute(const SparseMatrix<Scalar>& A) override;
+    void solve(const VectorX<Scalar>& b, VectorX<Scalar>& x) override;
+    size_t get_iterations() const override { return m_solver.iterations(); }
+    float get_error() const override { return m_solver.error(); }
+};
+
+// Conjugate Orthogonal Conjugate Gradient: CG with the unconjugated bilinear form x^T y,
+// valid because the Crank-Nicolson matrix is complex symmetric. Jacobi preconditioned.
+template<typename Scalar>
+class COCGSolver : public ILinearSolver<Scalar>
+{
+    SparseMatrix<Scalar> m_A{};
+    VectorX<Scalar> m_inv_diag{};
+    VectorX<Scalar> m_r{}, m_z{}, m_p{}, m_q{};
+    float m_tolerance{};
+    size_t m_max_iterations{};
+    size_t m_iterations{};
+    float m_error{};
+public:
+    explicit COCGSolver(float tolerance, size_t max_iterations);
+    void compute(const SparseMatrix<Scalar>& A) override;
+    void solve(const VectorX<Scalar>& b, VectorX<Scalar>& x) override;
+    size_t get_iterations() const override { return m_iterations; }
+    float get_error() const override { return m_error; }
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <iostream>
+#include <cstddef>
+#include <string>
+
+enum class ACCESS_PATTERN
+{
+    SEQUENTIAL,     // read front to back, the OS may read ahead aggressively
+    RANDOM,
+};
+
+// Read-only memory mapping of a whole file: mmap, or a file mapping on Windows.
+// Pages are only read from disk when first touched.
+class MappedFile
+{
+    const std::byte* m_data{};
+    size_t m_bytes{};
+#ifdef _WIN32
+    void* m_file_handle{};
+    void* m_mapping_handle{};
+#endif
+public:
+    explicit MappedFile(const std::string& path, ACCESS_PATTERN pattern = ACCESS_PATTERN::SEQUENTIAL);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+    auto data() const -> const std::byte* { return m_data; }
+    size_t size() const { return m_bytes; }
+private:
+    void release();
+};
+
+// Name of a temporary file beside path, unique to the calling process and thread: written then renamed over path,
+// so that two writers of the same file never share their temporary.
+auto get_temporary_path(const std::string& path) -> std::string;
+
+// Flushes a written and closed file to the disk, before it is renamed over the one it replaces: without it the rename
+// may reach the disk first and a crash leave an empty file in place of both. Throws std::runtime_error on failure.
+void sync_file(const std::string& path);
+// Flushes the entries of the directory holding path, the rename included. A no-op on Windows.
+void sync_directory(const std::string& path);
+
+#endif
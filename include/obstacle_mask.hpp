@@ -0,0 +1,70 @@
+#ifndef OBSTACLE_MASK_HPP
+#define OBSTACLE_MASK_HPP
+
+#include <iostream>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <span>
+#include "Eigen/SparseLU"
+#include "scalar_types.hpp"
+#include "split_field.hpp"
+
+// Run of consecutive masked indices [begin, begin + length).
+struct MaskSpan
+{
+    uint32_t begin{};
+    uint32_t length{};
+};
+
+// Obstacle geometry compiled once into runs of consecutive indices, in the two layouts it is used in:
+// over psi (interior (Ny-2)x(Nx-2), column major), zeroed every step, and over the Nx x Ny row major
+// image, painted over the framebuffer. Neither use has to test cells one by one.
+class ObstacleMask
+{
+    std::vector<MaskSpan> m_psi_spans{};
+    std::vector<MaskSpan> m_pixel_spans{};
+    size_t m_psi_count{};
+    size_t m_psi_size{};    // (Nx-2)*(Ny-2)
+public:
+    ObstacleMask() = default;
+    explicit ObstacleMask(size_t Nx, size_t Ny, std::span<const uint8_t> cells);    // cells: Nx x Ny row major, != 0 on an obstacle
+    template<typename Scalar>
+    void apply(VectorX<Scalar>& psi) const;                                         // psi: one or more packets back to back
+    template<typename Scalar>
+    void apply(SplitField<Scalar>& psi) const;                                      // a run carrying on into the next column is cut there
+    auto get_psi_spans()   const -> std::span<const MaskSpan> { return m_psi_spans; }
+    auto get_pixel_spans() const -> std::span<const MaskSpan> { return m_pixel_spans; }
+    size_t get_psi_count() const { return m_psi_count; }   // interior cells covered
+};
+
+// Compact numbering of the interior cells left free by an obstacle, for a linear system assembled over them only.
+// The free cells are kept as runs of psi indices too, so going between the two layouts is a few block copies.
+class FreeCellMap
+{
+    std::vector<MaskSpan> m_free_spans{};   // over psi, column major
+    std::vector<int32_t> m_compact{};       // psi index -> compact index, -1 on an obstacle
+    size_t m_size{};
+public:
+    FreeCellMap() = default;
+    explicit FreeCellMap(size_t N, const ObstacleMask& obstacle);
+    size_t size() const { return m_size; }
+    size_t get_full_size() const { return m_compact.size(); }
+    int32_t get_compact_index(size_t k) const { return m_compact[k]; }
+    template<typename Scalar>
+    void gather(const VectorX<Scalar>& full, VectorX<Scalar>& compact) const;
+    template<typename Scalar>
+    void scatter(const VectorX<Scalar>& compact, VectorX<Scalar>& full) const;  // obstacle cells of full are left as they are
+    // Same, for a block of packets (one per column): each run is copied across all the columns at once.
+    template<typename Scalar>
+    void gather_columns(const Eigen::Ref<const MatrixX<Scalar>>& full, MatrixX<Scalar>& compact) const;
+    template<typename Scalar>
+    void scatter_columns(const MatrixX<Scalar>& compact, Eigen::Ref<MatrixX<Scalar>> full) const;
+};
+
+// Reads an obstacle bitmap and resamples it (nearest neighbour) to Nx x Ny, the first row at the top of the screen:
+//      .pgm    P2 or P5 grayscale, pixels darker than maxval/2 are obstacles
+//      other   text grid, one line per row, '#', 'X' or '1' is an obstacle, any other character is free
+auto load_obstacle_mask(const std::string& path, size_t Nx, size_t Ny) -> ObstacleMask;
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef OPERATOR_CACHE_HPP
+#define OPERATOR_CACHE_HPP
+
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <span>
+#include <memory>
+#include "Eigen/SparseLU"
+#include "scalar_types.hpp"
+#include "mapped_file.hpp"
+
+// On-disk cache of what a Crank-Nicolson run sets up before its first step: the assembled A and,
+// when the linear solver supports it, its factorization. One file per key, named after it:
+//      OperatorCacheHeader | CacheSectionHeader x section_count | payloads, each 64-byte aligned
+// A file of another version, key or Eigen release is a miss, and is overwritten after the setup.
+// Every section carries a checksum of its payload, verified when the entry is opened: a damaged entry is a miss too.
+enum class CACHE_SECTION : uint32_t
+{
+    A_OUTER = 0,        // compressed column storage of A
+    A_INNER,
+    A_VALUES,
+    LU_PERM_R = 16,     // SparseLU: row and column permutations
+    LU_PERM_C,
+    LU_XSUP,            // SparseLU: supernodal L and column-wise U, as laid out by Eigen
+    LU_SUPNO,
+    LU_LUSUP,
+    LU_XLUSUP,
+    LU_LSUB,
+    LU_XLSUB,
+    LU_UCOL,
+    LU_USUB,
+    LU_XUSUB,
+    LU_NNZ_L,           // SparseLU: nonzeros in the factors
+    LU_NNZ_U,
+};
+
+constexpr char OPERATOR_CACHE_MAGIC[8] = {'D', 'S', 'L', 'I', 'T', 'O', 'P', 'C'};
+constexpr uint32_t OPERATOR_CACHE_VERSION = 2;
+
+struct OperatorCacheHeader
+{
+    char magic[8]{};
+    uint32_t version{OPERATOR_CACHE_VERSION};
+    uint32_t section_count{};
+    uint64_t key{};
+    uint32_t eigen_version{};       // world*10000 + major*100 + minor: the LU sections mirror Eigen's internals
+    uint32_t reserved{};
+};
+static_assert(sizeof(OperatorCacheHeader) == 32, "OperatorCacheHeader is written as is, its layout must not change");
+
+struct CacheSectionHeader
+{
+    CACHE_SECTION id{};
+    uint32_t element_bytes{};
+    uint64_t offset{};              // from the start of the file
+    uint64_t count{};               // elements
+    uint64_t checksum{};            // CacheKey::add_bytes of the payload
+};
+static_assert(sizeof(CacheSectionHeader) == 32, "CacheSectionHeader is written as is, its layout must not change");
+
+
+// FNV-1a over everything that changes A or its factors.
+class CacheKey
+{
+    uint64_t m_hash{0xcbf29ce484222325ull};
+public:
+    template<typename T>
+    auto add(const T& value) -> CacheKey&
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        unsigned char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        for (unsigned char byte : bytes)
+        {
+            m_hash = (m_hash ^ byte)*0x100000001b3ull;
+        }
+        return *this;
+    }
+    auto add_bytes(std::span<const std::byte> bytes) -> CacheKey&;     // 64-bit words at a time, the tail zero padded: for large payloads
+    template<typename T>
+    auto add_all(std::span<const T> values) -> CacheKey&
+    {
+        add(values.size());
+        for (const auto& value : values)
+            add(value);
+        return *this;
+    }
+    uint64_t get() const { return m_hash; }
+};
+
+// Sections gathered then written in one go, to a temporary file renamed over the entry.
+// Nothing is copied: the arrays handed to add() must outlive write().
+class OperatorCacheWriter
+{
+    struct Section
+    {
+        CACHE_SECTION id{};
+        uint32_t element_bytes{};
+        std::span<const std::byte> bytes{};
+    };
+    std::vector<Section> m_sections{};
+public:
+    template<typename T>
+    void add(CACHE_SECTION id, std::span<const T> values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        m_sections.push_back({id, sizeof(T), std::as_bytes(values)});
+    }
+    template<typename Scalar>
+    void add_matrix(const SparseMatrix<Scalar>& A);     // A_* sections, A must be compressed
+    void write(const std::string& path, uint64_t key) const;
+};
+
+// A cache entry mapped in memory. Sections are read in place.
+class OperatorCacheEntry
+{
+    MappedFile m_file;
+    OperatorCacheHeader m_header{};
+    std::vector<CacheSectionHeader> m_sections{};
+public:
+    explicit OperatorCacheEntry(const std::string& path);
+    uint64_t get_key() const { return m_header.key; }
+    bool is_compatible(uint64_t key) const;
+    bool has(CACHE_SECTION id) const;
+    template<typename T>
+    auto get(CACHE_SECTION id) const -> std::span<const T>
+    {
+        const CacheSectionHeader& section = find(id, sizeof(T));
+        return {reinterpret_cast<const T*>(m_file.data() + section.offset), section.count};
+    }
+    template<typename Scalar>
+    auto get_matrix() const -> SparseMatrix<Scalar>;
+private:
+    auto find(CACHE_SECTION id, uint32_t element_bytes) const -> const CacheSectionHeader&;
+};
+
+auto get_eigen_version() -> uint32_t;
+auto get_operator_cache_path(const std::string& directory, uint64_t key) -> std::string;
+
+#endif
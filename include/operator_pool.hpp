@@ -0,0 +1,36 @@
+#ifndef OPERATOR_POOL_HPP
+#define OPERATOR_POOL_HPP
+
+#include <iostream>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include "interface_linear_solver.hpp"
+
+// In-memory counterpart of the operator cache, shared by the equation builders of a parameter sweep:
+// one linear solver set up per distinct operator (same key as the operator cache), every other case built
+// on that operator getting a share() of it. The first request of a key runs the setup, concurrent requests
+// of the same key wait for it instead of factorizing the same matrix again.
+template<typename Scalar>
+class OperatorPool
+{
+    using SolverPtr = std::unique_ptr<ILinearSolver<Scalar>>;
+    struct Entry
+    {
+        std::once_flag ready{};
+        SolverPtr solver{};     // nullptr if the backend cannot share its setup
+    };
+    std::mutex m_mutex{};
+    std::unordered_map<uint64_t, std::shared_ptr<Entry>> m_entries{};
+    std::atomic<size_t> m_setups{};
+    std::atomic<size_t> m_reuses{};
+public:
+    auto acquire(uint64_t key, const std::function<SolverPtr()>& setup) -> SolverPtr;
+    size_t get_setups() const { return m_setups.load(); }
+    size_t get_reuses() const { return m_reuses.load(); }
+};
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <iostream>
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+// Hot-path instrumentation: wall-clock timers per phase of a run and a few run counters, process wide and updated from
+// any thread (solver worker, render loop, sweep workers). A timed scope costs two clock reads and a handful of relaxed
+// atomic updates; built without DOUBLE_SLIT_PROFILING (CMake option of the same name) the macros below expand to nothing.
+// The scopes can also be kept as Chrome trace events (chrome://tracing, Perfetto) in a buffer of fixed size.
+enum class PHASE
+{
+    ASSEMBLY,       // sparse A built by the matrix builder
+    FACTORIZATION,  // linear solver setup, or its restoration from the operator cache
+    EVOLVE,         // one time step, all packets
+    RHS_PRODUCT,    // Crank-Nicolson: M psi by the stencil
+    SOLVE,          // Crank-Nicolson: A psi' = M psi, gathers and scatters of an eliminated obstacle included
+    INTERACT,       // obstacle zeroed in psi
+    OBSERVABLES,    // |psi|, max and norm sweep
+    FRAMEBUFFER,    // viewer: colour pass
+    RENDER,         // viewer: texture upload and draw calls, up to EndDrawing
+    EXPORT,         // video export: one frame colored and written, on the exporter's thread
+    CHECKPOINT,     // one checkpoint checksummed and written, on the checkpoint writer's thread
+    COUNT,
+};
+enum class COUNTER
+{
+    STEPS,
+    SOLVER_ITERATIONS,
+    BYTES_ALLOCATED,    // wavefunctions and sparse matrices set up by the builders
+    ACTIVE_CELLS,       // cells stepped, over every packet: less than the grid's with active windows
+    FRAMES_DROPPED,     // video export frames dropped for a full queue (EXPORT_POLICY::DROP)
+    COUNT,
+};
+constexpr size_t PHASE_COUNT   = static_cast<size_t>(PHASE::COUNT);
+constexpr size_t COUNTER_COUNT = static_cast<size_t>(COUNTER::COUNT);
+constexpr size_t DEFAULT_TRACE_EVENTS = 1 << 18;
+
+auto get_phase_name(PHASE phase) -> const char*;
+auto get_counter_name(COUNTER counter) -> const char*;
+
+struct PhaseStats
+{
+    uint64_t calls{};
+    double total_ms{};
+    double min_ms{};
+    double max_ms{};
+    double mean_ms() const { return calls? total_ms/calls : 0.0; }
+};
+
+struct ProfileSnapshot
+{
+    std::array<PhaseStats, PHASE_COUNT> phases{};
+    std::array<uint64_t, COUNTER_COUNT> counters{};
+    double norm_drift{};    // last value seen by the observable pass
+    double elapsed_s{};     // since the profiler started or was reset
+};
+
+class Profiler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+private:
+    struct Phase
+    {
+        std::atomic<uint64_t> calls{};
+        std::atomic<uint64_t> total_ns{};
+        std::atomic<uint64_t> min_ns{UINT64_MAX};
+        std::atomic<uint64_t> max_ns{};
+    };
+    struct TraceEvent
+    {
+        PHASE phase{};
+        uint32_t thread{};
+        int64_t start_ns{};         // steady clock: made relative to the origin when written out
+        uint64_t duration_ns{};
+    };
+    std::array<Phase, PHASE_COUNT> m_phases{};
+    std::array<std::atomic<uint64_t>, COUNTER_COUNT> m_counters{};
+    std::atomic<double> m_norm_drift{};
+    std::vector<TraceEvent> m_trace{};
+    std::atomic<size_t> m_trace_next{};                         // never rewound by reset(): a trace slot is claimed once
+    std::atomic<int64_t> m_origin_ns{get_clock_ns(Clock::now())};  // reset() may run beside the timers: kept as an atomic count
+    static int64_t get_clock_ns(Clock::time_point time) { return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count(); }
+    Profiler() = default;
+public:
+    static auto get() -> Profiler&;
+    void record(PHASE phase, Clock::time_point start, Clock::time_point end);
+    void add(COUNTER counter, uint64_t value) { m_counters[static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed); }
+    void set_norm_drift(double drift) { m_norm_drift.store(drift, std::memory_order_relaxed); }
+    void enable_trace(size_t capacity = DEFAULT_TRACE_EVENTS);  // before the run: events past the capacity are dropped
+    auto snapshot() const -> ProfileSnapshot;
+    void reset();       // may run while scopes are timed: those in flight land before or after it, the trace keeps what follows it
+    // CSV or JSON summary, chosen by the extension of the path (.json, anything else is CSV).
+    // Both writers throw std::runtime_error when the file cannot be opened or written.
+    void write_summary(const std::string& path) const;
+    void write_trace(const std::string& path) const;            // Chrome trace-event JSON
+    size_t get_trace_dropped() const;
+};
+
+class ScopedTimer
+{
+    PHASE m_phase;
+    Profiler::Clock::time_point m_start{Profiler::Clock::now()};
+public:
+    explicit ScopedTimer(PHASE phase) : m_phase{phase} {}
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+    ~ScopedTimer() { Profiler::get().record(m_phase, m_start, Profiler::Clock::now()); }
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#ifdef DOUBLE_SLIT_PROFILING
+#define PROFILE_SCOPE(phase)            ScopedTimer PROFILE_CONCAT(profile_scope_, __LINE__){phase}
+#define PROFILE_COUNT(counter, value)   Profiler::get().add(counter, static_cast<uint64_t>(value))
+#define PROFILE_NORM_DRIFT(drift)       Profiler::get().set_norm_drift(drift)
+#else
+#define PROFILE_SCOPE(phase)            ((void)0)
+#define PROFILE_COUNT(counter, value)   ((void)0)
+#define PROFILE_NORM_DRIFT(drift)       ((void)0)
+#endif
+
+#endif
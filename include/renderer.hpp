@@ -0,0 +1,29 @@
+#ifndef RENDERER_HPP
+#define RENDERER_HPP
+
+#include <iostream>
+#include <span>
+#include "raylib.h"
+#include "framebuffer.hpp"
+#include "profiler.hpp"
+
+// raylib side of the rendering, kept apart from the solver so that the headless target does not link raylib.
+// The whole Nx x Ny framebuffer lives in one texture: one upload and one scaled quad per frame.
+// Needs an open window (InitWindow) for the whole lifetime of the object.
+class TextureRenderer
+{
+    Texture2D m_texture{};
+    Rectangle m_destination{};
+public:
+    explicit TextureRenderer(size_t Nx, size_t Ny, Rectangle destination);
+    TextureRenderer(const TextureRenderer&) = delete;
+    TextureRenderer& operator=(const TextureRenderer&) = delete;
+    ~TextureRenderer();
+    void upload(std::span<const Rgba> pixels);
+    void draw() const;
+};
+
+// Live view of the profiler: mean and max time of every phase seen so far, and the run counters.
+void draw_profile_overlay(const ProfileSnapshot& profile, int x, int y, int font_size);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef SCALAR_TYPES_HPP
+#define SCALAR_TYPES_HPP
+
+#include <iostream>
+#include <complex>
+#include <concepts>
+#include "Eigen/SparseLU"
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+// Scalar of psi and of the operators, picked per run: std::complex<float> for interactive throughput,
+// std::complex<double> for long runs where the norm drift matters.
+// The classes templated on it are explicitly instantiated for both at the end of their translation unit.
+template<typename Scalar>
+concept complex_scalar = std::same_as<Scalar, std::complex<float>> || std::same_as<Scalar, std::complex<double>>;
+
+template<typename Scalar> using Real         = typename Scalar::value_type;
+template<typename Scalar> using VectorX      = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+template<typename Scalar> using MatrixX      = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+template<typename Scalar> using SparseMatrix = Eigen::SparseMatrix<Scalar>;
+
+enum class PRECISION
+{
+    SINGLE,     // std::complex<float>
+    DOUBLE,     // std::complex<double>
+};
+
+// Subnormal results flushed to zero and subnormal operands read as zero (MXCSR FTZ and DAZ), on the calling thread
+// and on the threads it starts from then on. The Gaussian tails of psi fall below FLT_MIN a few widths away from the packet:
+// computed with subnormals, a single precision step is several times slower, slower even than a double precision one.
+inline void flush_denormals()
+{
+#if defined(__SSE__) || defined(_M_X64)
+    constexpr unsigned int FLUSH_TO_ZERO      = 0x8000;
+    constexpr unsigned int DENORMALS_ARE_ZERO = 0x0040;
+    _mm_setcsr(_mm_getcsr() | FLUSH_TO_ZERO | DENORMALS_ARE_ZERO);
+#endif
+}
+
+template<typename Scalar>
+constexpr auto get_precision_name() -> const char*
+{
+    return std::same_as<Scalar, std::complex<double>>? "double" : "single";
+}
+
+#endif
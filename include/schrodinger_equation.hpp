@@ -6,26 +6,58 @@
 #include "Eigen/SparseLU"
 #include "interferometer.hpp"
 #include "helper_functions.hpp"
+#include "interface_time_stepper.hpp"
 #include <memory>
+#include <vector>
 
-using SparseMatrix = Eigen::SparseMatrix<std::complex<float>>;
+// Everything the consumers of a time step read, computed together in a single sweep over psi.
+struct Observables
+{
+    std::vector<float> modulus{};   // |psi| of every interior cell, column major like psi
+    float max_modulus{};
+    double norm{};                  // sum of |psi|^2
+    double norm_drift{};            // |norm - initial norm|/initial norm: unitarity check, includes what the barrier absorbs
+};
 
+// psi is a single wavepacket, or a batch of K independent ones stored back to back: the column major (Ndof x K) block
+// the time stepper advances in one go, all the packets sharing its factorization. Observables are kept per packet.
+template<typename Scalar>
 class SchodingerEquation
 {      
-    Eigen::SparseLU<SparseMatrix> m_solver{};
-    SparseMatrix m_sparse_M{};
-    Eigen::VectorXcf m_psi{};
-    Eigen::VectorXcf m_psi_backup{};
-    Eigen::VectorXcf m_psi_temp{};    
+    std::unique_ptr<ITimeStepper<Scalar>> m_stepper{};
+    VectorX<Scalar> m_psi{};
+    VectorX<Scalar> m_psi_backup{};
+    size_t m_packet_size{};     // Ndof, (Nx-2)*(Ny-2)
+    size_t m_packets{};
+    std::vector<Observables> m_observables{};
+    std::vector<double> m_initial_norm{};
+    std::vector<bool> m_observables_stale{};
+    std::vector<ActiveWindow> m_observed_windows{};    // where the modulus of each packet may be non zero
 public:
-    explicit SchodingerEquation(size_t Nx_, size_t Ny_, const SparseMatrix& sparse_A , SparseMatrix&& sparse_M, Eigen::VectorXcf&& initial_wf);
+    explicit SchodingerEquation(size_t Nx_, size_t Ny_, std::unique_ptr<ITimeStepper<Scalar>> stepper, VectorX<Scalar>&& initial_wf);
+    explicit SchodingerEquation(size_t Nx_, size_t Ny_, std::unique_ptr<ITimeStepper<Scalar>> stepper, const MatrixX<Scalar>& initial_packets); // one per column
     size_t Nx{};
     size_t Ny{};
-    float get_wf_modulus(size_t k) const;
+    auto get_wavefunction() const -> const VectorX<Scalar>& { return m_psi; }   // every packet
+    auto get_packet(size_t packet) const { return m_psi.segment(packet*m_packet_size, m_packet_size); }
+    size_t get_packet_count() const { return m_packets; }
+    auto observe(size_t packet = 0) -> const Observables&;  // recomputed at most once per change of psi
+    void mark_stale();                                      // the next observe() recomputes, even if psi did not change
     void evolve();
     void interact(const Interferometer& double_slit);
-    float get_max_amplitude() const;
+    float get_max_amplitude();
+    size_t get_solver_iterations() const;
+    auto get_stepper() -> ITimeStepper<Scalar>& { return *m_stepper; }
+    void set_stepper(std::unique_ptr<ITimeStepper<Scalar>> stepper);    // e.g. for a new dt, psi carrying on from where it is
+    auto get_active_window(size_t packet) const { return m_stepper->get_active_window(packet); }
+    double get_discarded_probability() const { return m_stepper->get_discarded_probability(); }
     void reset();
+    // every packet and what the stepper derived from them, e.g. from a checkpoint: reset() still returns to the initial state
+    void restore(const VectorX<Scalar>& psi, std::span<const StepperPacketState> stepper_state = {});
+    auto get_stepper_state() const { return m_stepper->save_state(); }
+private:
+    void init_packets(size_t packets);
+    auto get_window(size_t packet) const -> ActiveWindow;
 };
 
  
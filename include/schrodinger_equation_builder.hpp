@@ -3,7 +3,6 @@
 
 #include <iostream>
 #include <print>
-#include "raylib.h"
 // #include "eigen3/Eigen/SparseLU"
 #include "Eigen/SparseLU"
 #include "interferometer.hpp"
@@ -11,34 +10,89 @@
 #include "schrodinger_equation.hpp"
 #include "helper_functions.hpp"
 #include "interface_matrix_builder.hpp"
+#include "linear_solvers.hpp"
+#include "operator_pool.hpp"
+#include "absorbing_layer.hpp"
+#include "adi_stepper.hpp"
+#include "stencil_operator.hpp"
 
 #include <memory>
+#include <optional>
+#include <string>
+#include <span>
  
+enum class ENGINE
+{
+    CRANK_NICOLSON, // global sparse LU solve of the full Crank-Nicolson system
+    ADI,            // Peaceman-Rachford splitting, batched tridiagonal line solves
+    SPLIT_OPERATOR, // exact kinetic step in the sine basis by FFT, barrier in real space
+};
+
+constexpr float SIGMA_DEVIATION = 0.2f;
+
+// Initial Gaussian of one packet of a batch
+struct WavePacket
+{
+    Vec2f position{};
+    float sigma{SIGMA_DEVIATION};
+    float wave_number{DEFAULT_WAVE_NUMBER};
+};
 
+template<typename Scalar>
 class SchodingerEquationBuilder
 {      
-    std::complex<float> m_rx{};
-    std::complex<float> m_ry{};
-    std::complex<float> m_a0{};
-    std::complex<float> m_b0{};
-    Vector2 m_initial_pos{};
-    std::unique_ptr<IMatrixBuilder> m_sparse_mat_buidler{};
-    std::unique_ptr<IWaveFunctionBuilder> m_wf_builder{};
-    SparseMatrix m_sparse_A{};
-    SparseMatrix m_sparse_M{};
-    Eigen::VectorXcf m_psi{};
+    Scalar m_rx{};
+    Scalar m_ry{};
+    Scalar m_a0{};
+    Scalar m_b0{};
+    Vec2f m_initial_pos{};
+    float m_wave_number{DEFAULT_WAVE_NUMBER};
+    std::unique_ptr<IMatrixBuilder<Scalar>> m_sparse_mat_buidler{};
+    std::unique_ptr<IWaveFunctionBuilder<Scalar>> m_wf_builder{};
+    SparseMatrix<Scalar> m_sparse_A{};
+    float m_dt{};
+    Real<Scalar> m_exact_dt{};      // m_dt in the precision of the run
+    float m_dx{};
+    float m_dy{};
     float m_Lx{};
     float m_Ly{};
     size_t m_Nx{};
     size_t m_Ny{};
+    ENGINE m_engine{ENGINE::CRANK_NICOLSON};
+    SolverOptions m_solver_options{};
+    std::optional<ObstacleMask> m_obstacle{};
+    AbsorbingLayer m_absorbing_layer{};
+    ActivityOptions m_activity{};
+    std::string m_cache_directory{};
+    std::shared_ptr<OperatorPool<Scalar>> m_operator_pool{};
 public:
-    explicit SchodingerEquationBuilder(const Vector2& L, const Vector2& dr, const Vector2& init_pos,
-                                        std::unique_ptr<IMatrixBuilder> matrix_builder,
-                                        std::unique_ptr<IWaveFunctionBuilder> wf_builder);
-    auto build_equation() -> SchodingerEquation;
+    explicit SchodingerEquationBuilder(const Vec2f& L, const Vec2f& dr, const Vec2f& init_pos,
+                                        std::unique_ptr<IMatrixBuilder<Scalar>> matrix_builder,
+                                        std::unique_ptr<IWaveFunctionBuilder<Scalar>> wf_builder);
+    void set_engine(ENGINE engine);
+    void set_solver_options(const SolverOptions& options);  // linear solver of the Crank-Nicolson engine
+    void set_obstacle(const ObstacleMask& obstacle);        // eliminated from the Crank-Nicolson system, interact() becomes a no-op
+    void set_operator_cache(const std::string& directory);  // reuse A and its factorization across runs, disabled if empty
+    void set_operator_pool(std::shared_ptr<OperatorPool<Scalar>> pool);  // share the solver with the other builders of the pool
+    void set_wave_number(float k);                          // of the packet of build_equation()
+    void set_time_step(float dt);                           // dx^2/4 by default, any value > 0 for the split-operator engine, throws std::invalid_argument otherwise
+    void set_absorbing_layer(const AbsorbingLayer& layer);  // damps outgoing waves along the walls, Crank-Nicolson or split operator
+    void set_activity(const ActivityOptions& activity);     // steps only the active window of each packet, ADI
+    void retime(SchodingerEquation<Scalar>& equation, float dt);    // new dt for an equation built by this builder, without a full rebuild: throws std::invalid_argument on another stepper
+    auto build_equation() -> SchodingerEquation<Scalar>;                                    // throws std::runtime_error on a setup failure, left to the caller
+    auto build_batch(std::span<const WavePacket> packets) -> SchodingerEquation<Scalar>;   // stepped together, one factorization, throws as build_equation()
+    float get_time_step() const { return m_dt; }
+    size_t get_Nx() const { return m_Nx; }
+    size_t get_Ny() const { return m_Ny; }
 private:
-    void init_wave_function();
+    void init_coefficients(Real<Scalar> dt);
+    auto build_packet(const WavePacket& packet) -> VectorX<Scalar>;
     void init_sparse_matrices();
+    auto build_stepper() -> std::unique_ptr<ITimeStepper<Scalar>>;
+    void prepare_solver(ILinearSolver<Scalar>& solver);
+    auto get_cache_key() const -> uint64_t;
+    auto make_stencil() const -> StencilOperator<Scalar>;   // M, matrix free
+    auto get_absorption() const -> VectorX<Scalar>;         // dt/2 W, the diagonal shift of the Crank-Nicolson matrices
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,81 @@
+#ifndef SIMULATION_CONFIG_HPP
+#define SIMULATION_CONFIG_HPP
+
+#include <iostream>
+#include <string>
+#include <optional>
+#include <vector>
+#include <memory>
+#include "helper_functions.hpp"
+#include "interferometer.hpp"
+#include "schrodinger_equation_builder.hpp"
+#include "snapshot.hpp"
+#include "frame_exporter.hpp"
+#include "checkpoint.hpp"
+#include "detector_screen.hpp"
+#include "profiler.hpp"
+
+// Run parameters shared by the viewer and the headless batch runner.
+// Set from "--key value" command line pairs and/or a "key = value" config file (--config path), e.g.
+//      Lx = 6   Ly = 4   dr = 0.04   x0 = 1.2   y0 = 2   steps = 1000   dt = 0.0016   engine = cn   solver = bicgstab   precision = double
+//      wave_number = 50   eliminate_obstacle = true   wave_numbers = 40,47,54   absorbing_layer = 16   absorbing_strength = 750
+//      obstacle = grating.pgm   operator_cache = .cache   ordering = nd   active_threshold = 1e-4   active_margin = 8
+//      record = run.snap   record_format = half   record_every = 10   steps_per_frame = 4   playback = run.snap
+//      export = run.y4m   export_size = 640x426   export_colormap = heat   export_policy = drop   export_every = 10   export_fps = 30   export_queue = 4
+//      checkpoint = run.ckpt   checkpoint_interval = 5   resume = run.ckpt
+//      detector_columns = 120,140   detector_regions = 100:20:10:40   detector_current = true   detector_every = 100
+//      profile = run.json   trace = trace.json
+struct SimulationConfig
+{
+    Vec2f L{.x = 6.f, .y = 4.f};        // system size
+    Vec2f dr{.x = 0.04f, .y = 0.04f};   // step size
+    std::optional<float> x0{};          // initial position of the wf, defaults to (Lx/5, Ly/2)
+    std::optional<float> y0{};
+    float wave_number{DEFAULT_WAVE_NUMBER};
+    std::vector<float> wave_numbers{};  // headless only: a batch of packets, one per wave number, stepped together
+    float slit_thickness{0.02f};        // along x, fraction of Nx
+    float slit_width{0.18f};            // part between the two slits, fraction of Ny
+    float slit_opening{0.04f};          // each slit, fraction of Ny
+    std::string obstacle_path{};        // obstacle bitmap (see load_obstacle_mask) replacing the double slit, if set
+    std::optional<ObstacleMask> obstacle{};  // barrier restored from a checkpoint, replacing both, if set
+    bool eliminate_obstacle{false};     // Crank-Nicolson only: solve over the free cells, instead of zeroing the obstacle every step
+    AbsorbingLayer absorbing_layer{.strength = DEFAULT_ABSORBING_STRENGTH};   // along the walls, none unless a thickness is set
+    ActivityOptions activity{};         // ADI only: each packet stepped over its active window, the whole grid if no threshold
+    size_t steps{1000};
+    float dt{};                         // time step, dx^2/4 unless set (0): larger steps suit the split-operator engine
+    ENGINE engine{ENGINE::CRANK_NICOLSON};
+    PRECISION precision{PRECISION::SINGLE};  // scalar of psi and of the solver stack
+    SolverOptions solver_options{};
+    std::string operator_cache{};       // directory of cached operators and factorizations, none if empty
+    std::string record_path{};          // snapshot file written while running, none if empty
+    SNAPSHOT_FORMAT record_format{SNAPSHOT_FORMAT::MODULUS_FLOAT16};
+    size_t record_every{1};             // steps between two recorded frames
+    size_t steps_per_frame{1};          // viewer only: solver steps between two published frames
+    std::string playback_path{};        // viewer only: replay this snapshot file instead of solving
+    ExportOptions export_options{};     // video of the run (frame_exporter.hpp), none unless a path is set
+    std::string checkpoint_path{};      // checkpoint file kept up to date while running, none if empty
+    float checkpoint_interval{5.f};     // seconds of wall clock between two periodic checkpoints, only on demand and at the end if 0
+    std::string resume_path{};          // restart from this checkpoint, its build parameters overriding the ones set here
+    std::vector<size_t> detector_columns{};         // headless only: time integrated |psi|^2 on these grid columns,
+    std::vector<DetectorRegion> detector_regions{}; // and on these x0:y0:width:height rectangles (see detector_screen.hpp)
+    bool detector_current{false};                   // the time integrated probability current j_x as well
+    std::string detector_output{"detector_screen.csv"};
+    size_t detector_every{0};                       // steps between two writes of the detector file, only at the end if 0
+    std::string profile_path{};         // per-phase timings and counters written at the end (profiler.hpp), .json or CSV
+    std::string trace_path{};           // Chrome trace of every timed scope, none if empty
+
+    auto initial_pos() const -> Vec2f;
+    void set_option(const std::string& key, const std::string& value);
+    void load_file(const std::string& path);
+};
+
+auto parse_arguments(int argc, char* argv[]) -> SimulationConfig;
+auto build_interferometer(const SimulationConfig& config, size_t Nx, size_t Ny) -> Interferometer;
+auto build_detector_screen(const SimulationConfig& config, size_t Nx, size_t Ny, float dt) -> std::unique_ptr<DetectorScreen>;  // nullptr without detectors
+void start_profiling(const SimulationConfig& config);  // before the run: trace buffer, if a trace is requested
+void write_profile(const SimulationConfig& config);    // after the run: the profile and trace files requested, if any
+auto make_snapshot_header(const SimulationConfig& config, const Interferometer& double_slit, float dt) -> SnapshotHeader;
+auto make_checkpoint_header(const SimulationConfig& config, const Interferometer& double_slit, size_t packets) -> CheckpointHeader;
+void apply_checkpoint(SimulationConfig& config, const Checkpoint& checkpoint);     // the run it was taken from, its obstacle included, before building it
+
+#endif
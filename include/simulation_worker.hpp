@@ -0,0 +1,69 @@
+#ifndef SIMULATION_WORKER_HPP
+#define SIMULATION_WORKER_HPP
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include "schrodinger_equation.hpp"
+#include "interferometer.hpp"
+#include "snapshot.hpp"
+#include "frame_exporter.hpp"
+#include "checkpoint.hpp"
+#include "triple_buffer.hpp"
+#include "interface_simulation_worker.hpp"
+
+// Steps the equation on its own thread, as fast as it can, and publishes a frame every steps_per_frame steps
+// through a lock-free triple buffer, so that neither the solver nor the renderer ever waits on the other.
+// Controls go through a command queue, drained by the worker between two steps. Starts paused.
+// Snapshot recording, video export and checkpoints, if given, are fed from the worker thread and written from their own.
+// Checkpoints are taken at the writer's interval, on COMMAND::CHECKPOINT and once more when the worker stops;
+// the clock given is where the run starts from, a resumed one carrying on its step count and simulated time.
+// A change of dt goes through the retimer given, on the worker thread: not while recording, the snapshot having a single dt.
+template<typename Scalar>
+class SimulationWorker : public ISimulationWorker
+{
+public:
+    using Retimer = std::function<void(SchodingerEquation<Scalar>&, float dt)>;
+private:
+    SchodingerEquation<Scalar> m_equation;
+    Retimer m_retime{};
+    float m_dt{};
+    Interferometer m_double_slit;
+    std::unique_ptr<SnapshotWriter> m_recorder{};
+    size_t m_record_every{1};
+    std::unique_ptr<FrameExporter> m_exporter{};
+    size_t m_export_every{1};
+    std::unique_ptr<CheckpointWriter> m_checkpoints{};
+    CheckpointClock m_start{};
+    size_t m_steps_per_frame{1};
+    TripleBuffer<PublishedFrame> m_frames{};
+    std::mutex m_command_mutex{};
+    std::deque<COMMAND> m_commands{};
+    std::atomic<float> m_steps_per_second{};
+    std::jthread m_thread{};
+public:
+    explicit SimulationWorker(SchodingerEquation<Scalar>&& equation, const Interferometer& double_slit,
+                              std::unique_ptr<SnapshotWriter> recorder, size_t record_every,
+                              std::unique_ptr<FrameExporter> exporter, size_t export_every,
+                              std::unique_ptr<CheckpointWriter> checkpoints, const CheckpointClock& clock, size_t steps_per_frame,
+                              Retimer retime = {}, float dt = 0.f);
+    SimulationWorker(const SimulationWorker&) = delete;
+    SimulationWorker& operator=(const SimulationWorker&) = delete;
+    ~SimulationWorker() override;
+    void send(COMMAND command) override;
+    bool acquire_frame() override { return m_frames.acquire(); }
+    auto get_frame() const -> const PublishedFrame& override { return m_frames.get_front(); }
+    float get_steps_per_second() const override { return m_steps_per_second.load(std::memory_order_relaxed); }
+private:
+    void run(std::stop_token stop);
+    void publish(size_t step);
+    void retime(float dt);
+    void checkpoint(const CheckpointClock& clock);
+};
+
+#endif
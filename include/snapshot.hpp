@@ -0,0 +1,124 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <iostream>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <span>
+#include <fstream>
+#include <atomic>
+#include "Eigen/SparseLU"
+#include "scalar_types.hpp"
+#include "mapped_file.hpp"
+#include "obstacle_mask.hpp"
+#include "writer_queue.hpp"
+
+// Append-only snapshot file of the wavefunction evolution:
+//      SnapshotHeader | obstacle (MaskSpan x obstacle_spans) | FrameHeader payload | FrameHeader payload | ...
+// The obstacle is the barrier's pixel spans (ObstacleMask::get_pixel_spans), whatever its geometry, for the playback to draw.
+// Every frame has the same size (header.frame_bytes), so frame n sits at sizeof(SnapshotHeader) + obstacle_spans*sizeof(MaskSpan)
+// + n*frame_bytes and a file cut short by a crash is still readable up to its last complete frame.
+// The payload is the interior (Ny-2)x(Nx-2) grid, column major like psi, in one of the formats below,
+// always in single precision whatever the precision of the run.
+enum class SNAPSHOT_FORMAT : uint32_t
+{
+    COMPLEX_FLOAT32 = 0,    // psi itself, re/im interleaved
+    MODULUS_FLOAT32 = 1,    // |psi|
+    MODULUS_FLOAT16 = 2,    // |psi| as IEEE half floats
+    MODULUS_UINT8   = 3,    // |psi| quantized to 255*|psi|/max_modulus
+};
+
+constexpr char SNAPSHOT_MAGIC[8] = {'D', 'S', 'L', 'I', 'T', 'S', 'N', 'P'};
+constexpr uint32_t SNAPSHOT_VERSION = 2;
+
+struct SnapshotHeader
+{
+    char magic[8]{};
+    uint32_t version{SNAPSHOT_VERSION};
+    SNAPSHOT_FORMAT format{SNAPSHOT_FORMAT::COMPLEX_FLOAT32};
+    uint64_t Nx{};
+    uint64_t Ny{};
+    float dx{};
+    float dy{};
+    float dt{};
+    uint32_t steps_per_frame{1};
+    uint64_t slit_thickness{};  // Interferometer geometry, in grid points, 0 for a bitmap obstacle
+    uint64_t slit_width{};
+    uint64_t slit_height{};
+    uint64_t frame_bytes{};     // FrameHeader + payload
+    uint64_t obstacle_spans{};  // spans of the barrier following the header
+};
+static_assert(sizeof(SnapshotHeader) == 88, "SnapshotHeader is written as is, its layout must not change");
+
+struct FrameHeader
+{
+    uint64_t step{};
+    float max_modulus{};
+    float norm{};               // sum of |psi|^2 over the grid
+};
+static_assert(sizeof(FrameHeader) == 16, "FrameHeader is written as is, its layout must not change");
+
+auto get_payload_bytes(SNAPSHOT_FORMAT format, size_t N) -> size_t;
+auto float_to_half(float value) -> uint16_t;
+auto half_to_float(uint16_t half) -> float;
+
+
+// Records frames from a background thread. push() only copies psi into a free buffer of a small pool,
+// the reduction, quantization and disk write all happen on the writer thread, so the solver is not held up by I/O.
+// When the disk cannot keep up and the pool is exhausted, push() waits for a buffer rather than dropping frames.
+class SnapshotWriter
+{
+    struct Frame
+    {
+        uint64_t step{};
+        Eigen::VectorXcf psi{};
+    };
+    SnapshotHeader m_header{};
+    std::ofstream m_file{};
+    std::atomic<size_t> m_frames_written{};
+    std::string m_path{};
+    std::string m_error{};                  // first write failure of the writer thread, reported by close()
+    std::vector<char> m_buffer{};
+    WriterQueue<Frame> m_queue{};           // last: its thread is joined before the members it writes through go
+public:
+    explicit SnapshotWriter(const std::string& path, const SnapshotHeader& header, const ObstacleMask& barrier, size_t queue_depth = 8);
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+    ~SnapshotWriter();
+    template<typename Scalar>
+    void push(const Eigen::Ref<const VectorX<Scalar>>& psi, uint64_t step);     // one packet of a batch
+    void close();                           // drains the queue and flushes the file, throws std::runtime_error if a write failed
+    size_t get_stalls() const { return m_queue.get_stalls(); }
+    size_t get_frames_written() const { return m_frames_written.load(); }
+private:
+    void write(const Frame& frame);
+    void encode(const Frame& frame);
+};
+
+
+// Memory-mapped playback of a snapshot file. Frames are decoded straight from the mapping; float32 moduli are read
+// in place, nothing is copied.
+class SnapshotReader
+{
+    MappedFile m_file;
+    const std::byte* m_data{};      // first frame
+    size_t m_frame_count{};
+    SnapshotHeader m_header{};
+    std::vector<MaskSpan> m_obstacle_spans{};
+public:
+    explicit SnapshotReader(const std::string& path);
+    SnapshotReader(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+    auto get_header() const -> const SnapshotHeader& { return m_header; }
+    auto get_obstacle() const -> ObstacleMask;     // the barrier the run was recorded with
+    size_t get_frame_count() const { return m_frame_count; }
+    auto get_frame_header(size_t frame) const -> FrameHeader;
+    auto get_payload(size_t frame) const -> const std::byte*;
+    float get_modulus(size_t frame, size_t k) const;
+    // The moduli of a frame: a view of the mapping for MODULUS_FLOAT32, decoded into scratch (Nx-2 x Ny-2) otherwise
+    auto decode_modulus(size_t frame, std::span<float> scratch) const -> std::span<const float>;
+    bool needs_scratch() const { return m_header.format != SNAPSHOT_FORMAT::MODULUS_FLOAT32; }
+};
+
+#endif
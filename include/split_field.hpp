@@ -0,0 +1,45 @@
+#ifndef SPLIT_FIELD_HPP
+#define SPLIT_FIELD_HPP
+
+#include <iostream>
+#include "Eigen/SparseLU"
+#include "scalar_types.hpp"
+
+// Real and imaginary parts of a field over the interior (Ny-2)x(Nx-2) grid kept apart, in two planes of columns,
+// so that the kernels working on it are plain arithmetic on real lanes, without de-interleaving complex values.
+// Each column is padded with zeros to a whole number of SIMD packets (at least one zero past its last row), and a
+// zero column is kept on both sides of the grid: the 5-point neighbours of every cell, walls included, are plain loads.
+// Columns start on the alignment Eigen gives its own vectors. The padding is zero and stays so: kernels only write rows.
+// Eigen's solvers work on interleaved psi: assign() and store() convert at that boundary, a column per thread.
+struct FieldSummary
+{
+    float max_modulus{};
+    double norm{};          // sum of |psi|^2
+};
+
+template<typename Scalar>
+class SplitField
+{
+    Eigen::Index m_rows{};      // Ny-2
+    Eigen::Index m_cols{};      // Nx-2
+    Eigen::Index m_stride{};    // m_rows padded
+    VectorX<Real<Scalar>> m_real{};     // (m_cols+2) columns of m_stride values, column -1 first
+    VectorX<Real<Scalar>> m_imag{};
+public:
+    SplitField() = default;
+    explicit SplitField(size_t Nx, size_t Ny);
+    void assign(const VectorX<Scalar>& psi);    // from the interleaved layout
+    void store(VectorX<Scalar>& psi) const;     // to it
+    // |psi| of every cell into the column major (Ny-2)x(Nx-2) modulus, with its max and the norm, in a single sweep
+    auto reduce_modulus(float* modulus) const -> FieldSummary;
+    Eigen::Index get_rows() const { return m_rows; }
+    Eigen::Index get_cols() const { return m_cols; }
+    size_t size() const { return m_rows*m_cols; }
+    // column jx, from -1 (the zero column of the left wall) to Nx-2 (the right one); rows -1 and Ny-2 read zero
+    auto real(Eigen::Index jx)       -> Real<Scalar>*       { return m_real.data() + (jx+1)*m_stride; }
+    auto imag(Eigen::Index jx)       -> Real<Scalar>*       { return m_imag.data() + (jx+1)*m_stride; }
+    auto real(Eigen::Index jx) const -> const Real<Scalar>* { return m_real.data() + (jx+1)*m_stride; }
+    auto imag(Eigen::Index jx) const -> const Real<Scalar>* { return m_imag.data() + (jx+1)*m_stride; }
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef SPLIT_OPERATOR_STEPPER_HPP
+#define SPLIT_OPERATOR_STEPPER_HPP
+
+#include <iostream>
+#include <vector>
+#include "Eigen/SparseLU"
+#include "unsupported/Eigen/FFT"
+#include "interface_time_stepper.hpp"
+
+// Split-operator (split-step Fourier) propagation: the kinetic part is applied exactly in the eigenbasis of the
+// discrete laplacian, the potential part in real space.
+//      psi(t+dt) = P exp(-i dt H) psi(t),     H = -(Dx/dx^2 + Dy/dy^2)
+// With Dirichlet walls the eigenbasis of H is the type-I sine transform (DST) along x and along y, eigenvalues
+//      mu(kx, ky) = 4/dx^2 sin^2(pi kx/(2(Nx-1))) + 4/dy^2 sin^2(pi ky/(2(Ny-1)))
+// so that the kinetic step is unitary and exact in time for the same spatial operator as the Crank-Nicolson engine,
+// at any dt. The potential part P is the barrier, zeroed in real space by SchodingerEquation::interact(), and the
+// exp(-W dt) damping of an absorbing layer, applied here after the kinetic step.
+// Each DST of a line of n values is a complex FFT of its odd extension, M = 2(n+1) values (Eigen's bundled KissFFT,
+// mixed radix), the lines being spread over threads. Lengths with a large prime factor, which KissFFT only handles
+// in O(M p), go through Bluestein's chirp-z convolution at a 5-smooth length instead. O(N log N) per step, nothing
+// stored but the phases and the chirps.
+template<typename Scalar>
+class SplitOperatorStepper : public ITimeStepper<Scalar>
+{
+    struct LineTransform
+    {
+        size_t n{};                             // values of a line
+        size_t padded{};                        // length of the chirp-z convolution, 0 for a direct FFT
+        std::vector<Scalar> chirp{};            // exp(-i pi j^2/M), j < M
+        std::vector<Scalar> filter_spectrum{};  // FFT of the conjugate chirp, wrapped around and zero padded
+    };
+    struct Workspace
+    {
+        Eigen::FFT<Real<Scalar>> fft{};     // keeps its plans, one per thread
+        std::vector<Scalar> extended{};     // odd extension of a line
+        std::vector<Scalar> spectrum{};
+    };
+    size_t m_rows{};    // Ny-2, contiguous direction
+    size_t m_cols{};    // Nx-2
+    LineTransform m_x_line{};
+    LineTransform m_y_line{};
+    MatrixX<Scalar> m_phase{};          // exp(-i dt mu) and the DST normalization, (Nx-2)x(Ny-2): the transposed layout
+    MatrixX<Scalar> m_transposed{};     // psi with the x lines contiguous
+    VectorX<Scalar> m_damping{};        // exp(-W dt) of an absorbing layer, none if empty
+    std::vector<Workspace> m_workspaces{};
+public:
+    explicit SplitOperatorStepper(size_t Nx, size_t Ny, Real<Scalar> dx, Real<Scalar> dy, Real<Scalar> dt);
+    void step(VectorX<Scalar>& psi) override;
+    void step_batch(Eigen::Map<MatrixX<Scalar>> psi) override;
+    size_t get_iterations() const override { return 0; }
+    void set_absorption(const VectorX<Scalar>& potential, Real<Scalar> dt);    // W of an absorbing layer
+private:
+    void propagate(Scalar* psi);
+    static auto make_line_transform(size_t n) -> LineTransform;
+    static void sine_transform(Workspace& workspace, const LineTransform& transform, Scalar* line);  // -2i DST-I, in place
+};
+
+#endif
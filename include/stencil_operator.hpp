@@ -0,0 +1,36 @@
+#ifndef STENCIL_OPERATOR_HPP
+#define STENCIL_OPERATOR_HPP
+
+#include <iostream>
+#include "Eigen/SparseLU"
+#include "scalar_types.hpp"
+#include "split_field.hpp"
+
+// Matrix-free application of the constant 5-point Crank-Nicolson matrix
+//      (M psi)(y,x) = b0 psi(y,x) + ry [psi(y-1,x) + psi(y+1,x)] + rx [psi(y,x-1) + psi(y,x+1)]
+// directly on the column major (Ny-2)x(Nx-2) interior grid, with Dirichlet zeros outside.
+// Columns are spread over threads, each column is a contiguous Eigen expression (vectorized by Eigen's packet math).
+// An absorbing layer makes the diagonal b0 - a(y,x) within layer cells of the walls: only those parts of the columns
+// get the extra product.
+// The same product on a SplitField is written out on real lanes: its halo of zeros makes every neighbour a plain load.
+template<typename Scalar>
+class StencilOperator
+{
+    Eigen::Index m_rows{};  // Ny-2
+    Eigen::Index m_cols{};  // Nx-2
+    Scalar m_diag{};
+    Scalar m_rx{};
+    Scalar m_ry{};
+    VectorX<Scalar> m_absorption{};     // a(y,x), none if empty
+    Eigen::Index m_layer{};             // cells of the walls a can be non-zero in
+public:
+    StencilOperator() = default;
+    explicit StencilOperator(size_t Nx, size_t Ny, Scalar diag, Scalar rx, Scalar ry);
+    void apply(const VectorX<Scalar>& in, VectorX<Scalar>& out) const;
+    void apply(const Scalar* in, Scalar* out) const;    // size() contiguous values each, not aliased
+    void apply(const SplitField<Scalar>& in, SplitField<Scalar>& out) const;   // not aliased
+    void set_absorption(const VectorX<Scalar>& absorption, size_t layer);
+    size_t size() const { return m_rows*m_cols; }
+};
+
+#endif
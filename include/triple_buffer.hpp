@@ -0,0 +1,46 @@
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+#include <iostream>
+#include <atomic>
+#include <array>
+#include <cstdint>
+
+// Lock-free single producer / single consumer handoff of the latest value.
+// The producer fills get_back() then publish()es it, the consumer calls acquire() and reads get_front().
+// The two never wait on each other: a value published twice before the consumer looks is simply replaced,
+// and the consumer keeps its front buffer until a newer one is available.
+template<typename T>
+class TripleBuffer
+{
+    static constexpr uint8_t INDEX_MASK = 0b011;
+    static constexpr uint8_t FRESH_BIT  = 0b100;   // set on the middle index when it holds an unread value
+
+    std::array<T, 3> m_buffers{};
+    std::atomic<uint8_t> m_middle{1};
+    uint8_t m_back{0};      // producer side only
+    uint8_t m_front{2};     // consumer side only
+public:
+    TripleBuffer() = default;
+    explicit TripleBuffer(const T& initial) : m_buffers{initial, initial, initial} {}
+
+    auto get_back() -> T& { return m_buffers[m_back]; }
+    void publish()
+    {
+        uint8_t previous = m_middle.exchange(m_back | FRESH_BIT, std::memory_order_acq_rel);
+        m_back = previous & INDEX_MASK;
+    }
+
+    // Returns true when a newer value than the previous front one was taken.
+    bool acquire()
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & FRESH_BIT) == 0)
+            return false;
+        uint8_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = previous & INDEX_MASK;
+        return true;
+    }
+    auto get_front() const -> const T& { return m_buffers[m_front]; }
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+// Runs a set of independent tasks of very different durations on a fixed number of threads.
+// The tasks are dealt round robin into one deque per worker; a worker takes its own from the back and,
+// once out of work, steals from the front of the others, so no core idles while tasks are queued anywhere.
+class WorkStealingPool
+{
+public:
+    using Task = std::function<void()>;
+private:
+    struct Queue
+    {
+        std::mutex mutex{};
+        std::deque<Task> tasks{};
+    };
+    size_t m_thread_count{};
+    std::vector<Queue> m_queues{};
+    std::atomic<size_t> m_steals{};
+public:
+    explicit WorkStealingPool(size_t threads = std::thread::hardware_concurrency());
+    void run(std::vector<Task> tasks);      // returns once every task has run, rethrows the first exception of a task
+    size_t get_thread_count() const { return m_thread_count; }
+    size_t get_steals() const { return m_steals.load(); }
+private:
+    bool pop(size_t worker, Task& task);
+    bool steal(size_t thief, Task& task);
+};
+
+#endif
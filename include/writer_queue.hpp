@@ -0,0 +1,113 @@
+#ifndef WRITER_QUEUE_HPP
+#define WRITER_QUEUE_HPP
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+// Bounded handoff from the solver to a background writer thread, over a pool of buffers sized once.
+// The producer acquire()s a free buffer, fills it and submit()s it; the writer thread hands every submitted buffer,
+// in order, to the consumer given to start(), then returns it to the pool. Nothing is allocated once started.
+// The consumer must not throw: a write failure is kept by the owner and the queue still drained, so that the
+// producer is never blocked on a dead writer.
+template<typename Item>
+class WriterQueue
+{
+    std::vector<Item> m_pool{};
+    std::vector<Item*> m_free{};
+    std::deque<Item*> m_pending{};
+    std::function<void(Item&)> m_consume{};
+    std::mutex m_mutex{};
+    std::condition_variable m_item_ready{};
+    std::condition_variable m_item_free{};
+    bool m_closing{false};
+    std::atomic<size_t> m_stalls{};
+    std::thread m_thread{};
+public:
+    WriterQueue() = default;
+    WriterQueue(const WriterQueue&) = delete;
+    WriterQueue& operator=(const WriterQueue&) = delete;
+    ~WriterQueue() { close(); }
+
+    // depth copies of prototype, at least one
+    void start(size_t depth, const Item& prototype, std::function<void(Item&)> consume)
+    {
+        m_pool.assign(std::max<size_t>(depth, 1), prototype);
+        for (auto& item : m_pool)
+        {
+            m_free.push_back(&item);
+        }
+        m_consume = std::move(consume);
+        m_thread  = std::thread(&WriterQueue::run, this);
+    }
+
+    // A free buffer, waited for if wait is set (counted as a stall), nullptr otherwise when the pool is exhausted.
+    auto acquire(bool wait = true) -> Item*
+    {
+        std::unique_lock lock{m_mutex};
+        if (m_free.empty())
+        {
+            if (!wait)
+                return nullptr;
+            m_stalls++;
+            m_item_free.wait(lock, [this]{ return !m_free.empty(); });
+        }
+        Item* item = m_free.back();
+        m_free.pop_back();
+        return item;
+    }
+    void submit(Item* item)
+    {
+        {
+            std::lock_guard lock{m_mutex};
+            m_pending.push_back(item);
+        }
+        m_item_ready.notify_one();
+    }
+    // Drains the queue and joins the writer thread, once.
+    void close()
+    {
+        {
+            std::lock_guard lock{m_mutex};
+            m_closing = true;
+        }
+        m_item_ready.notify_one();
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+    size_t get_stalls() const { return m_stalls.load(); }
+private:
+    void run()
+    {
+        while (true)
+        {
+            Item* item{};
+            {
+                std::unique_lock lock{m_mutex};
+                m_item_ready.wait(lock, [this]{ return m_closing || !m_pending.empty(); });
+                if (m_pending.empty())
+                    return;
+                item = m_pending.front();
+                m_pending.pop_front();
+            }
+
+            m_consume(*item);
+
+            {
+                std::lock_guard lock{m_mutex};
+                m_free.push_back(item);
+            }
+            m_item_free.notify_one();
+        }
+    }
+};
+
+#endif
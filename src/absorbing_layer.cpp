@@ -0,0 +1,28 @@
+#include "absorbing_layer.hpp"
+#include <algorithm>
+
+template<typename Scalar>
+auto AbsorbingLayer::get_potential(size_t Nx, size_t Ny) const -> VectorX<Scalar>
+{
+    using Real = Real<Scalar>;
+    const size_t rows = Ny-2;
+    const size_t cols = Nx-2;
+    VectorX<Scalar> potential = VectorX<Scalar>::Zero(rows*cols);
+    if (!is_enabled())
+        return potential;
+
+    for (size_t jx = 0; jx < cols; jx++)
+    {
+        for (size_t iy = 0; iy < rows; iy++)
+        {
+            const size_t distance = std::min({jx + 1, cols - jx, iy + 1, rows - iy});
+            if (distance > thickness)
+                continue;
+            const Real s = Real(thickness + 1 - distance)/Real(thickness);
+            potential[jx*rows + iy] = Real(strength)*s*s;
+        }
+    }
+    return potential;
+}
+template auto AbsorbingLayer::get_potential<std::complex<float>>(size_t, size_t) const -> VectorX<std::complex<float>>;
+template auto AbsorbingLayer::get_potential<std::complex<double>>(size_t, size_t) const -> VectorX<std::complex<double>>;
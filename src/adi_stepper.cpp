@@ -0,0 +1,324 @@
+#include "adi_stepper.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+// rows handled together by one thread during the x sweep: long enough to vectorize, short enough to stay in cache
+constexpr Eigen::Index ROW_BLOCK = 64;
+
+template<typename Scalar>
+AdiStepper<Scalar>::AdiStepper(size_t Nx, size_t Ny, Scalar rx, Scalar ry, const ActivityOptions& activity)
+    : m_rows{Ny-2}, m_cols{Nx-2}, m_rx{rx}, m_ry{ry}, m_x_line{factorize(Nx-2, rx)}, m_y_line{factorize(Ny-2, ry)}, m_activity{activity}
+{
+    m_psi_temp = VectorX<Scalar>::Zero(m_rows*m_cols);
+}
+template<typename Scalar>
+auto AdiStepper<Scalar>::factorize(size_t N, Scalar r) -> ThomasCoefficients
+{
+    // The tridiagonal matrix (-r, 1+2r, -r) is the same for every line, so the forward elimination
+    // coefficients are computed once here and only the right hand side is swept at each step.
+    // Those of a shorter line, starting at the same end, are the first ones of the list.
+    ThomasCoefficients coeffs{};
+    coeffs.off_diag = -r;
+    coeffs.c_prime.resize(N);
+    coeffs.inv_denom.resize(N);
+
+    const Real<Scalar> one{1}, two{2};
+    Scalar diag = one + two*r;
+    coeffs.inv_denom[0] = one/diag;
+    coeffs.c_prime[0]   = coeffs.off_diag*coeffs.inv_denom[0];
+    for (size_t i = 1; i < N; i++)
+    {
+        coeffs.inv_denom[i] = one/(diag - coeffs.off_diag*coeffs.c_prime[i-1]);
+        coeffs.c_prime[i]   = coeffs.off_diag*coeffs.inv_denom[i];
+    }
+    return coeffs;
+}
+template<typename Scalar>
+void AdiStepper<Scalar>::step(VectorX<Scalar>& psi)
+{
+    advance(psi.data(), 0);
+}
+template<typename Scalar>
+void AdiStepper<Scalar>::step_batch(Eigen::Map<MatrixX<Scalar>> psi)
+{
+    // Packets are contiguous columns, advanced in place one after the other, each in its own window
+    for (Eigen::Index k = 0; k < psi.cols(); k++)
+    {
+        advance(psi.col(k).data(), static_cast<size_t>(k));
+    }
+}
+template<typename Scalar>
+void AdiStepper<Scalar>::advance(Scalar* psi, size_t packet)
+{
+    ActiveWindow window{.width = m_cols, .height = m_rows};
+    PacketActivity* activity = nullptr;
+    if (m_activity.is_enabled())
+    {
+        if (m_packets.size() <= packet)
+            m_packets.resize(packet + 1);
+        activity = &m_packets[packet];
+        if (!activity->started)
+        {
+            Eigen::Map<const VectorX<Scalar>> all(psi, m_rows*m_cols);
+            const Real<Scalar> threshold = m_activity.threshold;
+            activity->initial_norm = all.template cast<std::complex<double>>().squaredNorm();
+            activity->cutoff       = threshold*threshold*all.cwiseAbs2().maxCoeff();
+            activity->window       = find_window(psi, window, activity->cutoff);
+            activity->discarded    = discard_outside(psi, window, activity->window);
+            activity->started      = true;
+        }
+        window = activity->window;
+    }
+    if (window.get_cells() == 0)
+        return;
+
+    explicit_y(psi, m_psi_temp.data(), window);
+    implicit_x(m_psi_temp.data(), window);
+    explicit_x(m_psi_temp.data(), psi, window);
+    implicit_y(psi, window);
+
+    if (activity)
+    {
+        const ActiveWindow next = find_window(psi, window, activity->cutoff);
+        activity->discarded += discard_outside(psi, window, next);
+        activity->window     = next;
+    }
+}
+template<typename Scalar>
+auto AdiStepper<Scalar>::get_active_window(size_t packet) const -> std::optional<ActiveWindow>
+{
+    if (packet >= m_packets.size() || !m_packets[packet].started)
+        return std::nullopt;
+    return m_packets[packet].window;
+}
+template<typename Scalar>
+double AdiStepper<Scalar>::get_discarded_probability() const
+{
+    double worst{};
+    for (const auto& activity : m_packets)
+    {
+        if (activity.initial_norm > 0)
+            worst = std::max(worst, activity.discarded/activity.initial_norm);
+    }
+    return worst;
+}
+template<typename Scalar>
+auto AdiStepper<Scalar>::save_state() const -> std::vector<StepperPacketState>
+{
+    std::vector<StepperPacketState> state{};
+    for (const auto& activity : m_packets)
+    {
+        state.push_back({.x0 = activity.window.x0, .y0 = activity.window.y0, .width = activity.window.width, .height = activity.window.height,
+                         .cutoff = activity.cutoff, .initial_norm = activity.initial_norm, .discarded = activity.discarded, .started = activity.started});
+    }
+    return state;
+}
+template<typename Scalar>
+void AdiStepper<Scalar>::restore_state(std::span<const StepperPacketState> state)
+{
+    // the cutoff in particular: found again from a later psi, it would no longer be the one of the initial max |psi|
+    m_packets.clear();
+    for (const auto& packet : state)
+    {
+        if (packet.x0 + packet.width > m_cols || packet.y0 + packet.height > m_rows)
+        {
+            throw std::invalid_argument("active window outside of the grid");
+        }
+        m_packets.push_back({.started = packet.started != 0,
+                             .window = {.x0 = packet.x0, .y0 = packet.y0, .width = packet.width, .height = packet.height},
+                             .cutoff = static_cast<Real<Scalar>>(packet.cutoff), .initial_norm = packet.initial_norm, .discarded = packet.discarded});
+    }
+}
+template<typename Scalar>
+void AdiStepper<Scalar>::explicit_y(const Scalar* in, Scalar* out, const ActiveWindow& window) const
+{
+    const Eigen::Index rows   = m_rows;
+    const Eigen::Index x0     = window.x0;
+    const Eigen::Index x1     = window.x0 + window.width;
+    const Eigen::Index height = window.height;
+    const Scalar diag = Real<Scalar>(1) - Real<Scalar>(2)*m_ry;
+
+    #pragma omp parallel for schedule(static)
+    for (Eigen::Index jx = x0; jx < x1; jx++)
+    {
+        const Scalar* src = in  + jx*rows + window.y0;
+        Scalar*       dst = out + jx*rows + window.y0;
+        if (height == 1)
+        {
+            dst[0] = diag*src[0];
+            continue;
+        }
+        dst[0] = diag*src[0] + m_ry*src[1];
+        for (Eigen::Index iy = 1; iy < height-1; iy++)
+        {
+            dst[iy] = diag*src[iy] + m_ry*(src[iy-1] + src[iy+1]);
+        }
+        dst[height-1] = diag*src[height-1] + m_ry*src[height-2];
+    }
+}
+template<typename Scalar>
+void AdiStepper<Scalar>::explicit_x(const Scalar* in, Scalar* out, const ActiveWindow& window) const
+{
+    const Eigen::Index rows   = m_rows;
+    const Eigen::Index cols   = m_cols;
+    const Eigen::Index x0     = window.x0;
+    const Eigen::Index x1     = window.x0 + window.width;
+    const Eigen::Index y0     = window.y0;
+    const Eigen::Index height = window.height;
+    const Scalar diag = Real<Scalar>(1) - Real<Scalar>(2)*m_rx;
+    Eigen::Map<const MatrixX<Scalar>> src(in,  rows, cols);
+    Eigen::Map<MatrixX<Scalar>>       dst(out, rows, cols);
+
+    #pragma omp parallel for schedule(static)
+    for (Eigen::Index jx = x0; jx < x1; jx++)
+    {
+        dst.col(jx).segment(y0, height) = diag*src.col(jx).segment(y0, height);
+        if (jx != x0)
+            dst.col(jx).segment(y0, height) += m_rx*src.col(jx-1).segment(y0, height);
+        if (jx != x1-1)
+            dst.col(jx).segment(y0, height) += m_rx*src.col(jx+1).segment(y0, height);
+    }
+}
+template<typename Scalar>
+void AdiStepper<Scalar>::implicit_x(Scalar* psi, const ActiveWindow& window) const
+{
+    // One tridiagonal system per row (stride Ny-2 in memory). Rows are swept together, block by block,
+    // so that every elimination step is a contiguous, vectorizable operation on a piece of a column.
+    const Eigen::Index rows  = m_rows;
+    const Eigen::Index cols  = m_cols;
+    const Eigen::Index x0    = window.x0;
+    const Eigen::Index width = window.width;
+    const Eigen::Index y0    = window.y0;
+    const Eigen::Index y1    = window.y0 + window.height;
+    const auto& line = m_x_line;
+    Eigen::Map<MatrixX<Scalar>> grid(psi, rows, cols);
+
+    #pragma omp parallel for schedule(static)
+    for (Eigen::Index r0 = y0; r0 < y1; r0 += ROW_BLOCK)
+    {
+        const Eigen::Index len = std::min(ROW_BLOCK, y1 - r0);
+        grid.col(x0).segment(r0, len) *= line.inv_denom[0];
+        for (Eigen::Index j = 1; j < width; j++)
+        {
+            grid.col(x0+j).segment(r0, len) = (grid.col(x0+j).segment(r0, len) - line.off_diag*grid.col(x0+j-1).segment(r0, len))*line.inv_denom[j];
+        }
+        for (Eigen::Index j = width-2; j >= 0; j--)
+        {
+            grid.col(x0+j).segment(r0, len) -= line.c_prime[j]*grid.col(x0+j+1).segment(r0, len);
+        }
+    }
+}
+template<typename Scalar>
+void AdiStepper<Scalar>::implicit_y(Scalar* psi, const ActiveWindow& window) const
+{
+    // One tridiagonal system per column, contiguous in memory.
+    const Eigen::Index rows   = m_rows;
+    const Eigen::Index x0     = window.x0;
+    const Eigen::Index x1     = window.x0 + window.width;
+    const Eigen::Index height = window.height;
+    const auto& line = m_y_line;
+
+    #pragma omp parallel for schedule(static)
+    for (Eigen::Index jx = x0; jx < x1; jx++)
+    {
+        Scalar* d = psi + jx*rows + window.y0;
+        d[0] *= line.inv_denom[0];
+        for (Eigen::Index iy = 1; iy < height; iy++)
+        {
+            d[iy] = (d[iy] - line.off_diag*d[iy-1])*line.inv_denom[iy];
+        }
+        for (Eigen::Index iy = height-2; iy >= 0; iy--)
+        {
+            d[iy] -= line.c_prime[iy]*d[iy+1];
+        }
+    }
+}
+template<typename Scalar>
+auto AdiStepper<Scalar>::find_window(const Scalar* psi, const ActiveWindow& within, Real<Scalar> cutoff) const -> ActiveWindow
+{
+    // first and last active row of every column, then their bounding box grown by the margin
+    const Eigen::Index rows   = m_rows;
+    const Eigen::Index width  = within.width;
+    const Eigen::Index height = within.height;
+    std::vector<Eigen::Index> first(width, height);
+    std::vector<Eigen::Index> last(width, -1);
+
+    #pragma omp parallel for schedule(static)
+    for (Eigen::Index j = 0; j < width; j++)
+    {
+        // from both ends, stopping at the first active cell: a column the packet fills is barely read
+        const Scalar* column = psi + (within.x0 + j)*rows + within.y0;
+        Eigen::Index iy = 0;
+        while (iy < height && std::norm(column[iy]) <= cutoff)
+            iy++;
+        if (iy == height)
+            continue;
+        first[j] = iy;
+        iy = height-1;
+        while (std::norm(column[iy]) <= cutoff)
+            iy--;
+        last[j] = iy;
+    }
+
+    Eigen::Index x_first = width, x_last = -1, y_first = height, y_last = -1;
+    for (Eigen::Index j = 0; j < width; j++)
+    {
+        if (last[j] < 0)
+            continue;
+        x_first = std::min(x_first, j);
+        x_last  = j;
+        y_first = std::min(y_first, first[j]);
+        y_last  = std::max(y_last, last[j]);
+    }
+    if (x_last < 0)
+        return ActiveWindow{.x0 = within.x0, .y0 = within.y0};
+
+    const size_t margin = m_activity.margin;
+    const size_t x_begin = within.x0 + x_first,  x_end = within.x0 + x_last + 1;
+    const size_t y_begin = within.y0 + y_first,  y_end = within.y0 + y_last + 1;
+    ActiveWindow window{};
+    window.x0     = (x_begin > margin)? x_begin - margin : 0;
+    window.y0     = (y_begin > margin)? y_begin - margin : 0;
+    window.width  = std::min(x_end + margin, m_cols) - window.x0;
+    window.height = std::min(y_end + margin, m_rows) - window.y0;
+    return window;
+}
+template<typename Scalar>
+auto AdiStepper<Scalar>::discard_outside(Scalar* psi, const ActiveWindow& from, const ActiveWindow& kept) const -> double
+{
+    // zeroes what is in the old window but not in the new one, keeping psi zero outside the window
+    const Eigen::Index rows    = m_rows;
+    const Eigen::Index x0      = from.x0;
+    const Eigen::Index x1      = from.x0 + from.width;
+    const Eigen::Index y0      = from.y0;
+    const Eigen::Index y1      = from.y0 + from.height;
+    const Eigen::Index kept_x0 = kept.x0, kept_x1 = kept.x0 + kept.width;
+    const Eigen::Index kept_y0 = std::clamp<Eigen::Index>(kept.y0, y0, y1);
+    const Eigen::Index kept_y1 = std::clamp<Eigen::Index>(kept.y0 + kept.height, kept_y0, y1);
+    double discarded{};
+
+    #pragma omp parallel for schedule(static) reduction(+:discarded)
+    for (Eigen::Index jx = x0; jx < x1; jx++)
+    {
+        Scalar* column = psi + jx*rows;
+        auto drop = [&](Eigen::Index begin, Eigen::Index end)
+        {
+            for (Eigen::Index iy = begin; iy < end; iy++)
+            {
+                discarded += std::norm(column[iy]);
+                column[iy] = Scalar{};
+            }
+        };
+        if (kept.get_cells() == 0 || jx < kept_x0 || jx >= kept_x1)
+        {
+            drop(y0, y1);
+            continue;
+        }
+        drop(y0, kept_y0);
+        drop(kept_y1, y1);
+    }
+    return discarded;
+}
+
+template class AdiStepper<std::complex<float>>;
+template class AdiStepper<std::complex<double>>;
@@ -0,0 +1,223 @@
+#include "checkpoint.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <filesystem>
+#include <print>
+#include <stdexcept>
+#include <utility>
+#include "operator_cache.hpp"
+#include "mapped_file.hpp"
+#include "profiler.hpp"
+
+// The checksums of the operator cache sections: FNV-1a over 64-bit words, eight times fewer multiplies over psi,
+// which is checksummed on every checkpoint.
+static auto get_header_checksum(const CheckpointHeader& header) -> uint64_t
+{
+    return CacheKey{}.add_bytes(std::as_bytes(std::span(&header, 1)).first(offsetof(CheckpointHeader, header_checksum))).get();
+}
+static auto get_payload_checksum(std::span<const float> wave_numbers, std::span<const StepperPacketState> stepper_state,
+                                 std::span<const MaskSpan> obstacle, std::span<const std::byte> psi) -> uint64_t
+{
+    return CacheKey{}.add_bytes(std::as_bytes(wave_numbers)).add_bytes(std::as_bytes(stepper_state))
+                     .add_bytes(std::as_bytes(obstacle)).add_bytes(psi).get();
+}
+
+auto get_obstacle_key(const ObstacleMask& barrier) -> uint64_t
+{
+    return CacheKey{}.add_all(barrier.get_pixel_spans()).get();
+}
+
+
+Checkpoint::Checkpoint(const std::string& path)
+{
+    std::ifstream file{path, std::ios::binary};
+    if (!file)
+    {
+        throw std::runtime_error("cannot open checkpoint '" + path + "'");
+    }
+    if (!file.read(reinterpret_cast<char*>(&m_header), sizeof(CheckpointHeader)))
+    {
+        throw std::runtime_error("'" + path + "' is too short to be a checkpoint");
+    }
+    if (std::memcmp(m_header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0)
+    {
+        throw std::runtime_error("'" + path + "' is not a checkpoint");
+    }
+    if (m_header.version != CHECKPOINT_VERSION)
+    {
+        throw std::runtime_error("'" + path + "' is a version " + std::to_string(m_header.version) + " checkpoint, expected version " + std::to_string(CHECKPOINT_VERSION));
+    }
+    if (m_header.header_checksum != get_header_checksum(m_header))
+    {
+        throw std::runtime_error("'" + path + "' has a corrupted header");
+    }
+    if (m_header.Nx < 3 || m_header.Ny < 3 || m_header.packets == 0 || (m_header.scalar_bytes != 8 && m_header.scalar_bytes != 16)
+        || (m_header.wave_number_count != 0 && m_header.wave_number_count != m_header.packets) || m_header.stepper_state_count > m_header.packets
+        || m_header.obstacle_spans > m_header.Nx*m_header.Ny)
+    {
+        throw std::runtime_error("'" + path + "' has an inconsistent header");
+    }
+
+    m_wave_numbers.resize(m_header.wave_number_count);
+    m_stepper_state.resize(m_header.stepper_state_count);
+    m_obstacle_spans.resize(m_header.obstacle_spans);
+    m_psi.resize(m_header.packets*(m_header.Nx-2)*(m_header.Ny-2)*m_header.scalar_bytes);
+    file.read(reinterpret_cast<char*>(m_wave_numbers.data()), static_cast<std::streamsize>(m_wave_numbers.size()*sizeof(float)));
+    file.read(reinterpret_cast<char*>(m_stepper_state.data()), static_cast<std::streamsize>(m_stepper_state.size()*sizeof(StepperPacketState)));
+    file.read(reinterpret_cast<char*>(m_obstacle_spans.data()), static_cast<std::streamsize>(m_obstacle_spans.size()*sizeof(MaskSpan)));
+    file.read(reinterpret_cast<char*>(m_psi.data()), static_cast<std::streamsize>(m_psi.size()));
+    if (!file)
+    {
+        throw std::runtime_error("'" + path + "' is truncated");
+    }
+    if (m_header.payload_checksum != get_payload_checksum(m_wave_numbers, m_stepper_state, m_obstacle_spans, m_psi))
+    {
+        throw std::runtime_error("'" + path + "' has a corrupted wavefunction");
+    }
+    for (const MaskSpan& span : m_obstacle_spans)
+    {
+        if (uint64_t{span.begin} + span.length > m_header.Nx*m_header.Ny)
+        {
+            throw std::runtime_error("'" + path + "' has an obstacle outside of the grid");
+        }
+    }
+}
+auto Checkpoint::get_obstacle() const -> ObstacleMask
+{
+    std::vector<uint8_t> cells(m_header.Nx*m_header.Ny, 0);
+    for (const MaskSpan& span : m_obstacle_spans)
+    {
+        std::fill_n(cells.begin() + span.begin, span.length, uint8_t{1});
+    }
+    return ObstacleMask{m_header.Nx, m_header.Ny, cells};
+}
+template<typename Scalar>
+auto Checkpoint::get_psi() const -> VectorX<Scalar>
+{
+    if (m_header.scalar_bytes != sizeof(Scalar))
+    {
+        throw std::runtime_error("checkpoint taken in " + std::string(m_header.scalar_bytes == 8? "single" : "double") + " precision");
+    }
+    VectorX<Scalar> psi(static_cast<Eigen::Index>(m_psi.size()/sizeof(Scalar)));
+    std::memcpy(psi.data(), m_psi.data(), m_psi.size());
+    return psi;
+}
+template auto Checkpoint::get_psi<std::complex<float>>() const  -> VectorX<std::complex<float>>;
+template auto Checkpoint::get_psi<std::complex<double>>() const -> VectorX<std::complex<double>>;
+void Checkpoint::check_geometry(size_t Nx, size_t Ny, size_t packets, const ObstacleMask& barrier) const
+{
+    if (m_header.Nx != Nx || m_header.Ny != Ny || m_header.packets != packets)
+    {
+        throw std::runtime_error(std::format("checkpoint of {} packet(s) on a {}x{} grid, the run has {} on {}x{}",
+                                             m_header.packets, m_header.Nx, m_header.Ny, packets, Nx, Ny));
+    }
+    if (m_header.obstacle_key != get_obstacle_key(barrier))
+    {
+        throw std::runtime_error("checkpoint taken with another obstacle");
+    }
+}
+
+
+CheckpointWriter::CheckpointWriter(const std::string& path, const CheckpointHeader& header, const ObstacleMask& barrier,
+                                   std::span<const float> wave_numbers, std::chrono::duration<float> interval)
+    : m_path{path}, m_header{header}, m_wave_numbers(wave_numbers.begin(), wave_numbers.end()),
+      m_obstacle_spans(barrier.get_pixel_spans().begin(), barrier.get_pixel_spans().end()),
+      m_interval{std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval)}, m_last_save{std::chrono::steady_clock::now()}
+{
+    std::memcpy(m_header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    m_header.version           = CHECKPOINT_VERSION;
+    m_header.wave_number_count = static_cast<uint32_t>(m_wave_numbers.size());
+    m_header.obstacle_spans    = m_obstacle_spans.size();
+    m_psi_bytes = m_header.packets*(m_header.Nx-2)*(m_header.Ny-2)*m_header.scalar_bytes;
+    m_queue.start(1, State{.psi = std::vector<std::byte>(m_psi_bytes)}, [this](State& state)     // sized once, save() only copies
+    {
+        PROFILE_SCOPE(PHASE::CHECKPOINT);
+        write(state);
+    });
+}
+CheckpointWriter::~CheckpointWriter()
+{
+    try
+    {
+        close();
+    }
+    catch(const std::exception& e)
+    {
+        std::println("Checkpoint failure: {}", e.what());
+    }
+}
+void CheckpointWriter::set_time_step(float dt)
+{
+    m_header.dt = dt;
+}
+template<typename Scalar>
+void CheckpointWriter::save(const VectorX<Scalar>& psi, std::span<const StepperPacketState> stepper_state, const CheckpointClock& clock)
+{
+    if (sizeof(Scalar) != m_header.scalar_bytes || psi.size()*sizeof(Scalar) != m_psi_bytes)
+    {
+        throw std::invalid_argument("wavefunction of " + std::to_string(psi.size()) + " values for a checkpoint of " + std::to_string(m_psi_bytes) + " bytes");
+    }
+    if (stepper_state.size() > m_header.packets)
+    {
+        throw std::invalid_argument("stepper state of " + std::to_string(stepper_state.size()) + " packets for a checkpoint of " + std::to_string(m_header.packets));
+    }
+    // the one buffer, once the writer thread is done with the previous checkpoint
+    State* state = m_queue.acquire();
+    std::memcpy(state->psi.data(), psi.data(), m_psi_bytes);
+    state->stepper_state.assign(stepper_state.begin(), stepper_state.end());
+    state->header      = m_header;
+    state->header.stepper_state_count = static_cast<uint32_t>(stepper_state.size());
+    state->header.step = clock.step;
+    state->header.time = clock.time;
+    m_last_save        = std::chrono::steady_clock::now();
+    m_queue.submit(state);
+}
+template void CheckpointWriter::save(const VectorX<std::complex<float>>&, std::span<const StepperPacketState>, const CheckpointClock&);
+template void CheckpointWriter::save(const VectorX<std::complex<double>>&, std::span<const StepperPacketState>, const CheckpointClock&);
+void CheckpointWriter::close()
+{
+    m_queue.close();
+    if (!m_error.empty())
+    {
+        throw std::runtime_error(std::exchange(m_error, {}));
+    }
+}
+void CheckpointWriter::write(const State& state)
+{
+    CheckpointHeader complete = state.header;
+    complete.payload_checksum = get_payload_checksum(m_wave_numbers, state.stepper_state, m_obstacle_spans, state.psi);
+    complete.header_checksum  = get_header_checksum(complete);
+
+    const std::string temporary = get_temporary_path(m_path);
+    try
+    {
+        {
+            std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+            file.write(reinterpret_cast<const char*>(&complete), sizeof(CheckpointHeader));
+            file.write(reinterpret_cast<const char*>(m_wave_numbers.data()), static_cast<std::streamsize>(m_wave_numbers.size()*sizeof(float)));
+            file.write(reinterpret_cast<const char*>(state.stepper_state.data()), static_cast<std::streamsize>(state.stepper_state.size()*sizeof(StepperPacketState)));
+            file.write(reinterpret_cast<const char*>(m_obstacle_spans.data()), static_cast<std::streamsize>(m_obstacle_spans.size()*sizeof(MaskSpan)));
+            file.write(reinterpret_cast<const char*>(state.psi.data()), static_cast<std::streamsize>(state.psi.size()));
+            file.flush();
+            if (!file)
+            {
+                throw std::runtime_error("cannot write checkpoint '" + temporary + "'");
+            }
+        }
+        // the previous checkpoint stays in place until this one is whole, on the disk and not only in the page cache
+        sync_file(temporary);
+        std::filesystem::rename(temporary, m_path);
+        sync_directory(m_path);
+        m_written++;
+        m_error.clear();
+    }
+    catch(const std::exception& e)
+    {
+        m_error = e.what();     // the next checkpoint is still attempted: the disk may have been full for a moment
+        std::error_code ignored{};
+        std::filesystem::remove(temporary, ignored);
+    }
+}
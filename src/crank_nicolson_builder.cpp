@@ -1,50 +1,98 @@
 #include "crank_nicolson_builder.hpp"
  
-using Trplt = Eigen::Triplet<std::complex<float>>;
+template<typename Scalar>
+using Trplt = Eigen::Triplet<Scalar>;
 
 
-CrankNicolsonBuilder::CrankNicolsonBuilder()
+template<typename Scalar>
+CrankNicolsonBuilder<Scalar>::CrankNicolsonBuilder()
 {
 }
-void CrankNicolsonBuilder::set_num_elements(size_t Nx, size_t Ny)
+template<typename Scalar>
+void CrankNicolsonBuilder<Scalar>::set_num_elements(size_t Nx, size_t Ny)
 {
     m_Nx = Nx;
     m_Ny = Ny;
     N_center = (m_Ny-2)*(m_Nx-2);
 }
-void CrankNicolsonBuilder::set_diagonal_elements(std::complex<float> a0, std::complex<float> b0) // define
+template<typename Scalar>
+void CrankNicolsonBuilder<Scalar>::set_diagonal_elements(Scalar a0, Scalar b0) // define
 {
     m_a0 = a0;
     m_b0 = b0;
 }
-void CrankNicolsonBuilder::set_off_diag_elements(std::complex<float> rx, std::complex<float> ry)
+template<typename Scalar>
+void CrankNicolsonBuilder<Scalar>::set_off_diag_elements(Scalar rx, Scalar ry)
 {
     m_rx = rx;
     m_ry = ry;
 }
-auto CrankNicolsonBuilder::get_sparse_matrices() const -> std::tuple<SparseMatrix,SparseMatrix>
+template<typename Scalar>
+void CrankNicolsonBuilder<Scalar>::set_free_cells(const FreeCellMap& free_cells)
 {
-    SparseMatrix sparse_A, sparse_M;
+    m_free_cells = free_cells;
+}
+template<typename Scalar>
+void CrankNicolsonBuilder<Scalar>::set_absorption(const VectorX<Scalar>& absorption)
+{
+    m_absorption = absorption;
+}
+template<typename Scalar>
+void CrankNicolsonBuilder<Scalar>::check_sizes() const
+{
+    if (m_free_cells && m_free_cells->get_full_size() != N_center)
+    {
+        throw std::invalid_argument("free cell map of " + std::to_string(m_free_cells->get_full_size()) + " cells for " + std::to_string(N_center) + " unknowns");
+    }
+    if (m_absorption.size() != 0 && static_cast<size_t>(m_absorption.size()) != N_center)
+    {
+        throw std::invalid_argument("absorption of " + std::to_string(m_absorption.size()) + " cells for " + std::to_string(N_center) + " unknowns");
+    }
+}
+template<typename Scalar>
+auto CrankNicolsonBuilder<Scalar>::get_sparse_matrices() const -> std::tuple<SparseMatrix<Scalar>,SparseMatrix<Scalar>>
+{
+    // The 5-point stencil is written straight into triplet lists (at most 5 entries per row),
+    // so assembly stays O(N_center) in time and memory instead of going through dense N_center x N_center matrices.
+    check_sizes();
+    const size_t N = get_unknowns();
+    SparseMatrix<Scalar> sparse_A(N, N);
+    SparseMatrix<Scalar> sparse_M(N, N);
     {
-        Eigen::MatrixXcf dense_A, dense_M;
-        init_dense_matrices(dense_A, dense_M);
-        set_dense_matrices(dense_A, dense_M);
-        sparse_A = std::move(dense_A.sparseView()); 
-        sparse_M = std::move(dense_M.sparseView()); 
+        std::vector<Trplt<Scalar>> triplets_A, triplets_M;
+        set_triplets(triplets_A, &triplets_M);
+        sparse_A.setFromTriplets(triplets_A.begin(), triplets_A.end());
+        sparse_M.setFromTriplets(triplets_M.begin(), triplets_M.end());
     }
-    sparse_A.SparseMatrix::makeCompressed();
-    sparse_M.SparseMatrix::makeCompressed();
-    return std::tuple(sparse_A, sparse_M);
+    sparse_A.makeCompressed();
+    sparse_M.makeCompressed();
+    return std::tuple(std::move(sparse_A), std::move(sparse_M));
 }
-void CrankNicolsonBuilder::init_dense_matrices(Eigen::MatrixXcf& A, Eigen::MatrixXcf& M) const
+template<typename Scalar>
+auto CrankNicolsonBuilder<Scalar>::get_sparse_A() const -> SparseMatrix<Scalar>
 {
-    A   =  Eigen::MatrixXcf::Zero(N_center, N_center);
-    M   =  Eigen::MatrixXcf::Zero(N_center, N_center);
+    check_sizes();
+    const size_t N = get_unknowns();
+    SparseMatrix<Scalar> sparse_A(N, N);
+    {
+        std::vector<Trplt<Scalar>> triplets_A;
+        set_triplets(triplets_A, nullptr);
+        sparse_A.setFromTriplets(triplets_A.begin(), triplets_A.end());
+    }
+    sparse_A.makeCompressed();
+    return sparse_A;
 }
-void CrankNicolsonBuilder::set_dense_matrices(Eigen::MatrixXcf& A, Eigen::MatrixXcf& M) const
+template<typename Scalar>
+void CrankNicolsonBuilder<Scalar>::set_triplets(std::vector<Trplt<Scalar>>& A, std::vector<Trplt<Scalar>>* M) const
 {
-    A.diagonal(0) << Eigen::VectorXcf::Constant(N_center, m_a0);
-    M.diagonal(0) << Eigen::VectorXcf::Constant(N_center, m_b0);
+    A.reserve(5*N_center);
+    if (M)
+        M->reserve(5*N_center);
+
+    auto index = [&](size_t k) -> int64_t
+    {
+        return m_free_cells? m_free_cells->get_compact_index(k) : static_cast<int64_t>(k);
+    };
 
     // Psi_{i,j} = psi(y,x) = {psi(1,1), psi(2,1), psi(3,1), ... psi(Ny-2,1), psi(1,2) etc} // column major ordering
     size_t iy{}, jx{};
@@ -54,31 +102,48 @@ void CrankNicolsonBuilder::set_dense_matrices(Eigen::MatrixXcf& A, Eigen::Matrix
         iy = 1 + k%(m_Ny-2);          
         jx = 1 + k/(m_Ny-2);
 
+        // With free cells set, rows and columns are renumbered compactly and obstacle cells dropped like the walls
+        const int64_t row = index(k);
+        if (row < 0)
+            continue;
+
+        // (1 + i dt/2 H) psi' = (1 - i dt/2 H) psi with H = H0 - i W: dt/2 W onto A's diagonal, off M's
+        const Scalar absorption = (m_absorption.size() != 0)? m_absorption[k] : Scalar{};
+        A.emplace_back(row, row, m_a0 + absorption);
+        if (M)
+            M->emplace_back(row, row, m_b0 - absorption);
+        auto couple = [&](size_t neighbour, Scalar r)
+        {
+            if (const int64_t col = index(neighbour); col >= 0)
+            {
+                A.emplace_back(row, col, -r);
+                if (M)
+                    M->emplace_back(row, col, +r);
+            }
+        };
 
         // Jumping from (x,y) -> (x,y-1)
         if (iy != 1) 
         {
-            A(k, k-1) = -m_ry;
-            M(k, k-1) = +m_ry;
+            couple(k-1, m_ry);
         }
         // Jumping from (x,y) -> (x,y+1)
         if (iy != m_Ny-2) //
         {
-            A(k, k+1) = -m_ry;
-            M(k, k+1) = +m_ry;
+            couple(k+1, m_ry);
         }
         // Jumping from (x,y) -> (x-1,y)
         if (jx != 1)    
         {
-            A(k, k - (m_Ny-2) ) = -m_rx;
-            M(k, k - (m_Ny-2) ) = +m_rx;
+            couple(k - (m_Ny-2), m_rx);
         }
         // Jumping from (x,y) -> (x+1,y)
         if (jx != (m_Nx-2)) 
         {
-            A(k, k + (m_Ny-2)) = -m_rx;
-            M(k, k + (m_Ny-2)) = +m_rx;
+            couple(k + (m_Ny-2), m_rx);
         }
     }
 }
 
+template class CrankNicolsonBuilder<std::complex<float>>;
+template class CrankNicolsonBuilder<std::complex<double>>;
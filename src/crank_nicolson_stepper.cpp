@@ -0,0 +1,76 @@
+#include "crank_nicolson_stepper.hpp"
+#include "profiler.hpp"
+
+template<typename Scalar>
+CrankNicolsonStepper<Scalar>::CrankNicolsonStepper(const SparseMatrix<Scalar>& sparse_A, const StencilOperator<Scalar>& stencil_M, std::unique_ptr<ILinearSolver<Scalar>> solver,
+                                                 std::optional<FreeCellMap> free_cells)
+    : m_solver{std::move(solver)}, m_stencil_M{stencil_M}, m_free_cells{std::move(free_cells)}
+{
+    m_solver->compute(sparse_A);
+}
+template<typename Scalar>
+CrankNicolsonStepper<Scalar>::CrankNicolsonStepper(const StencilOperator<Scalar>& stencil_M, std::unique_ptr<ILinearSolver<Scalar>> computed_solver,
+                                                 std::optional<FreeCellMap> free_cells)
+    : m_solver{std::move(computed_solver)}, m_stencil_M{stencil_M}, m_free_cells{std::move(free_cells)}
+{
+}
+template<typename Scalar>
+void CrankNicolsonStepper<Scalar>::refactorize(const SparseMatrix<Scalar>& sparse_A, const StencilOperator<Scalar>& stencil_M)
+{
+    {
+        PROFILE_SCOPE(PHASE::FACTORIZATION);
+        m_solver->refactorize(sparse_A);
+    }
+    m_stencil_M = stencil_M;
+}
+template<typename Scalar>
+void CrankNicolsonStepper<Scalar>::step(VectorX<Scalar>& psi)
+{
+    {
+        PROFILE_SCOPE(PHASE::RHS_PRODUCT);
+        m_stencil_M.apply(psi, m_psi_temp);
+    }
+    PROFILE_SCOPE(PHASE::SOLVE);
+    if (!m_free_cells)
+    {
+        m_solver->solve(m_psi_temp, psi);
+        return;
+    }
+    // psi being zero on the obstacle, the free rows of M psi are the right hand side of the reduced system
+    m_free_cells->gather(m_psi_temp, m_rhs);
+    m_free_cells->gather(psi, m_solution);
+    m_solver->solve(m_rhs, m_solution);
+    m_free_cells->scatter(m_solution, psi);
+}
+template<typename Scalar>
+void CrankNicolsonStepper<Scalar>::step_batch(Eigen::Map<MatrixX<Scalar>> psi)
+{
+    {
+        PROFILE_SCOPE(PHASE::RHS_PRODUCT);
+        m_block_temp.resize(psi.rows(), psi.cols());
+        for (Eigen::Index k = 0; k < psi.cols(); k++)
+        {
+            m_stencil_M.apply(psi.col(k).data(), m_block_temp.col(k).data());
+        }
+    }
+    PROFILE_SCOPE(PHASE::SOLVE);
+    if (!m_free_cells)
+    {
+        m_block_solution = psi;
+        m_solver->solve_batch(m_block_temp, m_block_solution);
+        psi = m_block_solution;
+        return;
+    }
+    m_free_cells->gather_columns<Scalar>(m_block_temp, m_block_rhs);
+    m_free_cells->gather_columns<Scalar>(psi, m_block_solution);
+    m_solver->solve_batch(m_block_rhs, m_block_solution);
+    m_free_cells->scatter_columns<Scalar>(m_block_solution, psi);
+}
+template<typename Scalar>
+size_t CrankNicolsonStepper<Scalar>::get_iterations() const
+{
+    return m_solver->get_iterations();
+}
+
+template class CrankNicolsonStepper<std::complex<float>>;
+template class CrankNicolsonStepper<std::complex<double>>;
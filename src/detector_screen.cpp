@@ -0,0 +1,126 @@
+#include "detector_screen.hpp"
+#include <print>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include "mapped_file.hpp"
+
+DetectorScreen::DetectorScreen(size_t Nx, size_t Ny, float dx, float dt, bool track_current)
+    : m_Nx{Nx}, m_Ny{Ny}, m_dx{dx}, m_dt{dt}, m_track_current{track_current}
+{
+}
+void DetectorScreen::add_region(const DetectorRegion& region)
+{
+    if (region.width == 0 || region.height == 0 || region.x0 < 1 || region.y0 < 1
+        || region.x0 + region.width > m_Nx-1 || region.y0 + region.height > m_Ny-1)
+    {
+        throw std::invalid_argument("detector region " + std::to_string(region.x0) + ":" + std::to_string(region.y0) + ":" + std::to_string(region.width) + ":" + std::to_string(region.height)
+                                    + " is not inside the interior of the " + std::to_string(m_Nx) + "x" + std::to_string(m_Ny) + " grid");
+    }
+    if (m_steps > 0)
+    {
+        throw std::logic_error("detectors cannot be added once accumulating");
+    }
+    m_detectors.push_back({region});
+}
+void DetectorScreen::add_column(size_t x)
+{
+    add_region({.x0 = x, .y0 = 1, .width = 1, .height = m_Ny-2});
+}
+size_t DetectorScreen::get_cell_count() const
+{
+    size_t cells{};
+    for (const auto& detector : m_detectors)
+        cells += detector.region.width*detector.region.height;
+    return cells;
+}
+template<typename Scalar>
+void DetectorScreen::accumulate(const VectorX<Scalar>& psi)
+{
+    using Real = Real<Scalar>;
+    const size_t rows = m_Ny-2;
+    const size_t N    = (m_Nx-2)*rows;
+    if (m_steps == 0)
+    {
+        m_packets = static_cast<size_t>(psi.size())/N;
+        for (auto& detector : m_detectors)
+        {
+            const size_t cells = detector.region.width*detector.region.height*m_packets;
+            detector.intensity.assign(cells, 0.0);
+            if (m_track_current)
+                detector.current.assign(cells, 0.0);
+        }
+    }
+
+    // Only the region's rows of each of its columns are read, a contiguous run of psi per column
+    const Real flux_scale = Real(1)/m_dx;     // 2 Im(conj(psi) (psi_right - psi_left)/(2 dx))
+    for (auto& detector : m_detectors)
+    {
+        const DetectorRegion& region = detector.region;
+        const size_t cells = region.width*region.height;
+        for (size_t packet = 0; packet < m_packets; packet++)
+        {
+            const Scalar* packet_psi = psi.data() + packet*N;
+            for (size_t column = 0; column < region.width; column++)
+            {
+                const size_t x     = region.x0 + column;
+                const Scalar* here = packet_psi + (x-1)*rows + (region.y0-1);
+                double* intensity  = detector.intensity.data() + packet*cells + column*region.height;
+                for (size_t y = 0; y < region.height; y++)
+                {
+                    intensity[y] += m_dt*static_cast<double>(std::norm(here[y]));
+                }
+                if (!m_track_current)
+                    continue;
+                const Scalar* left  = (x > 1)?      here - rows : nullptr;
+                const Scalar* right = (x < m_Nx-2)? here + rows : nullptr;
+                double* current     = detector.current.data() + packet*cells + column*region.height;
+                for (size_t y = 0; y < region.height; y++)
+                {
+                    const Scalar difference = (right? right[y] : Scalar{}) - (left? left[y] : Scalar{});
+                    current[y] += m_dt*static_cast<double>(flux_scale*std::imag(std::conj(here[y])*difference));
+                }
+            }
+        }
+    }
+    m_steps++;
+}
+template void DetectorScreen::accumulate(const VectorX<std::complex<float>>&);
+template void DetectorScreen::accumulate(const VectorX<std::complex<double>>&);
+void DetectorScreen::write(const std::string& path) const
+{
+    // Written beside and renamed over the previous file, so that a reader never sees half a file
+    const std::string temporary = get_temporary_path(path);
+    std::FILE* out = std::fopen(temporary.c_str(), "w");
+    if (!out)
+    {
+        throw std::runtime_error("cannot open '" + temporary + "' for writing");
+    }
+    std::println(out, "# {}x{} grid, dx = {}, dt = {}, {} steps, t = {:.6g}", m_Nx, m_Ny, m_dx, m_dt, m_steps, m_steps*static_cast<double>(m_dt));
+    std::println(out, "detector,packet,x,y,intensity{}", m_track_current? ",current" : "");
+    for (size_t d = 0; d < m_detectors.size(); d++)
+    {
+        const Detector& detector = m_detectors[d];
+        const DetectorRegion& region = detector.region;
+        const size_t cells = region.width*region.height;
+        for (size_t packet = 0; packet < m_packets; packet++)
+        {
+            for (size_t k = 0; k < cells; k++)
+            {
+                const size_t x = region.x0 + k/region.height;
+                const size_t y = region.y0 + k%region.height;
+                if (m_track_current)
+                    std::println(out, "{},{},{},{},{:.9e},{:.9e}", d, packet, x, y, detector.intensity[packet*cells + k], detector.current[packet*cells + k]);
+                else
+                    std::println(out, "{},{},{},{},{:.9e}", d, packet, x, y, detector.intensity[packet*cells + k]);
+            }
+        }
+    }
+    const bool failed = std::ferror(out) != 0;
+    if (std::fclose(out) != 0 || failed)
+    {
+        std::filesystem::remove(temporary);
+        throw std::runtime_error("failed writing '" + temporary + "'");
+    }
+    std::filesystem::rename(temporary, path);
+}
@@ -0,0 +1,149 @@
+#include "fill_orderings.hpp"
+#include <numeric>
+#include <algorithm>
+
+// parts of at most this many vertices are not bisected further
+constexpr size_t DISSECTION_LEAF = 64;
+// breadth-first searches spent looking for a pseudo-peripheral root, each from the end of the previous one
+constexpr size_t PERIPHERAL_SEARCHES = 4;
+
+namespace
+{
+    class NestedDissection
+    {
+        std::span<const int> m_outer{};
+        std::span<const int> m_inner{};
+        std::vector<int> m_label{};     // part each vertex belongs to, the one being dissected or one of its ancestors
+        std::vector<int> m_level{};     // in the current breadth-first search, -1 if not reached
+        int m_labels{};
+        std::vector<int> m_order{};
+    public:
+        NestedDissection(std::span<const int> outer, std::span<const int> inner)
+            : m_outer{outer}, m_inner{inner}, m_label(outer.size()-1, 0), m_level(outer.size()-1, -1)
+        {
+            m_order.reserve(outer.size()-1);
+        }
+        auto run() -> std::vector<int>
+        {
+            std::vector<int> vertices(m_label.size());
+            std::iota(vertices.begin(), vertices.end(), 0);
+            dissect(std::move(vertices));
+            return std::move(m_order);
+        }
+    private:
+        auto get_degree(int v) const -> int { return m_outer[v+1] - m_outer[v]; }
+
+        // Vertices of the part labelled label reached from root, level by level:
+        // level k is visited[level_start[k] .. level_start[k+1]).
+        void search(int root, int label, std::vector<int>& visited, std::vector<size_t>& level_start)
+        {
+            visited.assign(1, root);
+            level_start.assign(1, 0);
+            m_level[root] = 0;
+            for (size_t head = 0; head < visited.size(); head++)
+            {
+                const int v = visited[head];
+                if (static_cast<size_t>(m_level[v]) == level_start.size())
+                    level_start.push_back(head);
+                for (int e = m_outer[v]; e < m_outer[v+1]; e++)
+                {
+                    const int w = m_inner[e];
+                    if (m_label[w] == label && m_level[w] < 0)
+                    {
+                        m_level[w] = m_level[v] + 1;
+                        visited.push_back(w);
+                    }
+                }
+            }
+            level_start.push_back(visited.size());
+        }
+        void clear_levels(std::span<const int> visited)
+        {
+            for (int v : visited)
+                m_level[v] = -1;
+        }
+        void dissect(std::vector<int> vertices)
+        {
+            if (vertices.size() <= DISSECTION_LEAF)
+            {
+                m_order.insert(m_order.end(), vertices.begin(), vertices.end());
+                return;
+            }
+            const int label = ++m_labels;
+            for (int v : vertices)
+                m_label[v] = label;
+
+            // deepest level structure found: the narrowest levels, hence the smallest separators
+            std::vector<int> visited{};
+            std::vector<size_t> level_start{};
+            search(vertices.front(), label, visited, level_start);
+            for (size_t n = 0; n < PERIPHERAL_SEARCHES; n++)
+            {
+                const auto last = std::span(visited).subspan(level_start[level_start.size()-2]);
+                const int root  = *std::min_element(last.begin(), last.end(), [&](int a, int b){ return get_degree(a) < get_degree(b); });
+                std::vector<int> candidate{};
+                std::vector<size_t> candidate_start{};
+                clear_levels(visited);
+                search(root, label, candidate, candidate_start);
+                const bool deeper = candidate_start.size() > level_start.size();
+                visited.swap(candidate);
+                level_start.swap(candidate_start);
+                if (!deeper)
+                    break;
+            }
+
+            // another connected component: each one on its own
+            if (visited.size() < vertices.size())
+            {
+                std::vector<int> rest{};
+                for (int v : vertices)
+                {
+                    if (m_level[v] < 0)
+                        rest.push_back(v);
+                }
+                clear_levels(visited);
+                dissect(std::move(visited));
+                dissect(std::move(rest));
+                return;
+            }
+
+            // the level reaching half of the vertices, less its cells without a neighbour in the next one
+            const size_t levels = level_start.size() - 1;
+            if (levels < 3)
+            {
+                clear_levels(visited);
+                m_order.insert(m_order.end(), vertices.begin(), vertices.end());
+                return;
+            }
+            size_t middle = 1;
+            while (middle < levels-2 && level_start[middle+1] <= visited.size()/2)
+                middle++;
+
+            std::vector<int> first(visited.begin(), visited.begin() + level_start[middle]);
+            std::vector<int> second(visited.begin() + level_start[middle+1], visited.end());
+            std::vector<int> separator{};
+            for (size_t k = level_start[middle]; k < level_start[middle+1]; k++)
+            {
+                const int v = visited[k];
+                bool cuts{};
+                for (int e = m_outer[v]; e < m_outer[v+1] && !cuts; e++)
+                {
+                    const int w = m_inner[e];
+                    cuts = m_label[w] == label && m_level[w] == m_level[v] + 1;
+                }
+                (cuts? separator : first).push_back(v);
+            }
+            clear_levels(visited);
+            dissect(std::move(first));
+            dissect(std::move(second));
+            m_order.insert(m_order.end(), separator.begin(), separator.end());
+        }
+    };
+}
+
+auto get_nested_dissection(std::span<const int> outer, std::span<const int> inner) -> std::vector<int>
+{
+    if (outer.size() < 2)
+        return {};
+    return NestedDissection{outer, inner}.run();
+}
@@ -0,0 +1,224 @@
+#include "frame_exporter.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <print>
+#include <stdexcept>
+#include <utility>
+#include "profiler.hpp"
+
+constexpr uint16_t BARRIER_LEVEL = 256;
+
+static auto get_palette(COLORMAP colormap, const FramebufferStyle& style) -> std::array<Rgba, 257>
+{
+    std::array<Rgba, 257> palette{};
+    for (size_t level = 0; level < 256; level++)
+    {
+        const float t = level/255.f;
+        auto blend = [t](uint8_t from, uint8_t to){ return static_cast<uint8_t>(std::lround(from + t*(to - from))); };
+        auto ramp  = [t](float begin){ return static_cast<uint8_t>(std::lround(255.f*std::clamp(3.f*(t - begin), 0.f, 1.f))); };
+        switch (colormap)
+        {
+        case COLORMAP::VIEWER:
+            palette[level] = {blend(style.background.r, style.wave.r), blend(style.background.g, style.wave.g), blend(style.background.b, style.wave.b), 255};
+            break;
+        case COLORMAP::GRAYSCALE:
+            palette[level] = {static_cast<uint8_t>(level), static_cast<uint8_t>(level), static_cast<uint8_t>(level), 255};
+            break;
+        case COLORMAP::HEAT:
+            palette[level] = {ramp(0.f), ramp(1.f/3.f), ramp(2.f/3.f), 255};
+            break;
+        }
+    }
+    palette[BARRIER_LEVEL] = style.barrier;
+    return palette;
+}
+
+FrameExporter::FrameExporter(const ExportOptions& options, size_t Nx, size_t Ny, const ObstacleMask& barrier, const FramebufferStyle& style)
+    : m_options{options}, m_format{options.get_format()}, m_Nx{Nx}, m_Ny{Ny},
+      m_barrier(barrier.get_pixel_spans().begin(), barrier.get_pixel_spans().end()), m_level(Nx*Ny, 0)
+{
+    if (m_options.width  == 0) m_options.width  = Nx;
+    if (m_options.height == 0) m_options.height = Ny;
+    if (m_format == EXPORT_FORMAT::Y4M)
+    {
+        m_options.width  += m_options.width  % 2;     // 4:2:0 chroma of 2x2 pixel blocks
+        m_options.height += m_options.height % 2;
+        m_file.open(m_options.path, std::ios::binary | std::ios::trunc);
+        if (!m_file)
+        {
+            throw std::runtime_error("cannot open export file '" + m_options.path + "' for writing");
+        }
+        // the pixels are full range BT.601: without the range tag readers take them for limited range (16-235)
+        m_file << std::format("YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", m_options.width, m_options.height, std::max<size_t>(m_options.fps, 1));
+    }
+    const size_t width  = m_options.width;
+    const size_t height = m_options.height;
+
+    // nearest grid point of every pixel center
+    m_source.resize(width*height);
+    for (size_t y = 0; y < height; y++)
+    {
+        const size_t iy = std::min((2*y + 1)*Ny/(2*height), Ny-1);
+        for (size_t x = 0; x < width; x++)
+        {
+            const size_t jx = std::min((2*x + 1)*Nx/(2*width), Nx-1);
+            m_source[y*width + x] = static_cast<uint32_t>(iy*Nx + jx);
+        }
+    }
+    m_palette = get_palette(m_options.colormap, style);
+    for (size_t level = 0; level < m_palette.size(); level++)
+    {
+        const float r = m_palette[level].r, g = m_palette[level].g, b = m_palette[level].b;
+        m_yuv[level] = {static_cast<uint8_t>(std::lround(std::clamp(0.299f*r + 0.587f*g + 0.114f*b, 0.f, 255.f))),
+                        static_cast<uint8_t>(std::lround(std::clamp(128.f - 0.168736f*r - 0.331264f*g + 0.5f*b, 0.f, 255.f))),
+                        static_cast<uint8_t>(std::lround(std::clamp(128.f + 0.5f*r - 0.418688f*g - 0.081312f*b, 0.f, 255.f)))};
+    }
+    // the frame header is the same every frame: written once, encode() only fills the pixels after it
+    const std::string header = (m_format == EXPORT_FORMAT::Y4M)? std::string{"FRAME\n"} : std::format("P6\n{} {}\n255\n", width, height);
+    const size_t pixel_bytes = (m_format == EXPORT_FORMAT::Y4M)? width*height + 2*(width/2)*(height/2) : 3*width*height;
+    m_pixel_offset = header.size();
+    m_buffer.resize(header.size() + pixel_bytes);
+    std::memcpy(m_buffer.data(), header.data(), header.size());
+
+    m_queue.start(m_options.queue_depth, Frame{.psi = Eigen::VectorXcf((Nx-2)*(Ny-2))}, [this](Frame& frame){ export_frame(frame); });
+}
+FrameExporter::~FrameExporter()
+{
+    try
+    {
+        close();
+    }
+    catch(const std::exception& e)
+    {
+        std::println("Frame export failure: {}", e.what());
+    }
+}
+template<typename Scalar>
+bool FrameExporter::push(const Eigen::Ref<const VectorX<Scalar>>& psi, uint64_t step)
+{
+    Frame* frame = m_queue.acquire(m_options.policy == EXPORT_POLICY::BLOCK);
+    if (!frame)
+    {
+        m_dropped++;
+        PROFILE_COUNT(COUNTER::FRAMES_DROPPED, 1);
+        return false;
+    }
+    frame->step = step;
+    frame->psi  = psi.template cast<std::complex<float>>();
+    m_queue.submit(frame);
+    return true;
+}
+template bool FrameExporter::push(const Eigen::Ref<const VectorX<std::complex<float>>>&, uint64_t);
+template bool FrameExporter::push(const Eigen::Ref<const VectorX<std::complex<double>>>&, uint64_t);
+void FrameExporter::close()
+{
+    m_queue.close();
+    if (m_file.is_open())
+    {
+        m_file.flush();
+        if (!m_file && m_error.empty())
+        {
+            m_error = "cannot write to export file '" + m_options.path + "'";
+        }
+        m_file.close();     // reported once: a second close() finds nothing left to flush
+    }
+    if (!m_error.empty())
+    {
+        throw std::runtime_error(std::exchange(m_error, {}));
+    }
+}
+// Writer thread: after a failed write the frames are still taken off the queue, and dropped
+void FrameExporter::export_frame(const Frame& frame)
+{
+    if (!m_error.empty())
+        return;
+    PROFILE_SCOPE(PHASE::EXPORT);
+    encode(frame);
+    write(frame.step);
+}
+// Serial: the writer thread runs beside the solver, whose OpenMP team already has the cores.
+void FrameExporter::encode(const Frame& frame)
+{
+    const size_t Nx = m_Nx;
+    const size_t rows = m_Ny-2;
+    const float* raw  = reinterpret_cast<const float*>(frame.psi.data());
+
+    // |psi|/max as a colormap level per grid point, then the barrier over it
+    const float max_n2 = frame.psi.cwiseAbs2().maxCoeff();
+    const float scale  = (max_n2 > 0.f)? 255.f/std::sqrt(max_n2) : 0.f;
+    for (size_t jx = 1; jx < Nx-1; jx++)
+    {
+        const float* column = raw + 2*(jx-1)*rows;
+        for (size_t iy = 0; iy < rows; iy++)
+        {
+            const float n2 = column[2*iy]*column[2*iy] + column[2*iy+1]*column[2*iy+1];
+            m_level[(iy+1)*Nx + jx] = static_cast<uint16_t>(std::min(scale*std::sqrt(n2) + 0.5f, 255.f));
+        }
+    }
+    for (const auto& span : m_barrier)
+    {
+        std::fill_n(m_level.begin() + span.begin, span.length, BARRIER_LEVEL);
+    }
+
+    const size_t width  = m_options.width;
+    const size_t height = m_options.height;
+    if (m_format == EXPORT_FORMAT::PPM)
+    {
+        uint8_t* rgb = reinterpret_cast<uint8_t*>(m_buffer.data() + m_pixel_offset);
+        for (size_t p = 0; p < width*height; p++)
+        {
+            const Rgba color = m_palette[m_level[m_source[p]]];
+            rgb[3*p]   = color.r;
+            rgb[3*p+1] = color.g;
+            rgb[3*p+2] = color.b;
+        }
+        return;
+    }
+
+    // Y4M: the Y plane, then Cb and Cr averaged over 2x2 pixel blocks
+    uint8_t* luma = reinterpret_cast<uint8_t*>(m_buffer.data() + m_pixel_offset);
+    uint8_t* cb   = luma + width*height;
+    uint8_t* cr   = cb + (width/2)*(height/2);
+    for (size_t y = 0; y < height; y += 2)
+    {
+        for (size_t x = 0; x < width; x += 2)
+        {
+            const auto& a = m_yuv[m_level[m_source[y*width + x]]];
+            const auto& b = m_yuv[m_level[m_source[y*width + x+1]]];
+            const auto& c = m_yuv[m_level[m_source[(y+1)*width + x]]];
+            const auto& d = m_yuv[m_level[m_source[(y+1)*width + x+1]]];
+            luma[y*width + x]       = a[0];
+            luma[y*width + x+1]     = b[0];
+            luma[(y+1)*width + x]   = c[0];
+            luma[(y+1)*width + x+1] = d[0];
+            const size_t k = (y/2)*(width/2) + x/2;
+            cb[k] = static_cast<uint8_t>((a[1] + b[1] + c[1] + d[1] + 2)/4);
+            cr[k] = static_cast<uint8_t>((a[2] + b[2] + c[2] + d[2] + 2)/4);
+        }
+    }
+}
+void FrameExporter::write(uint64_t step)
+{
+    if (m_format == EXPORT_FORMAT::Y4M)
+    {
+        m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+        if (!m_file)
+        {
+            m_error = "cannot write to export file '" + m_options.path + "'";
+            return;
+        }
+        m_frames_written++;
+        return;
+    }
+    const std::string path = std::format("{}{:06}.ppm", m_options.path, step);
+    std::ofstream image{path, std::ios::binary | std::ios::trunc};
+    image.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+    if (!image)
+    {
+        m_error = "cannot write export frame '" + path + "'";
+        return;
+    }
+    m_frames_written++;
+}
@@ -0,0 +1,58 @@
+#include "framebuffer.hpp"
+#include <algorithm>
+#include <bit>
+
+static_assert(std::endian::native == std::endian::little, "pixels are packed as 0xAABBGGRR words");
+
+constexpr size_t ROW_BLOCK = 64;
+
+void build_framebuffer(std::span<const float> modulus, float vmax, std::span<const MaskSpan> barrier,
+                       size_t Nx, size_t Ny, const FramebufferStyle& style, std::span<Rgba> pixels)
+{
+    const size_t rows = Ny-2;
+    const float scale = (vmax > 0.f)? 1.f/vmax : 0.f;
+    const float bg[3]    = {float(style.background.r), float(style.background.g), float(style.background.b)};
+    const float delta[3] = {float(style.wave.r) - bg[0], float(style.wave.g) - bg[1], float(style.wave.b) - bg[2]};
+    const uint32_t alpha = static_cast<uint32_t>(style.wave.a) << 24;
+
+    // Dirichlet walls
+    std::fill(pixels.begin(), pixels.begin() + Nx, style.background);
+    std::fill(pixels.end() - Nx, pixels.end(), style.background);
+    for (size_t iy = 1; iy < Ny-1; iy++)
+    {
+        pixels[iy*Nx]        = style.background;
+        pixels[iy*Nx + Nx-1] = style.background;
+    }
+
+    // Column by column, |psi| is read contiguously and the pixels written with a stride of Nx.
+    // The colors of a block of rows are computed first, in a branch free loop the compiler vectorizes,
+    // then scattered.
+    #pragma omp parallel for schedule(static)
+    for (size_t jx = 1; jx < Nx-1; jx++)
+    {
+        const float* column = modulus.data() + (jx-1)*rows;
+        uint32_t packed[ROW_BLOCK];
+        for (size_t i0 = 0; i0 < rows; i0 += ROW_BLOCK)
+        {
+            const size_t len = std::min(ROW_BLOCK, rows - i0);
+            for (size_t i = 0; i < len; i++)
+            {
+                const float t = std::min(column[i0+i]*scale, 1.f);
+                packed[i] = static_cast<uint32_t>(bg[0] + t*delta[0])
+                          | static_cast<uint32_t>(bg[1] + t*delta[1]) << 8
+                          | static_cast<uint32_t>(bg[2] + t*delta[2]) << 16
+                          | alpha;
+            }
+            for (size_t i = 0; i < len; i++)
+            {
+                pixels[(i0+i+1)*Nx + jx] = std::bit_cast<Rgba>(packed[i]);
+            }
+        }
+    }
+
+    // Barrier overlay, run by run
+    for (const auto& span : barrier)
+    {
+        std::fill_n(pixels.begin() + span.begin, span.length, style.barrier);
+    }
+}
@@ -1,36 +1,47 @@
 #include "gaussian_wavefunction_builder.hpp"
 
-constexpr std::complex<float> imaginary_unit{0, 1}; 
-
-void GaussianWfBuilder::set_initial_pos(float x0, float y0)
+template<typename Scalar>
+void GaussianWfBuilder<Scalar>::set_initial_pos(float x0, float y0)
 {
     m_x0 = x0;
     m_y0 = y0;
 }
-void GaussianWfBuilder::set_system_size(float Lx, float Ly)
+template<typename Scalar>
+void GaussianWfBuilder<Scalar>::set_system_size(float Lx, float Ly)
 {
     m_Lx = Lx;
     m_Ly = Ly;
 }
-void GaussianWfBuilder::set_deviation(float sigma)
+template<typename Scalar>
+void GaussianWfBuilder<Scalar>::set_deviation(float sigma)
 {
     m_sigma = sigma; 
 }
-auto GaussianWfBuilder::build_wavefunction(size_t N_y, size_t N_x) const -> Eigen::Reshaped<Eigen::MatrixXcf, -1, 1>
+template<typename Scalar>
+void GaussianWfBuilder<Scalar>::set_wave_number(float k)
+{
+    m_k = k;
+}
+template<typename Scalar>
+auto GaussianWfBuilder<Scalar>::build_wavefunction(size_t N_y, size_t N_x) const -> VectorX<Scalar>
 {
-    Eigen::MatrixXcf psi_temp = Eigen::MatrixXcf::Zero(N_y-2, N_x-2); 
+    MatrixX<Scalar> psi_temp = MatrixX<Scalar>::Zero(N_y-2, N_x-2); 
     init_wavefunction(psi_temp);
     zero_out_boundary(psi_temp);
-    return psi_temp.reshaped<Eigen::ColMajor>();
+    return psi_temp.template reshaped<Eigen::ColMajor>(); // copied out: a Reshaped view would dangle once psi_temp goes out of scope
 }   
-void GaussianWfBuilder::init_wavefunction(Eigen::MatrixXcf& Psi) const
+template<typename Scalar>
+void GaussianWfBuilder<Scalar>::init_wavefunction(MatrixX<Scalar>& Psi) const
 {
-    Eigen::VectorXf x = Eigen::VectorXf::LinSpaced(Psi.cols(), 0, m_Lx);
-    Eigen::VectorXf y = Eigen::VectorXf::LinSpaced(Psi.rows(), 0, m_Ly);
-    float delta_x{};
-    float delta_y{};
-    float gauss_arg{};
-    std::complex<float> plane_wave{};
+    // evaluated in the precision of psi, so that a double run does not start from a rounded float Gaussian
+    using RealVector = Eigen::Matrix<Real<Scalar>, Eigen::Dynamic, 1>;
+    const Scalar imaginary_unit{0, 1};
+    RealVector x = RealVector::LinSpaced(Psi.cols(), 0, m_Lx);
+    RealVector y = RealVector::LinSpaced(Psi.rows(), 0, m_Ly);
+    Real<Scalar> delta_x{};
+    Real<Scalar> delta_y{};
+    Real<Scalar> gauss_arg{};
+    Scalar plane_wave{};
 
     for (int iy = 0; iy < Psi.rows(); iy++)
     {
@@ -40,15 +51,19 @@ void GaussianWfBuilder::init_wavefunction(Eigen::MatrixXcf& Psi) const
             delta_y   = (y(iy) - m_y0);
             gauss_arg = ( pow(delta_x, 2) + pow(delta_y, 2)) / pow(m_sigma, 2);
 
-            plane_wave  =  std::exp(imaginary_unit*m_k*delta_x);
-            Psi(iy,jx) =  std::exp(-0.5f*gauss_arg)*plane_wave; //plane_wave; // std::exp(-0.5*gauss_arg) *
+            plane_wave  =  std::exp(imaginary_unit*Real<Scalar>(m_k)*delta_x);
+            Psi(iy,jx) =  std::exp(Real<Scalar>(-0.5)*gauss_arg)*plane_wave; //plane_wave; // std::exp(-0.5*gauss_arg) *
         }
     }
 }
-void GaussianWfBuilder::zero_out_boundary(Eigen::MatrixXcf& Psi) const
+template<typename Scalar>
+void GaussianWfBuilder<Scalar>::zero_out_boundary(MatrixX<Scalar>& Psi) const
 {
     Psi.row(0           ).array() = 0;
     Psi.row(Psi.rows()-1).array() = 0;
     Psi.col(0           ).array() = 0;
     Psi.col(Psi.cols()-1).array() = 0;
 }
+
+template class GaussianWfBuilder<std::complex<float>>;
+template class GaussianWfBuilder<std::complex<double>>;
@@ -0,0 +1,296 @@
+#include <iostream>
+#include <print>
+#include <chrono>
+#include <csignal>
+#include <optional>
+#include "crank_nicolson_builder.hpp"
+#include "gaussian_wavefunction_builder.hpp"
+#include "schrodinger_equation_builder.hpp"
+#include "schrodinger_equation.hpp"
+#include "simulation_config.hpp"
+
+// Batch runner: same equation as the viewer, stepped as fast as the hardware allows, without raylib or a window.
+// Usage: double_slit_headless [--config file] [--key value]...   (see simulation_config.hpp for the keys)
+// With wave_numbers set, one packet per wave number is stepped as a batch sharing the factorization; packet 0 is recorded.
+// With a checkpoint path set, SIGUSR1 writes a checkpoint on demand, SIGINT and SIGTERM a last one before stopping.
+// A resumed run carries on up to the same total number of steps; the detectors integrate from the resumed step.
+
+// Set by the signal handlers, looked at between two steps
+volatile std::sig_atomic_t checkpoint_requested{0};
+volatile std::sig_atomic_t stop_requested{0};
+
+template<typename Scalar>
+int run(const SimulationConfig& config, const Checkpoint* resume)
+{
+    start_profiling(config);
+    SchodingerEquationBuilder<Scalar> eq_builder {config.L, config.dr, config.initial_pos(), std::make_unique<CrankNicolsonBuilder<Scalar>>(), std::make_unique<GaussianWfBuilder<Scalar>>()};
+    eq_builder.set_engine(config.engine);
+    try
+    {
+        if (config.dt != 0.f)
+            eq_builder.set_time_step(config.dt);    // dx^2/4 unless set
+    }
+    catch(const std::exception& e)
+    {
+        std::println("Invalid time step: {}", e.what());
+        return EXIT_FAILURE;
+    }
+    eq_builder.set_absorbing_layer(config.absorbing_layer);
+    eq_builder.set_activity(config.activity);
+    eq_builder.set_solver_options(config.solver_options);
+    eq_builder.set_operator_cache(config.operator_cache);
+    eq_builder.set_wave_number(config.wave_number);
+
+    Interferometer double_slit{eq_builder.get_Nx(), eq_builder.get_Ny()};
+    try
+    {
+        double_slit = build_interferometer(config, eq_builder.get_Nx(), eq_builder.get_Ny());
+    }
+    catch(const std::exception& e)
+    {
+        std::println("Invalid slit geometry: {}", e.what());
+        return EXIT_FAILURE;
+    }
+    if (config.eliminate_obstacle)
+    {
+        eq_builder.set_obstacle(double_slit.get_mask());
+    }
+    std::vector<WavePacket> packets{};
+    for (float k : config.wave_numbers)
+    {
+        packets.push_back({.position = config.initial_pos(), .wave_number = k});
+    }
+    std::optional<SchodingerEquation<Scalar>> built{};
+    try
+    {
+        built.emplace(packets.empty()? eq_builder.build_equation() : eq_builder.build_batch(packets));
+    }
+    catch(const std::exception& e)
+    {
+        std::println("Simulation setup failure: {}", e.what());
+        return EXIT_FAILURE;
+    }
+    SchodingerEquation<Scalar>& schrodinger = *built;
+    const size_t packet_count = schrodinger.get_packet_count();
+    std::println("Grid: {}x{}, {} steps, {} packet(s).", schrodinger.Nx, schrodinger.Ny, config.steps, packet_count);
+
+    CheckpointClock clock{};
+    if (resume)
+    {
+        try
+        {
+            resume->check_geometry(schrodinger.Nx, schrodinger.Ny, packet_count, double_slit.get_mask());
+            schrodinger.restore(resume->get_psi<Scalar>(), resume->get_stepper_state());
+            clock = resume->get_clock();
+        }
+        catch(const std::exception& e)
+        {
+            std::println("Checkpoint restore failure: {}", e.what());
+            return EXIT_FAILURE;
+        }
+        std::println("Resumed from {} at step {}, t = {:.6f}.", config.resume_path, clock.step, clock.time);
+    }
+    std::unique_ptr<CheckpointWriter> checkpoints{};
+    if (!config.checkpoint_path.empty())
+    {
+        checkpoints = std::make_unique<CheckpointWriter>(config.checkpoint_path, make_checkpoint_header(config, double_slit, packet_count), double_slit.get_mask(),
+                                                         config.wave_numbers, std::chrono::duration<float>(config.checkpoint_interval));
+        std::signal(SIGINT,  [](int){ stop_requested = 1; });
+        std::signal(SIGTERM, [](int){ stop_requested = 1; });
+#ifdef SIGUSR1
+        std::signal(SIGUSR1, [](int){ checkpoint_requested = 1; });
+#endif
+    }
+
+    std::unique_ptr<SnapshotWriter> recorder{};
+    if (!config.record_path.empty())
+    {
+        try
+        {
+            recorder = std::make_unique<SnapshotWriter>(config.record_path, make_snapshot_header(config, double_slit, eq_builder.get_time_step()), double_slit.get_mask());
+        }
+        catch(const std::exception& e)
+        {
+            std::println("Snapshot recording failure: {}", e.what());
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::unique_ptr<FrameExporter> exporter{};
+    if (config.export_options.is_enabled())
+    {
+        try
+        {
+            exporter = std::make_unique<FrameExporter>(config.export_options, schrodinger.Nx, schrodinger.Ny, double_slit.get_mask());
+        }
+        catch(const std::exception& e)
+        {
+            std::println("Frame export failure: {}", e.what());
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::unique_ptr<DetectorScreen> detectors{};
+    try
+    {
+        detectors = build_detector_screen(config, schrodinger.Nx, schrodinger.Ny, eq_builder.get_time_step());
+    }
+    catch(const std::exception& e)
+    {
+        std::println("Invalid detector: {}", e.what());
+        return EXIT_FAILURE;
+    }
+    auto write_detectors = [&]
+    {
+        try
+        {
+            detectors->write(config.detector_output);
+        }
+        catch(const std::exception& e)
+        {
+            std::println("Detector output failure: {}", e.what());
+        }
+    };
+
+    const size_t first_step = clock.step;
+    const double dt = eq_builder.get_time_step();
+    size_t iterations{};
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = first_step; n < config.steps && !stop_requested; n++)
+    {
+        schrodinger.interact(double_slit);
+        schrodinger.evolve();
+        iterations += schrodinger.get_solver_iterations();
+        if (recorder && (n+1) % config.record_every == 0)
+        {
+            recorder->push<Scalar>(schrodinger.get_packet(0), n+1);
+        }
+        if (exporter && (n+1) % config.export_options.every == 0)
+        {
+            exporter->push<Scalar>(schrodinger.get_packet(0), n+1);
+        }
+        if (detectors)
+        {
+            detectors->accumulate(schrodinger.get_wavefunction());
+            if (config.detector_every > 0 && (n+1) % config.detector_every == 0)
+                write_detectors();
+        }
+        clock = {n+1, clock.time + dt};
+        if (checkpoints && (checkpoint_requested || checkpoints->is_due()))
+        {
+            checkpoint_requested = 0;
+            checkpoints->save<Scalar>(schrodinger.get_wavefunction(), schrodinger.get_stepper_state(), clock);
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const size_t steps = clock.step - first_step;
+
+    if (stop_requested)
+    {
+        std::println("Stopped at step {}.", clock.step);
+    }
+    std::println("Elapsed: {:.3f}s, {:.1f} steps/s, {:.1f} packet-steps/s.", elapsed.count(), steps/elapsed.count(), packet_count*steps/elapsed.count());
+    if (iterations > 0)
+    {
+        std::println("Solver iterations per step: {:.1f}.", static_cast<double>(iterations)/steps);
+    }
+    for (size_t packet = 0; packet < packet_count; packet++)
+    {
+        const Observables& observables = schrodinger.observe(packet);
+        if (packet_count > 1)
+        {
+            std::print("Packet {} (k = {:.2f}): ", packet, config.wave_numbers[packet]);
+        }
+        std::println("Max amplitude: {:.6f}, norm: {:.6e}, norm drift: {:.3e}.", observables.max_modulus, observables.norm, observables.norm_drift);
+    }
+    if (config.activity.is_enabled())
+    {
+        const auto window = schrodinger.get_active_window(0);
+        if (window)
+            std::println("Active window of packet 0: {}x{} of {}x{} cells, discarded probability {:.3e}.", window->width, window->height, schrodinger.Nx-2, schrodinger.Ny-2, schrodinger.get_discarded_probability());
+    }
+    if (detectors)
+    {
+        write_detectors();
+        std::println("Detectors: {} cells integrated over {} steps, written to {}.", detectors->get_cell_count(), detectors->get_steps(), config.detector_output);
+    }
+    write_profile(config);
+    if (recorder)
+    {
+        try
+        {
+            recorder->close();
+            std::println("Recorded {} frames to {} (solver stalled {} times on the writer).", recorder->get_frames_written(), config.record_path, recorder->get_stalls());
+        }
+        catch(const std::exception& e)
+        {
+            std::println("Snapshot recording failure: {}", e.what());
+            return EXIT_FAILURE;
+        }
+    }
+    if (checkpoints)
+    {
+        try
+        {
+            checkpoints->save<Scalar>(schrodinger.get_wavefunction(), schrodinger.get_stepper_state(), clock);
+            checkpoints->close();
+            std::println("Checkpoint at step {} in {} ({} written, solver stalled {} times on the writer).", clock.step, config.checkpoint_path,
+                         checkpoints->get_written(), checkpoints->get_stalls());
+        }
+        catch(const std::exception& e)
+        {
+            std::println("Checkpoint failure: {}", e.what());
+            return EXIT_FAILURE;
+        }
+    }
+    if (exporter)
+    {
+        try
+        {
+            exporter->close();
+            std::println("Exported {} {}x{} frames to {} ({} dropped, solver stalled {} times on the writer).", exporter->get_frames_written(),
+                         exporter->get_width(), exporter->get_height(), config.export_options.path, exporter->get_dropped(), exporter->get_stalls());
+        }
+        catch(const std::exception& e)
+        {
+            std::println("Frame export failure: {}", e.what());
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[])
+{
+    SimulationConfig config{};
+    try
+    {
+        config = parse_arguments(argc, argv);
+    }
+    catch(const std::exception& e)
+    {
+        std::println("Invalid parameters: {}", e.what());
+        return EXIT_FAILURE;
+    }
+
+    std::optional<Checkpoint> resume{};
+    if (!config.resume_path.empty())
+    {
+        try
+        {
+            resume.emplace(config.resume_path);
+            apply_checkpoint(config, *resume);  // the precision included
+        }
+        catch(const std::exception& e)
+        {
+            std::println("Checkpoint restore failure: {}", e.what());
+            return EXIT_FAILURE;
+        }
+    }
+
+    flush_denormals();
+    const Checkpoint* checkpoint = resume? &*resume : nullptr;
+    if (config.precision == PRECISION::DOUBLE)
+        return run<std::complex<double>>(config, checkpoint);
+    return run<std::complex<float>>(config, checkpoint);
+}
@@ -14,43 +14,39 @@ void Interferometer::set_param(size_t thickness_, size_t width_, size_t height_)
     size_t slit_x {m_mid_point.x - m_thickness/2};
     size_t slit_y {m_mid_point.y - m_width/2};
     m_slit_pt =   {slit_x,slit_y};
+    m_mask    =   ObstacleMask{m_Nx, m_Ny, rasterize()};
 }
-void Interferometer::activate_interaction(Eigen::VectorXcf& psi) const
+void Interferometer::set_mask(ObstacleMask mask)
 {
-    for (size_t dx = 1; dx < (m_thickness+1); dx++)
-    {
-        for (size_t dy = 1; dy < (m_height+1); dy++)
-        {        
-            zero_out(psi, m_top    + (dy-1), m_mid_point.x - m_thickness/2  + (dx-1), m_Ny);     // from "top    of screen" to top    slit opening
-            zero_out(psi, m_bottom - (dy-1), m_mid_point.x - m_thickness/2  + (dx-1), m_Ny);     // from "bottom of screen" to bottom slit opening
-        }    
-        for (size_t dy = 1; dy < (m_width+1); dy++)
-        {
-            zero_out(psi, m_mid_point.y - (m_width/2) + (dy-1), m_mid_point.x - m_thickness/2  + (dx-1), m_Ny);
-        }
-    }
+    m_thickness = m_width = m_height = 0;
+    m_mask = std::move(mask);
 }
-void Interferometer::draw(const RenderTexture2D& tile, Point start, size_t y, size_t x) const
+template<typename Scalar>
+void Interferometer::activate_interaction(VectorX<Scalar>& psi) const
 {
-    int dy = tile.texture.height;
-    int dx = tile.texture.width;
- 
-    // Draw the part inside between the two slits
-    if( (y < m_width ) && (x < m_thickness) )
-    {
-        DrawTexture(tile.texture, start.x + (m_slit_pt.x + x)*dx, start.y + (m_slit_pt.y + y)*dy, RAYWHITE);
-    }
-
-    // Draw the upper & lower parts
-    if( (y < m_height ) && (x < m_thickness))
-    {                    
-        DrawTexture(tile.texture, start.x + (m_slit_pt.x + x)*dx, start.y +  (m_top    + y)*dy, RAYWHITE);
-        DrawTexture(tile.texture, start.x + (m_slit_pt.x + x)*dx, start.y +  (m_bottom - y)*dy, RAYWHITE);
-    }
+    m_mask.apply(psi);
 }
-void Interferometer::zero_out(Eigen::VectorXcf& vec, size_t iy, size_t jx, size_t Ny)
+template void Interferometer::activate_interaction(VectorX<std::complex<float>>&) const;
+template void Interferometer::activate_interaction(VectorX<std::complex<double>>&) const;
+auto Interferometer::rasterize() const -> std::vector<uint8_t>
 {
-    size_t k = (jx-1)*(Ny-2) + (iy-1);
-    vec(k) = 0;
+    std::vector<uint8_t> mask(m_Nx*m_Ny, 0);
+    auto set = [&](size_t iy, size_t jx)
+    {
+        if (iy < m_Ny && jx < m_Nx)
+            mask[iy*m_Nx + jx] = 1;
+    };
+    for (size_t x = 0; x < m_thickness; x++)
+    {
+        for (size_t y = 0; y < m_width; y++)    // the part inside between the two slits
+        {
+            set(m_slit_pt.y + y, m_slit_pt.x + x);
+        }
+        for (size_t y = 0; y < m_height; y++)   // the upper & lower parts
+        {
+            set(m_top    + y, m_slit_pt.x + x);
+            set(m_bottom - y, m_slit_pt.x + x);
+        }
+    }
+    return mask;
 }
-
@@ -0,0 +1,278 @@
+#include "linear_solvers.hpp"
+#include <stdexcept>
+
+constexpr size_t COCG_RESTART = 20;
+
+template<typename Scalar>
+auto make_linear_solver(const SolverOptions& options) -> std::unique_ptr<ILinearSolver<Scalar>>
+{
+    switch (options.solver)
+    {
+    case SOLVER::BICGSTAB:
+        if (options.preconditioner == PRECONDITIONER::ILUT)
+            return std::make_unique<BiCGSTABSolver<Scalar, Eigen::IncompleteLUT<Scalar>>>(options.tolerance, options.max_iterations);
+        return std::make_unique<BiCGSTABSolver<Scalar, Eigen::DiagonalPreconditioner<Scalar>>>(options.tolerance, options.max_iterations);
+    case SOLVER::COCG:
+        if (options.preconditioner == PRECONDITIONER::ILUT)
+            throw std::invalid_argument("the COCG solver is Jacobi preconditioned only, ILUT needs bicgstab");
+        return std::make_unique<COCGSolver<Scalar>>(options.tolerance, options.max_iterations);
+    case SOLVER::SPARSE_LU:
+    default:
+        switch (options.ordering)
+        {
+        case ORDERING::AMD:               return std::make_unique<SparseLUSolver<Scalar, Eigen::AMDOrdering<int>>>();
+        case ORDERING::NATURAL:           return std::make_unique<SparseLUSolver<Scalar, BandOrdering<int>>>();
+        case ORDERING::NESTED_DISSECTION: return std::make_unique<SparseLUSolver<Scalar, NestedDissectionOrdering<int>>>();
+        case ORDERING::COLAMD:
+        default:                          return std::make_unique<SparseLUSolver<Scalar>>();
+        }
+    }
+}
+template auto make_linear_solver<std::complex<float>>(const SolverOptions&)  -> std::unique_ptr<ILinearSolver<std::complex<float>>>;
+template auto make_linear_solver<std::complex<double>>(const SolverOptions&) -> std::unique_ptr<ILinearSolver<std::complex<double>>>;
+
+
+template<typename Scalar, typename Ordering>
+void SparseLUSolver<Scalar, Ordering>::compute(const SparseMatrix<Scalar>& A)
+{
+    auto solver = std::make_shared<PersistentSparseLU<Scalar, Ordering>>();
+    solver->compute(A);
+    if (solver->info() != Eigen::Success)
+    {
+        throw std::runtime_error("SparseLU factorization failed: " + solver->lastErrorMessage());
+    }
+    m_solver = std::move(solver);
+}
+template<typename Scalar, typename Ordering>
+void SparseLUSolver<Scalar, Ordering>::refactorize(const SparseMatrix<Scalar>& A)
+{
+    if (!m_solver->has_analysis(A.cols()))
+    {
+        compute(A);
+        return;
+    }
+    auto solver = std::make_shared<PersistentSparseLU<Scalar, Ordering>>();
+    solver->adopt_analysis(*m_solver);
+    solver->factorize(A);
+    if (solver->info() != Eigen::Success)
+    {
+        throw std::runtime_error("SparseLU factorization failed: " + solver->lastErrorMessage());
+    }
+    m_solver = std::move(solver);
+}
+template<typename Scalar, typename Ordering>
+void SparseLUSolver<Scalar, Ordering>::solve(const VectorX<Scalar>& b, VectorX<Scalar>& x)
+{
+    x = m_solver->solve(b);
+}
+template<typename Scalar, typename Ordering>
+void SparseLUSolver<Scalar, Ordering>::solve_batch(const MatrixX<Scalar>& B, MatrixX<Scalar>& X)
+{
+    // The supernodal triangular solves take the whole block: dense panel products over all right hand sides,
+    // L and U streamed from memory once per step instead of once per packet.
+    X = m_solver->solve(B);
+}
+template<typename Scalar, typename Ordering>
+bool SparseLUSolver<Scalar, Ordering>::load(const SparseMatrix<Scalar>& A, const OperatorCacheEntry& entry)
+{
+    if (!entry.has(CACHE_SECTION::LU_PERM_R))
+        return false;
+    auto solver = std::make_shared<PersistentSparseLU<Scalar, Ordering>>();
+    solver->load(A, entry);
+    m_solver = std::move(solver);
+    return true;
+}
+template<typename Scalar, typename Ordering>
+auto SparseLUSolver<Scalar, Ordering>::share() const -> std::unique_ptr<ILinearSolver<Scalar>>
+{
+    auto shared = std::make_unique<SparseLUSolver<Scalar, Ordering>>();
+    shared->m_solver = m_solver;
+    return shared;
+}
+template class SparseLUSolver<std::complex<float>, Eigen::COLAMDOrdering<int>>;
+template class SparseLUSolver<std::complex<float>, Eigen::AMDOrdering<int>>;
+template class SparseLUSolver<std::complex<float>, BandOrdering<int>>;
+template class SparseLUSolver<std::complex<float>, NestedDissectionOrdering<int>>;
+template class SparseLUSolver<std::complex<double>, Eigen::COLAMDOrdering<int>>;
+template class SparseLUSolver<std::complex<double>, Eigen::AMDOrdering<int>>;
+template class SparseLUSolver<std::complex<double>, BandOrdering<int>>;
+template class SparseLUSolver<std::complex<double>, NestedDissectionOrdering<int>>;
+
+
+template<typename Scalar, typename Ordering>
+void PersistentSparseLU<Scalar, Ordering>::save(OperatorCacheWriter& writer) const
+{
+    // Only the used part of Eigen's over-allocated L and U buffers
+    const Eigen::Index n = this->cols();
+    auto all  = [](const auto& vector){ return std::span(vector.data(), static_cast<size_t>(vector.size())); };
+    auto head = [](const auto& vector, Eigen::Index count){ return std::span(vector.data(), static_cast<size_t>(count)); };
+    writer.add(CACHE_SECTION::LU_PERM_R, all(this->m_perm_r.indices()));
+    writer.add(CACHE_SECTION::LU_PERM_C, all(this->m_perm_c.indices()));
+    writer.add(CACHE_SECTION::LU_XSUP,   all(this->m_glu.xsup));
+    writer.add(CACHE_SECTION::LU_SUPNO,  all(this->m_glu.supno));
+    writer.add(CACHE_SECTION::LU_XLUSUP, all(this->m_glu.xlusup));
+    writer.add(CACHE_SECTION::LU_XLSUB,  all(this->m_glu.xlsub));
+    writer.add(CACHE_SECTION::LU_XUSUB,  all(this->m_glu.xusub));
+    writer.add(CACHE_SECTION::LU_LUSUP,  head(this->m_glu.lusup, this->m_glu.xlusup(n)));
+    writer.add(CACHE_SECTION::LU_LSUB,   head(this->m_glu.lsub,  this->m_glu.xlsub(n)));
+    writer.add(CACHE_SECTION::LU_UCOL,   head(this->m_glu.ucol,  this->m_glu.xusub(n)));
+    writer.add(CACHE_SECTION::LU_USUB,   head(this->m_glu.usub,  this->m_glu.xusub(n)));
+    writer.add(CACHE_SECTION::LU_NNZ_L,  std::span<const Eigen::Index>(&this->m_nnzL, 1));
+    writer.add(CACHE_SECTION::LU_NNZ_U,  std::span<const Eigen::Index>(&this->m_nnzU, 1));
+}
+template<typename Scalar, typename Ordering>
+void PersistentSparseLU<Scalar, Ordering>::load(const SparseMatrix<Scalar>& A, const OperatorCacheEntry& entry)
+{
+    // The end of factorize(), with the arrays read from the entry instead of computed
+    auto copy = [&](auto& vector, CACHE_SECTION id)
+    {
+        using Vector = std::remove_reference_t<decltype(vector)>;
+        auto values = entry.get<typename Vector::Scalar>(id);
+        vector = Eigen::Map<const Vector>(values.data(), static_cast<Eigen::Index>(values.size()));
+    };
+    copy(this->m_perm_r.indices(), CACHE_SECTION::LU_PERM_R);
+    copy(this->m_perm_c.indices(), CACHE_SECTION::LU_PERM_C);
+    copy(this->m_glu.xsup,   CACHE_SECTION::LU_XSUP);
+    copy(this->m_glu.supno,  CACHE_SECTION::LU_SUPNO);
+    copy(this->m_glu.xlusup, CACHE_SECTION::LU_XLUSUP);
+    copy(this->m_glu.xlsub,  CACHE_SECTION::LU_XLSUB);
+    copy(this->m_glu.xusub,  CACHE_SECTION::LU_XUSUB);
+    copy(this->m_glu.lusup,  CACHE_SECTION::LU_LUSUP);
+    copy(this->m_glu.lsub,   CACHE_SECTION::LU_LSUB);
+    copy(this->m_glu.ucol,   CACHE_SECTION::LU_UCOL);
+    copy(this->m_glu.usub,   CACHE_SECTION::LU_USUB);
+    auto nnz_L = entry.get<Eigen::Index>(CACHE_SECTION::LU_NNZ_L);
+    auto nnz_U = entry.get<Eigen::Index>(CACHE_SECTION::LU_NNZ_U);
+
+    const Eigen::Index n = A.cols();
+    if (A.rows() != n || this->m_perm_r.size() != n || this->m_perm_c.size() != n || this->m_glu.supno.size() != n+1
+        || this->m_glu.xlusup.size() != n+1 || this->m_glu.xlsub.size() != n+1 || this->m_glu.xusub.size() != n+1 || nnz_L.size() != 1 || nnz_U.size() != 1
+        || this->m_glu.lusup.size() != this->m_glu.xlusup(n) || this->m_glu.lsub.size() != this->m_glu.xlsub(n) || this->m_glu.ucol.size() != this->m_glu.xusub(n))
+    {
+        throw std::runtime_error("cached LU factors do not match the matrix");
+    }
+    this->m_nnzL = nnz_L[0];
+    this->m_nnzU = nnz_U[0];
+    this->m_glu.n = n;
+    this->m_mat.resize(n, n);     // only its dimensions are used past the factorization
+    this->m_detPermR = this->m_perm_r.determinant();
+    this->m_detPermC = this->m_perm_c.determinant();
+    this->m_Lstore.setInfos(n, n, this->m_glu.lusup, this->m_glu.xlusup, this->m_glu.lsub, this->m_glu.xlsub, this->m_glu.supno, this->m_glu.xsup);
+    new (&this->m_Ustore) decltype(this->m_Ustore)(n, n, this->m_nnzU, this->m_glu.xusub.data(), this->m_glu.usub.data(), this->m_glu.ucol.data());
+    this->m_info              = Eigen::Success;
+    this->m_analysisIsOk      = true;
+    this->m_factorizationIsOk = true;
+    this->m_isInitialized     = true;
+}
+template<typename Scalar, typename Ordering>
+void PersistentSparseLU<Scalar, Ordering>::adopt_analysis(const PersistentSparseLU& other)
+{
+    // what analyzePattern() leaves for factorize()
+    this->m_perm_c       = other.m_perm_c;
+    this->m_etree        = other.m_etree;
+    this->m_analysisIsOk = true;
+}
+template class PersistentSparseLU<std::complex<float>, Eigen::COLAMDOrdering<int>>;
+template class PersistentSparseLU<std::complex<float>, Eigen::AMDOrdering<int>>;
+template class PersistentSparseLU<std::complex<float>, BandOrdering<int>>;
+template class PersistentSparseLU<std::complex<float>, NestedDissectionOrdering<int>>;
+template class PersistentSparseLU<std::complex<double>, Eigen::COLAMDOrdering<int>>;
+template class PersistentSparseLU<std::complex<double>, Eigen::AMDOrdering<int>>;
+template class PersistentSparseLU<std::complex<double>, BandOrdering<int>>;
+template class PersistentSparseLU<std::complex<double>, NestedDissectionOrdering<int>>;
+
+
+template<typename Scalar, typename Preconditioner>
+BiCGSTABSolver<Scalar, Preconditioner>::BiCGSTABSolver(float tolerance, size_t max_iterations)
+{
+    m_solver.setTolerance(tolerance);
+    m_solver.setMaxIterations(static_cast<Eigen::Index>(max_iterations));
+}
+template<typename Scalar, typename Preconditioner>
+void BiCGSTABSolver<Scalar, Preconditioner>::compute(const SparseMatrix<Scalar>& A)
+{
+    m_A = A;
+    m_solver.compute(m_A);
+    if (m_solver.info() != Eigen::Success)
+    {
+        throw std::runtime_error("BiCGSTAB preconditioner setup failed");
+    }
+}
+template<typename Scalar, typename Preconditioner>
+void BiCGSTABSolver<Scalar, Preconditioner>::solve(const VectorX<Scalar>& b, VectorX<Scalar>& x)
+{
+    x = m_solver.solveWithGuess(b, x);
+}
+template class BiCGSTABSolver<std::complex<float>,  Eigen::DiagonalPreconditioner<std::complex<float>>>;
+template class BiCGSTABSolver<std::complex<float>,  Eigen::IncompleteLUT<std::complex<float>>>;
+template class BiCGSTABSolver<std::complex<double>, Eigen::DiagonalPreconditioner<std::complex<double>>>;
+template class BiCGSTABSolver<std::complex<double>, Eigen::IncompleteLUT<std::complex<double>>>;
+
+
+template<typename Scalar>
+COCGSolver<Scalar>::COCGSolver(float tolerance, size_t max_iterations)
+    : m_tolerance{tolerance}, m_max_iterations{max_iterations}
+{
+}
+template<typename Scalar>
+void COCGSolver<Scalar>::compute(const SparseMatrix<Scalar>& A)
+{
+    m_A        = A;
+    m_inv_diag = m_A.diagonal().cwiseInverse();
+}
+template<typename Scalar>
+void COCGSolver<Scalar>::solve(const VectorX<Scalar>& b, VectorX<Scalar>& x)
+{
+    // x^T y, without complex conjugation. Accumulated in double: near convergence the float sums cancel badly.
+    auto bilinear = [](const VectorX<Scalar>& u, const VectorX<Scalar>& v)
+    {
+        return Scalar(u.template cast<std::complex<double>>().cwiseProduct(v.template cast<std::complex<double>>()).sum());
+    };
+
+    const Real<Scalar> b_norm = b.norm();
+    m_iterations = 0;
+    m_error      = 0;
+    if (b_norm == Real<Scalar>(0))
+    {
+        x.setZero();
+        return;
+    }
+
+    // Restarted from the true residual b - A x every COCG_RESTART iterations (or after a breakdown):
+    // in single precision the recursively updated residual drifts, and COCG has no minimization property to correct it.
+    while (true)
+    {
+        m_r.noalias() = b - m_A*x;
+        m_error = m_r.norm()/b_norm;
+        if (m_error < m_tolerance || m_iterations >= m_max_iterations)
+            return;
+
+        m_z = m_inv_diag.cwiseProduct(m_r);
+        m_p = m_z;
+        Scalar rho = bilinear(m_r, m_z);
+
+        for (size_t k = 0; k < COCG_RESTART && m_iterations < m_max_iterations; k++)
+        {
+            m_iterations++;
+            m_q.noalias() = m_A*m_p;
+            Scalar pq = bilinear(m_p, m_q);
+            if (pq == Scalar(0) || rho == Scalar(0))    // breakdown of the bilinear form
+                break;
+
+            Scalar alpha = rho/pq;
+            x   += alpha*m_p;
+            m_r -= alpha*m_q;
+
+            m_error = m_r.norm()/b_norm;
+            if (m_error < m_tolerance)
+                return;
+
+            m_z = m_inv_diag.cwiseProduct(m_r);
+            Scalar rho_new = bilinear(m_r, m_z);
+            m_p  = m_z + (rho_new/rho)*m_p;
+            rho  = rho_new;
+        }
+    }
+}
+template class COCGSolver<std::complex<float>>;
+template class COCGSolver<std::complex<double>>;
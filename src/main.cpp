@@ -1,12 +1,17 @@
 #include <iostream>
 #include <cmath>
 #include <print>
+#include <optional>
 #include "raylib.h"
 #include "interferometer.hpp"
 #include "crank_nicolson_builder.hpp"
 #include "gaussian_wavefunction_builder.hpp"
 #include "schrodinger_equation_builder.hpp"
 #include "schrodinger_equation.hpp"
+#include "simulation_config.hpp"
+#include "renderer.hpp"
+#include "snapshot.hpp"
+#include "simulation_worker.hpp"
 
 constexpr uint32_t WINDOW_HEIGHT      = 600;
 constexpr uint32_t WINDOW_WIDTH       = 1024;
@@ -25,7 +30,16 @@ enum class SCENE
 SCENE current_scene = SCENE::TITLESCREEN;
 void show_title_screen(std::string_view title, std::string_view subtitle);
 
-int main()
+// Solver side of a live run, set up in the precision picked by the config. The worker starts paused.
+struct LiveSimulation
+{
+    std::unique_ptr<ISimulationWorker> worker{};
+    Interferometer double_slit;
+};
+template<typename Scalar>
+auto start_live_simulation(const SimulationConfig& config, const Checkpoint* resume) -> LiveSimulation;
+
+int main(int argc, char* argv[])
 {
     // ===============================================//
     //                                                //
@@ -33,20 +47,64 @@ int main()
     //                                                //
     // ===============================================//
 
-    constexpr Vector2 L   {.x = 6.f,     .y = 4.f};     // system size
-    constexpr Vector2 dr  {.x = 0.04f,   .y = 0.04f};   // step size
-    constexpr Vector2 r0  {.x = L.x/5.f, .y = L.y/2.f}; // initial position of the wf
+    SimulationConfig config{};  // defaults: 6x4 box, dr = 0.04, wf starting at (Lx/5, Ly/2), overridable with --key value
+    try
+    {
+        config = parse_arguments(argc, argv);
+    }
+    catch(const std::exception& e)
+    {
+        std::println("Invalid parameters: {}", e.what());
+        return EXIT_FAILURE;
+    }
 
-    auto gaussian_wf_builder   = std::make_unique<GaussianWfBuilder>();   
-    auto sparse_matrix_builder = std::make_unique<CrankNicolsonBuilder>(); 
+    std::optional<Checkpoint> resume{};             // live run restarted from a checkpoint, in its precision
+    if (!config.resume_path.empty() && config.playback_path.empty())
+    {
+        try
+        {
+            resume.emplace(config.resume_path);
+            apply_checkpoint(config, *resume);
+        }
+        catch(const std::exception& e)
+        {
+            std::println("Checkpoint restore failure: {}", e.what());
+            return EXIT_FAILURE;
+        }
+    }
 
-    SchodingerEquationBuilder eq_builder {L, dr, r0, std::move(sparse_matrix_builder), std::move(gaussian_wf_builder)};
-    SchodingerEquation        schrodinger{eq_builder.build_equation()};
+    start_profiling(config);
+    std::optional<LiveSimulation> live{};           // solved live on a worker thread...
+    std::optional<SnapshotReader> playback{};       // ...or replayed from a memory-mapped snapshot file
+    try
+    {
+        if (!config.playback_path.empty())
+        {
+            playback.emplace(config.playback_path);
+            if (playback->get_frame_count() == 0)
+            {
+                throw std::runtime_error("'" + config.playback_path + "' holds no frame");
+            }
+            std::println("Playback: {} frames from {}.", playback->get_frame_count(), config.playback_path);
+        }
+        else if (config.precision == PRECISION::DOUBLE)
+        {
+            live.emplace(start_live_simulation<std::complex<double>>(config, resume? &*resume : nullptr));
+        }
+        else
+        {
+            live.emplace(start_live_simulation<std::complex<float>>(config, resume? &*resume : nullptr));
+        }
+    }
+    catch(const std::exception& e)
+    {
+        std::println("Simulation or playback setup failure: {}", e.what());
+        return EXIT_FAILURE;
+    }
 
-    const size_t Nx           {schrodinger.Nx}; // number of "pixels" (steps) along the x direction
-    const size_t Ny           {schrodinger.Ny}; // number of "pixels" (steps) along the y direction
+    const size_t Nx           {playback? playback->get_header().Nx : live->double_slit.m_Nx}; // number of "pixels" (steps) along the x direction
+    const size_t Ny           {playback? playback->get_header().Ny : live->double_slit.m_Ny}; // number of "pixels" (steps) along the y direction
     const size_t Ntotal       {(Ny-2)*(Nx-2)};  // size of the matrix, with the boundary terms removed.
-    Interferometer double_slit{Nx, Ny};
 
   
     // ================================================================== //
@@ -55,12 +113,29 @@ int main()
     //                                                                    //
     // ================================================================== //
 
-    const size_t thickness = static_cast<size_t>(0.02f*Nx); // thickness of interfero, along the x-axixs, in pixels
-    const size_t width     = static_cast<size_t>(0.18f*Ny); // size of the part between the two slits (along the y-axis)
-    const size_t opening   = static_cast<size_t>(0.04f*Ny); // size of the two slits (along the y-axis)
-    const size_t height{Ny/2 - width/2 - opening};          // "height" from top/bottom until the slit. 
-    
-    double_slit.set_param(thickness, width, height);
+    Interferometer double_slit{Nx, Ny};
+    try
+    {
+        if (playback)
+        {
+            // the barrier the run was recorded with, whatever its geometry: an obstacle given for the playback must be that one
+            ObstacleMask recorded = playback->get_obstacle();
+            if (!config.obstacle_path.empty() && get_obstacle_key(load_obstacle_mask(config.obstacle_path, Nx, Ny)) != get_obstacle_key(recorded))
+            {
+                throw std::runtime_error("'" + config.playback_path + "' was recorded with another obstacle than '" + config.obstacle_path + "'");
+            }
+            double_slit.set_mask(std::move(recorded));
+        }
+        else
+        {
+            double_slit = live->double_slit;
+        }
+    }
+    catch(const std::exception& e)
+    {
+        std::println("Interferometer setup failure: {}", e.what());
+        return EXIT_FAILURE;
+    }
  
    
     // ===============================================//
@@ -73,35 +148,33 @@ int main()
     const float system_width {GetScreenWidth()*0.9f};
     const float system_heigh {GetScreenHeight()*0.9f};
 
-    // Size in pixel of the tiles on which we draw the wavefunction
+    // Size in pixel of one grid point on screen
     const size_t tile_dx  = static_cast<size_t>(system_width/Nx);
     const size_t tile_dy  = static_cast<size_t>(system_heigh/Ny);
 
-    // Create small tile to draw on; load it in the GPU for faster drawing.
-    RenderTexture2D tile = LoadRenderTexture(tile_dx, tile_dy);
-    BeginTextureMode(tile);
-        ClearBackground(WHITE);
-        DrawRectangle(0, 0, tile_dx, tile_dy, WHITE);
-    EndTextureMode();
-
-
     // parameters for drawing
     size_t x_start  = static_cast<size_t>((GetScreenWidth()  - Nx*tile_dx )/2);
     size_t y_start  = static_cast<size_t>((GetScreenHeight() - Ny*tile_dy )/2);
-    Point start{x_start,y_start};
 
     // Quantum box
     Rectangle quantum_box{(float)x_start, (float)y_start, Nx*(float)tile_dx , Ny*(float)tile_dy};
 
+    // The whole grid is one Nx x Ny texture, filled on the CPU and stretched over the quantum box.
+    std::optional<TextureRenderer> renderer{std::in_place, Nx, Ny, quantum_box};   // released before CloseWindow
+    const FramebufferStyle style{.background = {30, 30, 30, MAX_COLOR},
+                                 .wave       = {RGB_RED, RGB_BLUE, RGB_GREEN, MAX_COLOR},
+                                 .barrier    = {245, 245, 245, MAX_COLOR}};
+    const ObstacleMask& barrier = double_slit.get_mask();
+    std::vector<float> modulus(playback && playback->needs_scratch()? Ntotal : 0);  // quantized playback frames decoded here
+    std::vector<Rgba>  pixels(Nx*Ny);
+
 
     
     // Simulation variables:
-    float value{};                                      // local value of the wavefunction .
-    float vmax{};                                       // max value of the wavefunction at time t-1
-    float vmax_new{};                                   // max value of the wavefunction at time t
-    float alpha{};                                      // value of transparency for the tiles
-    Color tile_color{RGB_RED, RGB_BLUE, RGB_GREEN, 0};  // tile color, initiliazed with alpha = 0
-    size_t iy{}, jx{};
+    float vmax{};                                       // max value of the wavefunction at time t
+    size_t frame{};                                     // playback: frame shown
+    bool paused{false};                                 // live: P pauses/resumes the solver
+    bool show_profile{false};                           // I shows/hides the profiler overlay
 
 
     // ===============================================//
@@ -110,16 +183,20 @@ int main()
     //                                                //
     // ===============================================//
 
-    schrodinger.interact(double_slit);
-    schrodinger.evolve();
-    vmax = schrodinger.get_max_amplitude();
+    // Live: the solver steps on its own thread, paused until the simulation scene starts,
+    // and the loop below only draws the latest frame it published.
+    std::unique_ptr<ISimulationWorker> worker{live? std::move(live->worker) : nullptr};
 
     SetTargetFPS(60);
     while (!WindowShouldClose())
     {
-        if(IsKeyPressed(KEY_ENTER) || IsKeyPressed(KEY_SPACE))
+        if((IsKeyPressed(KEY_ENTER) || IsKeyPressed(KEY_SPACE)) && current_scene == SCENE::TITLESCREEN)
         {
             current_scene = SCENE::SIMULATION;
+            if (worker)
+            {
+                worker->send(COMMAND::RESUME);
+            }
         }
         
         if(current_scene == SCENE::TITLESCREEN)
@@ -130,44 +207,152 @@ int main()
         }    
         else if(current_scene == SCENE::SIMULATION)
         {
-            schrodinger.interact(double_slit);
-            BeginDrawing();
-                ClearBackground(Color{30, 30, 30, MAX_COLOR});
-                for (size_t k = 0; k < Ntotal; k++)
-                {
-                    value        = schrodinger.get_wf_modulus(k);
-                    alpha        = MAX_COLOR*(value/vmax);
-                    tile_color.a = (alpha > MAX_COLOR)? MAX_COLOR : static_cast<uint8_t>(alpha);
-
-                    if (value > vmax_new) 
-                        vmax_new = value;
-
-                    iy = k%(Ny-2);          
-                    jx = k/(Ny-2);
-                    double_slit.draw(tile, start, iy, jx);
-                    DrawTexture(tile.texture, start.x + (jx+1)*tile_dx, start.y + (iy+1)*tile_dy, tile_color);
-                }               
-                DrawRectangleLinesEx(quantum_box, 4, WHITE);
-                DrawFPS(x_start, y_start*0.4);
+            const PublishedFrame* published{};
+            std::span<const float> shown{};     // float32 playback frames are read in the mapping, live frames from the worker
+            if (playback)
+            {
+                vmax  = playback->get_frame_header(frame).max_modulus;
+                shown = playback->decode_modulus(frame, modulus);
+            }
+            else
+            {
+                worker->acquire_frame();    // keeps the previous frame when the solver has not published a new one
+                published = &worker->get_frame();
+                vmax      = published->max_modulus;
+                shown     = published->modulus;
+            }
+            {
+                PROFILE_SCOPE(PHASE::FRAMEBUFFER);
+                build_framebuffer(shown, vmax, barrier.get_pixel_spans(), Nx, Ny, style, pixels);
+            }
+            {
+                PROFILE_SCOPE(PHASE::RENDER);   // submission only: EndDrawing also waits for the frame rate
+                renderer->upload(pixels);
+
+                BeginDrawing();
+                    ClearBackground(Color{30, 30, 30, MAX_COLOR});
+                    renderer->draw();
+                    DrawRectangleLinesEx(quantum_box, 4, WHITE);
+                    DrawFPS(x_start, y_start*0.4);
+                    if (playback)
+                    {
+                        DrawText(TextFormat("frame %zu/%zu", frame+1, playback->get_frame_count()), x_start + 100, y_start*0.4, 20, LIME);
+                    }
+                    else
+                    {
+                        DrawText(TextFormat("%.0f steps/s", worker->get_steps_per_second()), x_start + 100, y_start*0.4, 20, LIME);
+                        DrawText(TextFormat("norm drift %.2e", published->norm_drift), x_start + 250, y_start*0.4, 20, LIME);
+                        DrawText(TextFormat("dt %.2e", published->dt), x_start + 450, y_start*0.4, 20, LIME);
+                        if (published->solver_iterations > 0)
+                        {
+                            DrawText(TextFormat("%zu solver iterations", published->solver_iterations), x_start + 580, y_start*0.4, 20, LIME);
+                        }
+                    }
+                    if (show_profile)
+                    {
+                        draw_profile_overlay(Profiler::get().snapshot(), x_start + 20, y_start + 20, 14);
+                    }
+            }
             EndDrawing();
 
-            vmax     = vmax_new;
-            vmax_new = 0;
-            
-            schrodinger.evolve();
+            if (IsKeyPressed(KEY_I))
+            {
+                show_profile = !show_profile;
+            }
+
+            if (playback)
+            {
+                frame = IsKeyPressed(KEY_BACKSPACE)? 0 : (frame + 1) % playback->get_frame_count();
+                continue;
+            }
 
-            if(IsKeyPressed(KEY_BACKSPACE))
+            if (IsKeyPressed(KEY_BACKSPACE))
+            {
+                worker->send(COMMAND::RESET);
+            }
+            if (IsKeyPressed(KEY_P))
+            {
+                paused = !paused;
+                worker->send(paused? COMMAND::PAUSE : COMMAND::RESUME);
+            }
+            if (IsKeyPressed(KEY_UP))
+            {
+                worker->send(COMMAND::LONGER_STEP);
+            }
+            if (IsKeyPressed(KEY_DOWN))
+            {
+                worker->send(COMMAND::SHORTER_STEP);
+            }
+            if (IsKeyPressed(KEY_C))
             {
-                schrodinger.reset();
+                worker->send(COMMAND::CHECKPOINT);
             }
         }
     }
 
-    UnloadRenderTexture(tile);
+    worker.reset();     // joins the solver thread, the recorder and the exporter are flushed with it, a last checkpoint written
+    write_profile(config);
+    renderer.reset();
     CloseWindow();    
     return EXIT_SUCCESS;
 }
 
+template<typename Scalar>
+auto start_live_simulation(const SimulationConfig& config, const Checkpoint* resume) -> LiveSimulation
+{
+    auto gaussian_wf_builder   = std::make_unique<GaussianWfBuilder<Scalar>>();   
+    auto sparse_matrix_builder = std::make_unique<CrankNicolsonBuilder<Scalar>>(); 
+
+    // kept by the worker after the equation is built, to change dt on the fly
+    auto eq_builder = std::make_shared<SchodingerEquationBuilder<Scalar>>(config.L, config.dr, config.initial_pos(), std::move(sparse_matrix_builder), std::move(gaussian_wf_builder));
+    eq_builder->set_engine(config.engine);                 // ENGINE::CRANK_NICOLSON, ENGINE::ADI for the matrix-free splitting, or ENGINE::SPLIT_OPERATOR
+    if (config.dt != 0.f)
+        eq_builder->set_time_step(config.dt);              // dx^2/4 unless set
+    eq_builder->set_absorbing_layer(config.absorbing_layer); // outgoing waves damped along the walls instead of reflected, if set
+    eq_builder->set_activity(config.activity);             // ADI stepped only where the packet is, if a threshold is set
+    eq_builder->set_solver_options(config.solver_options); // SOLVER::SPARSE_LU, or SOLVER::BICGSTAB / SOLVER::COCG, warm started from psi
+    eq_builder->set_operator_cache(config.operator_cache); // A and its factorization reused from a previous run with the same parameters
+    eq_builder->set_wave_number(config.wave_number);
+
+    // built with the equation, which may eliminate it from its linear system
+    Interferometer double_slit = build_interferometer(config, eq_builder->get_Nx(), eq_builder->get_Ny());
+    if (config.eliminate_obstacle)
+    {
+        eq_builder->set_obstacle(double_slit.get_mask());
+    }
+    SchodingerEquation<Scalar> schrodinger{eq_builder->build_equation()};
+    CheckpointClock clock{};
+    if (resume)
+    {
+        resume->check_geometry(schrodinger.Nx, schrodinger.Ny, schrodinger.get_packet_count(), double_slit.get_mask());
+        schrodinger.restore(resume->get_psi<Scalar>(), resume->get_stepper_state());     // the initial state kept for reset()
+        clock = resume->get_clock();
+        std::println("Resumed from {} at step {}, t = {:.6f}.", config.resume_path, clock.step, clock.time);
+    }
+
+    std::unique_ptr<SnapshotWriter> recorder{};
+    if (!config.record_path.empty())
+    {
+        recorder = std::make_unique<SnapshotWriter>(config.record_path, make_snapshot_header(config, double_slit, eq_builder->get_time_step()), double_slit.get_mask());
+    }
+    std::unique_ptr<FrameExporter> exporter{};
+    if (config.export_options.is_enabled())
+    {
+        exporter = std::make_unique<FrameExporter>(config.export_options, schrodinger.Nx, schrodinger.Ny, double_slit.get_mask());
+    }
+    std::unique_ptr<CheckpointWriter> checkpoints{};
+    if (!config.checkpoint_path.empty())
+    {
+        checkpoints = std::make_unique<CheckpointWriter>(config.checkpoint_path, make_checkpoint_header(config, double_slit, schrodinger.get_packet_count()), double_slit.get_mask(),
+                                                         std::span<const float>{}, std::chrono::duration<float>(config.checkpoint_interval));
+    }
+    auto retime = [eq_builder](SchodingerEquation<Scalar>& equation, float dt){ eq_builder->retime(equation, dt); };
+    auto worker = std::make_unique<SimulationWorker<Scalar>>(std::move(schrodinger), double_slit, std::move(recorder), config.record_every,
+                                                             std::move(exporter), config.export_options.every,
+                                                             std::move(checkpoints), clock, config.steps_per_frame,
+                                                             retime, eq_builder->get_time_step());
+    return LiveSimulation{std::move(worker), std::move(double_slit)};
+}
  
 void show_title_screen(std::string_view title, std::string_view subtitle)
 {
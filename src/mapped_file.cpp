@@ -0,0 +1,130 @@
+#include "mapped_file.hpp"
+#include <stdexcept>
+#include <thread>
+#include <functional>
+#include <format>
+#include <filesystem>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path, ACCESS_PATTERN pattern)
+{
+#ifdef _WIN32
+    (void)pattern;
+    m_file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file_handle == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("cannot open '" + path + "'");
+    }
+    LARGE_INTEGER size{};
+    GetFileSizeEx(m_file_handle, &size);
+    m_bytes = static_cast<size_t>(size.QuadPart);
+    if (m_bytes > 0)
+    {
+        m_mapping_handle = CreateFileMappingA(m_file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping_handle)
+            m_data = static_cast<const std::byte*>(MapViewOfFile(m_mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("cannot open '" + path + "'");
+    }
+    struct stat info{};
+    ::fstat(fd, &info);
+    m_bytes = static_cast<size_t>(info.st_size);
+    if (m_bytes > 0)
+    {
+        void* mapping = ::mmap(nullptr, m_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            m_data = static_cast<const std::byte*>(mapping);
+            ::madvise(mapping, m_bytes, pattern == ACCESS_PATTERN::SEQUENTIAL? MADV_SEQUENTIAL : MADV_RANDOM);
+        }
+    }
+    ::close(fd);
+#endif
+    if (!m_data)
+    {
+        release();
+        throw std::runtime_error("cannot map '" + path + "'");
+    }
+}
+MappedFile::~MappedFile()
+{
+    release();
+}
+void MappedFile::release()
+{
+#ifdef _WIN32
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping_handle)
+        CloseHandle(m_mapping_handle);
+    if (m_file_handle && m_file_handle != INVALID_HANDLE_VALUE)
+        CloseHandle(m_file_handle);
+    m_mapping_handle = nullptr;
+    m_file_handle    = nullptr;
+#else
+    if (m_data)
+        ::munmap(const_cast<std::byte*>(m_data), m_bytes);
+#endif
+    m_data = nullptr;
+}
+
+auto get_temporary_path(const std::string& path) -> std::string
+{
+#ifdef _WIN32
+    const auto pid = _getpid();
+#else
+    const auto pid = ::getpid();
+#endif
+    return std::format("{}.{}.{:x}.tmp", path, pid, std::hash<std::thread::id>{}(std::this_thread::get_id()));
+}
+
+void sync_file(const std::string& path)
+{
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    const bool synced = handle != INVALID_HANDLE_VALUE && FlushFileBuffers(handle);
+    if (handle != INVALID_HANDLE_VALUE)
+        CloseHandle(handle);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    const bool synced = fd >= 0 && ::fsync(fd) == 0;
+    if (fd >= 0)
+        ::close(fd);
+#endif
+    if (!synced)
+    {
+        throw std::runtime_error("cannot flush '" + path + "' to disk");
+    }
+}
+void sync_directory(const std::string& path)
+{
+#ifndef _WIN32
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    if (directory.empty())
+        directory = ".";
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    const bool synced = fd >= 0 && ::fsync(fd) == 0;
+    if (fd >= 0)
+        ::close(fd);
+    if (!synced)
+    {
+        throw std::runtime_error("cannot flush directory '" + directory + "' to disk");
+    }
+#else
+    (void)path;
+#endif
+}
@@ -0,0 +1,263 @@
+#include "obstacle_mask.hpp"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+ObstacleMask::ObstacleMask(size_t Nx, size_t Ny, std::span<const uint8_t> cells)
+    : m_psi_size{(Nx-2)*(Ny-2)}
+{
+    if (cells.size() != Nx*Ny)
+    {
+        throw std::invalid_argument("obstacle mask of " + std::to_string(cells.size()) + " cells for a " + std::to_string(Nx) + "x" + std::to_string(Ny) + " grid");
+    }
+    auto extend = [](std::vector<MaskSpan>& spans, size_t index)
+    {
+        if (!spans.empty() && spans.back().begin + spans.back().length == index)
+            spans.back().length++;
+        else
+            spans.push_back({static_cast<uint32_t>(index), 1});
+    };
+
+    // psi order: k = (jx-1)*(Ny-2) + (iy-1), a run may carry on into the next column
+    for (size_t jx = 1; jx < Nx-1; jx++)
+    {
+        for (size_t iy = 1; iy < Ny-1; iy++)
+        {
+            if (cells[iy*Nx + jx])
+            {
+                extend(m_psi_spans, (jx-1)*(Ny-2) + (iy-1));
+                m_psi_count++;
+            }
+        }
+    }
+    for (size_t p = 0; p < cells.size(); p++)
+    {
+        if (cells[p])
+            extend(m_pixel_spans, p);
+    }
+}
+template<typename Scalar>
+void ObstacleMask::apply(VectorX<Scalar>& psi) const
+{
+    if (m_psi_spans.empty())
+        return;
+    for (Eigen::Index packet = 0; packet < psi.size(); packet += m_psi_size)
+    {
+        for (const auto& span : m_psi_spans)
+        {
+            psi.segment(packet + span.begin, span.length).setZero();
+        }
+    }
+}
+template<typename Scalar>
+void ObstacleMask::apply(SplitField<Scalar>& psi) const
+{
+    if (static_cast<size_t>(psi.size()) != m_psi_size)
+    {
+        throw std::invalid_argument("obstacle mask of " + std::to_string(m_psi_size) + " cells for a split field of " + std::to_string(psi.size()));
+    }
+    const size_t rows = psi.get_rows();
+    for (const auto& span : m_psi_spans)
+    {
+        size_t k         = span.begin;
+        const size_t end = span.begin + span.length;
+        while (k < end)
+        {
+            const size_t jx = k/rows;
+            const size_t iy = k%rows;
+            const size_t n  = std::min(end - k, rows - iy);
+            std::fill_n(psi.real(jx) + iy, n, Real<Scalar>{});
+            std::fill_n(psi.imag(jx) + iy, n, Real<Scalar>{});
+            k += n;
+        }
+    }
+}
+template void ObstacleMask::apply(VectorX<std::complex<float>>&) const;
+template void ObstacleMask::apply(VectorX<std::complex<double>>&) const;
+template void ObstacleMask::apply(SplitField<std::complex<float>>&) const;
+template void ObstacleMask::apply(SplitField<std::complex<double>>&) const;
+
+FreeCellMap::FreeCellMap(size_t N, const ObstacleMask& obstacle)
+    : m_compact(N, 0)
+{
+    for (const auto& span : obstacle.get_psi_spans())
+    {
+        std::fill_n(m_compact.begin() + span.begin, span.length, -1);
+    }
+    for (size_t k = 0; k < N; k++)
+    {
+        if (m_compact[k] < 0)
+            continue;
+        m_compact[k] = static_cast<int32_t>(m_size++);
+        if (!m_free_spans.empty() && m_free_spans.back().begin + m_free_spans.back().length == k)
+            m_free_spans.back().length++;
+        else
+            m_free_spans.push_back({static_cast<uint32_t>(k), 1});
+    }
+}
+template<typename Scalar>
+void FreeCellMap::gather(const VectorX<Scalar>& full, VectorX<Scalar>& compact) const
+{
+    compact.resize(m_size);
+    Eigen::Index offset{};
+    for (const auto& span : m_free_spans)
+    {
+        compact.segment(offset, span.length) = full.segment(span.begin, span.length);
+        offset += span.length;
+    }
+}
+template<typename Scalar>
+void FreeCellMap::scatter(const VectorX<Scalar>& compact, VectorX<Scalar>& full) const
+{
+    Eigen::Index offset{};
+    for (const auto& span : m_free_spans)
+    {
+        full.segment(span.begin, span.length) = compact.segment(offset, span.length);
+        offset += span.length;
+    }
+}
+template<typename Scalar>
+void FreeCellMap::gather_columns(const Eigen::Ref<const MatrixX<Scalar>>& full, MatrixX<Scalar>& compact) const
+{
+    compact.resize(m_size, full.cols());
+    Eigen::Index offset{};
+    for (const auto& span : m_free_spans)
+    {
+        compact.middleRows(offset, span.length) = full.middleRows(span.begin, span.length);
+        offset += span.length;
+    }
+}
+template<typename Scalar>
+void FreeCellMap::scatter_columns(const MatrixX<Scalar>& compact, Eigen::Ref<MatrixX<Scalar>> full) const
+{
+    Eigen::Index offset{};
+    for (const auto& span : m_free_spans)
+    {
+        full.middleRows(span.begin, span.length) = compact.middleRows(offset, span.length);
+        offset += span.length;
+    }
+}
+template void FreeCellMap::gather(const VectorX<std::complex<float>>&, VectorX<std::complex<float>>&) const;
+template void FreeCellMap::gather(const VectorX<std::complex<double>>&, VectorX<std::complex<double>>&) const;
+template void FreeCellMap::scatter(const VectorX<std::complex<float>>&, VectorX<std::complex<float>>&) const;
+template void FreeCellMap::scatter(const VectorX<std::complex<double>>&, VectorX<std::complex<double>>&) const;
+template void FreeCellMap::gather_columns(const Eigen::Ref<const MatrixX<std::complex<float>>>&, MatrixX<std::complex<float>>&) const;
+template void FreeCellMap::gather_columns(const Eigen::Ref<const MatrixX<std::complex<double>>>&, MatrixX<std::complex<double>>&) const;
+template void FreeCellMap::scatter_columns(const MatrixX<std::complex<float>>&, Eigen::Ref<MatrixX<std::complex<float>>>) const;
+template void FreeCellMap::scatter_columns(const MatrixX<std::complex<double>>&, Eigen::Ref<MatrixX<std::complex<double>>>) const;
+
+// Grayscale image as read from the file, 1 on an obstacle
+struct Bitmap
+{
+    size_t width{};
+    size_t height{};
+    std::vector<uint8_t> cells{};
+};
+
+static auto next_pgm_token(std::istream& in) -> size_t
+{
+    in >> std::ws;
+    while (in.peek() == '#')
+    {
+        std::string comment{};
+        std::getline(in, comment);
+        in >> std::ws;
+    }
+    size_t value{};
+    if (!(in >> value))
+    {
+        throw std::invalid_argument("truncated PGM header");
+    }
+    return value;
+}
+static auto read_pgm(std::istream& in) -> Bitmap
+{
+    std::string magic(2, '\0');
+    in.read(magic.data(), 2);
+    if (magic != "P2" && magic != "P5")
+    {
+        throw std::invalid_argument("only P2 and P5 PGM files are supported");
+    }
+    Bitmap bitmap{};
+    bitmap.width  = next_pgm_token(in);
+    bitmap.height = next_pgm_token(in);
+    const size_t maxval = next_pgm_token(in);
+    if (maxval == 0 || maxval > 65535)
+    {
+        throw std::invalid_argument("invalid PGM maxval " + std::to_string(maxval));
+    }
+    bitmap.cells.resize(bitmap.width*bitmap.height);
+
+    if (magic == "P2")
+    {
+        for (auto& cell : bitmap.cells)
+            cell = next_pgm_token(in) < (maxval+1)/2;
+        return bitmap;
+    }
+    in.get();   // the single whitespace ending the header
+    const size_t bytes = (maxval < 256)? 1 : 2;
+    std::vector<unsigned char> raster(bitmap.cells.size()*bytes);
+    if (!in.read(reinterpret_cast<char*>(raster.data()), raster.size()))
+    {
+        throw std::invalid_argument("truncated PGM raster");
+    }
+    for (size_t p = 0; p < bitmap.cells.size(); p++)
+    {
+        const size_t value = (bytes == 1)? raster[p] : (size_t(raster[2*p]) << 8 | raster[2*p+1]);   // 16-bit samples are big endian
+        bitmap.cells[p] = value < (maxval+1)/2;
+    }
+    return bitmap;
+}
+static auto read_text_grid(std::istream& in) -> Bitmap
+{
+    std::vector<std::string> rows{};
+    std::string line{};
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        rows.push_back(line);
+    }
+    while (!rows.empty() && rows.back().empty())
+        rows.pop_back();
+
+    Bitmap bitmap{};
+    bitmap.height = rows.size();
+    for (const auto& row : rows)
+        bitmap.width = std::max(bitmap.width, row.size());
+    bitmap.cells.resize(bitmap.width*bitmap.height, 0);
+    for (size_t y = 0; y < rows.size(); y++)
+    {
+        for (size_t x = 0; x < rows[y].size(); x++)
+        {
+            const char c = rows[y][x];
+            bitmap.cells[y*bitmap.width + x] = (c == '#' || c == 'X' || c == '1');
+        }
+    }
+    return bitmap;
+}
+auto load_obstacle_mask(const std::string& path, size_t Nx, size_t Ny) -> ObstacleMask
+{
+    std::ifstream file{path, std::ios::binary};
+    if (!file)
+    {
+        throw std::invalid_argument("cannot open obstacle file '" + path + "'");
+    }
+    Bitmap bitmap = path.ends_with(".pgm")? read_pgm(file) : read_text_grid(file);
+    if (bitmap.width == 0 || bitmap.height == 0)
+    {
+        throw std::invalid_argument("obstacle file '" + path + "' is empty");
+    }
+
+    std::vector<uint8_t> cells(Nx*Ny);
+    for (size_t iy = 0; iy < Ny; iy++)
+    {
+        const size_t y = iy*bitmap.height/Ny;
+        for (size_t jx = 0; jx < Nx; jx++)
+        {
+            cells[iy*Nx + jx] = bitmap.cells[y*bitmap.width + jx*bitmap.width/Nx];
+        }
+    }
+    return ObstacleMask{Nx, Ny, cells};
+}
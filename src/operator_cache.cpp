@@ -0,0 +1,182 @@
+#include "operator_cache.hpp"
+#include <fstream>
+#include <filesystem>
+#include <cstdio>
+#include <stdexcept>
+
+constexpr uint64_t SECTION_ALIGNMENT = 64;
+
+auto get_eigen_version() -> uint32_t
+{
+    return EIGEN_WORLD_VERSION*10000 + EIGEN_MAJOR_VERSION*100 + EIGEN_MINOR_VERSION;
+}
+auto get_operator_cache_path(const std::string& directory, uint64_t key) -> std::string
+{
+    char name[32]{};
+    std::snprintf(name, sizeof(name), "%016llx.opcache", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(directory) / name).string();
+}
+
+
+auto CacheKey::add_bytes(std::span<const std::byte> bytes) -> CacheKey&
+{
+    const size_t words = bytes.size()/sizeof(uint64_t);
+    for (size_t i = 0; i < words; i++)
+    {
+        uint64_t word{};
+        std::memcpy(&word, bytes.data() + i*sizeof(uint64_t), sizeof(uint64_t));
+        m_hash = (m_hash ^ word)*0x100000001b3ull;
+    }
+    if (const size_t rest = bytes.size() - words*sizeof(uint64_t); rest > 0)
+    {
+        uint64_t tail{};
+        std::memcpy(&tail, bytes.data() + words*sizeof(uint64_t), rest);
+        m_hash = (m_hash ^ tail)*0x100000001b3ull;
+    }
+    return *this;
+}
+
+
+template<typename Scalar>
+void OperatorCacheWriter::add_matrix(const SparseMatrix<Scalar>& A)
+{
+    if (!A.isCompressed())
+    {
+        throw std::invalid_argument("only compressed matrices are cached");
+    }
+    add(CACHE_SECTION::A_OUTER,  std::span(A.outerIndexPtr(), A.outerSize() + 1));
+    add(CACHE_SECTION::A_INNER,  std::span(A.innerIndexPtr(), A.nonZeros()));
+    add(CACHE_SECTION::A_VALUES, std::span(A.valuePtr(),      A.nonZeros()));
+}
+template void OperatorCacheWriter::add_matrix(const SparseMatrix<std::complex<float>>&);
+template void OperatorCacheWriter::add_matrix(const SparseMatrix<std::complex<double>>&);
+void OperatorCacheWriter::write(const std::string& path, uint64_t key) const
+{
+    OperatorCacheHeader header{};
+    std::memcpy(header.magic, OPERATOR_CACHE_MAGIC, sizeof(OPERATOR_CACHE_MAGIC));
+    header.section_count = static_cast<uint32_t>(m_sections.size());
+    header.key           = key;
+    header.eigen_version = get_eigen_version();
+
+    auto align = [](uint64_t offset){ return (offset + SECTION_ALIGNMENT - 1)/SECTION_ALIGNMENT*SECTION_ALIGNMENT; };
+    std::vector<CacheSectionHeader> table{};
+    uint64_t offset = align(sizeof(OperatorCacheHeader) + m_sections.size()*sizeof(CacheSectionHeader));
+    for (const auto& section : m_sections)
+    {
+        table.push_back({section.id, section.element_bytes, offset, section.bytes.size()/section.element_bytes, CacheKey{}.add_bytes(section.bytes).get()});
+        offset = align(offset + section.bytes.size());
+    }
+
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path());
+    const std::string temporary = get_temporary_path(path);
+    {
+        std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+        if (!file)
+        {
+            throw std::runtime_error("cannot open '" + temporary + "' for writing");
+        }
+        const char padding[SECTION_ALIGNMENT]{};
+        auto pad_to = [&](uint64_t target)
+        {
+            file.write(padding, static_cast<std::streamsize>(target - static_cast<uint64_t>(file.tellp())));
+        };
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(table.data()), table.size()*sizeof(CacheSectionHeader));
+        for (size_t i = 0; i < m_sections.size(); i++)
+        {
+            pad_to(table[i].offset);
+            file.write(reinterpret_cast<const char*>(m_sections[i].bytes.data()), m_sections[i].bytes.size());
+        }
+        if (!file)
+        {
+            file.close();
+            std::filesystem::remove(temporary);
+            throw std::runtime_error("failed writing '" + temporary + "'");
+        }
+    }
+    // a reader never sees a half written entry
+    std::filesystem::rename(temporary, path);
+}
+
+
+OperatorCacheEntry::OperatorCacheEntry(const std::string& path)
+    : m_file{path, ACCESS_PATTERN::SEQUENTIAL}
+{
+    if (m_file.size() < sizeof(OperatorCacheHeader))
+    {
+        throw std::runtime_error("'" + path + "' is too short to be an operator cache entry");
+    }
+    std::memcpy(&m_header, m_file.data(), sizeof(OperatorCacheHeader));
+    if (std::memcmp(m_header.magic, OPERATOR_CACHE_MAGIC, sizeof(OPERATOR_CACHE_MAGIC)) != 0)
+    {
+        throw std::runtime_error("'" + path + "' is not an operator cache entry");
+    }
+    if (m_header.version != OPERATOR_CACHE_VERSION)
+    {
+        throw std::runtime_error("'" + path + "' is a version " + std::to_string(m_header.version) + " operator cache entry");
+    }
+    const uint64_t table_end = sizeof(OperatorCacheHeader) + uint64_t(m_header.section_count)*sizeof(CacheSectionHeader);
+    if (table_end > m_file.size())
+    {
+        throw std::runtime_error("'" + path + "' is truncated");
+    }
+    m_sections.resize(m_header.section_count);
+    std::memcpy(m_sections.data(), m_file.data() + sizeof(OperatorCacheHeader), m_sections.size()*sizeof(CacheSectionHeader));
+    for (const auto& section : m_sections)
+    {
+        if (section.element_bytes == 0 || section.offset > m_file.size() || section.count > (m_file.size() - section.offset)/section.element_bytes)
+        {
+            throw std::runtime_error("'" + path + "' is truncated");
+        }
+        const std::span<const std::byte> payload(m_file.data() + section.offset, section.count*section.element_bytes);
+        if (CacheKey{}.add_bytes(payload).get() != section.checksum)
+        {
+            throw std::runtime_error("'" + path + "' is corrupted (section " + std::to_string(static_cast<uint32_t>(section.id)) + ")");
+        }
+    }
+}
+bool OperatorCacheEntry::is_compatible(uint64_t key) const
+{
+    return m_header.version == OPERATOR_CACHE_VERSION && m_header.key == key && m_header.eigen_version == get_eigen_version();
+}
+bool OperatorCacheEntry::has(CACHE_SECTION id) const
+{
+    for (const auto& section : m_sections)
+    {
+        if (section.id == id)
+            return true;
+    }
+    return false;
+}
+auto OperatorCacheEntry::find(CACHE_SECTION id, uint32_t element_bytes) const -> const CacheSectionHeader&
+{
+    for (const auto& section : m_sections)
+    {
+        if (section.id == id)
+        {
+            if (section.element_bytes != element_bytes)
+            {
+                throw std::runtime_error("operator cache section " + std::to_string(static_cast<uint32_t>(id)) + " has unexpected elements");
+            }
+            return section;
+        }
+    }
+    throw std::runtime_error("operator cache section " + std::to_string(static_cast<uint32_t>(id)) + " is missing");
+}
+template<typename Scalar>
+auto OperatorCacheEntry::get_matrix() const -> SparseMatrix<Scalar>
+{
+    auto outer  = get<typename SparseMatrix<Scalar>::StorageIndex>(CACHE_SECTION::A_OUTER);
+    auto inner  = get<typename SparseMatrix<Scalar>::StorageIndex>(CACHE_SECTION::A_INNER);
+    auto values = get<Scalar>(CACHE_SECTION::A_VALUES);
+    if (outer.empty() || inner.size() != values.size() || static_cast<size_t>(outer.back()) != values.size())
+    {
+        throw std::runtime_error("inconsistent cached matrix");
+    }
+    // square matrix: as many rows as columns
+    const Eigen::Index n = static_cast<Eigen::Index>(outer.size() - 1);
+    Eigen::Map<const SparseMatrix<Scalar>> mapped(n, n, static_cast<Eigen::Index>(values.size()), outer.data(), inner.data(), values.data());
+    return SparseMatrix<Scalar>(mapped);
+}
+template auto OperatorCacheEntry::get_matrix<std::complex<float>>() const  -> SparseMatrix<std::complex<float>>;
+template auto OperatorCacheEntry::get_matrix<std::complex<double>>() const -> SparseMatrix<std::complex<double>>;
@@ -0,0 +1,35 @@
+#include "operator_pool.hpp"
+
+template<typename Scalar>
+auto OperatorPool<Scalar>::acquire(uint64_t key, const std::function<SolverPtr()>& setup) -> SolverPtr
+{
+    std::shared_ptr<Entry> entry{};
+    {
+        std::lock_guard lock{m_mutex};
+        auto& slot = m_entries[key];
+        if (!slot)
+            slot = std::make_shared<Entry>();
+        entry = slot;
+    }
+
+    // A setup that throws leaves the entry to the next request
+    SolverPtr own{};
+    std::call_once(entry->ready, [&]
+    {
+        own = setup();
+        entry->solver = own->share();
+        m_setups++;
+    });
+    if (own)
+        return own;
+    if (entry->solver)
+    {
+        m_reuses++;
+        return entry->solver->share();
+    }
+    m_setups++;
+    return setup();
+}
+
+template class OperatorPool<std::complex<float>>;
+template class OperatorPool<std::complex<double>>;
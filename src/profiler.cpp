@@ -0,0 +1,202 @@
+#include "profiler.hpp"
+#include <print>
+#include <cstdio>
+#include <stdexcept>
+#include <algorithm>
+
+namespace
+{
+    auto get_thread_index() -> uint32_t
+    {
+        static std::atomic<uint32_t> next{};
+        thread_local uint32_t index = next.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+    auto open_for_writing(const std::string& path) -> std::FILE*
+    {
+        std::FILE* out = std::fopen(path.c_str(), "w");
+        if (!out)
+        {
+            throw std::runtime_error("cannot open '" + path + "' for writing");
+        }
+        return out;
+    }
+    // A full disk may only show at the final flush
+    void close_after_writing(std::FILE* out, const std::string& path)
+    {
+        const bool failed = std::ferror(out) != 0;
+        if (std::fclose(out) != 0 || failed)
+        {
+            throw std::runtime_error("failed writing '" + path + "'");
+        }
+    }
+}
+
+auto get_phase_name(PHASE phase) -> const char*
+{
+    switch (phase)
+    {
+    case PHASE::ASSEMBLY:      return "assembly";
+    case PHASE::FACTORIZATION: return "factorization";
+    case PHASE::EVOLVE:        return "evolve";
+    case PHASE::RHS_PRODUCT:   return "rhs_product";
+    case PHASE::SOLVE:         return "solve";
+    case PHASE::INTERACT:      return "interact";
+    case PHASE::OBSERVABLES:   return "observables";
+    case PHASE::FRAMEBUFFER:   return "framebuffer";
+    case PHASE::RENDER:        return "render";
+    case PHASE::EXPORT:        return "export";
+    case PHASE::CHECKPOINT:    return "checkpoint";
+    case PHASE::COUNT:         break;
+    }
+    return "unknown";
+}
+auto get_counter_name(COUNTER counter) -> const char*
+{
+    switch (counter)
+    {
+    case COUNTER::STEPS:             return "steps";
+    case COUNTER::SOLVER_ITERATIONS: return "solver_iterations";
+    case COUNTER::BYTES_ALLOCATED:   return "bytes_allocated";
+    case COUNTER::ACTIVE_CELLS:      return "active_cells";
+    case COUNTER::FRAMES_DROPPED:    return "frames_dropped";
+    case COUNTER::COUNT:             break;
+    }
+    return "unknown";
+}
+
+
+auto Profiler::get() -> Profiler&
+{
+    static Profiler profiler{};
+    return profiler;
+}
+void Profiler::record(PHASE phase, Clock::time_point start, Clock::time_point end)
+{
+    const uint64_t duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    Phase& stats = m_phases[static_cast<size_t>(phase)];
+    stats.calls.fetch_add(1, std::memory_order_relaxed);
+    stats.total_ns.fetch_add(duration, std::memory_order_relaxed);
+    uint64_t seen = stats.min_ns.load(std::memory_order_relaxed);
+    while (duration < seen && !stats.min_ns.compare_exchange_weak(seen, duration, std::memory_order_relaxed)) {}
+    seen = stats.max_ns.load(std::memory_order_relaxed);
+    while (duration > seen && !stats.max_ns.compare_exchange_weak(seen, duration, std::memory_order_relaxed)) {}
+
+    if (m_trace.empty())
+        return;
+    const size_t slot = m_trace_next.fetch_add(1, std::memory_order_relaxed);
+    if (slot < m_trace.size())
+    {
+        m_trace[slot] = {phase, get_thread_index(), get_clock_ns(start), duration};
+    }
+}
+void Profiler::enable_trace(size_t capacity)
+{
+    m_trace.assign(capacity, TraceEvent{});
+    m_trace_next = 0;
+}
+auto Profiler::snapshot() const -> ProfileSnapshot
+{
+    ProfileSnapshot snapshot{};
+    for (size_t p = 0; p < PHASE_COUNT; p++)
+    {
+        const Phase& stats = m_phases[p];
+        PhaseStats& out = snapshot.phases[p];
+        out.calls    = stats.calls.load(std::memory_order_relaxed);
+        out.total_ms = stats.total_ns.load(std::memory_order_relaxed)*1e-6;
+        out.min_ms   = out.calls? stats.min_ns.load(std::memory_order_relaxed)*1e-6 : 0.0;
+        out.max_ms   = stats.max_ns.load(std::memory_order_relaxed)*1e-6;
+    }
+    for (size_t c = 0; c < COUNTER_COUNT; c++)
+    {
+        snapshot.counters[c] = m_counters[c].load(std::memory_order_relaxed);
+    }
+    snapshot.norm_drift = m_norm_drift.load(std::memory_order_relaxed);
+    snapshot.elapsed_s  = 1e-9*(get_clock_ns(Clock::now()) - m_origin_ns.load(std::memory_order_relaxed));
+    return snapshot;
+}
+void Profiler::reset()
+{
+    for (auto& stats : m_phases)
+    {
+        stats.calls    = 0;
+        stats.total_ns = 0;
+        stats.min_ns   = UINT64_MAX;
+        stats.max_ns   = 0;
+    }
+    for (auto& counter : m_counters)
+    {
+        counter = 0;
+    }
+    m_norm_drift = 0.0;
+    // The trace is not rewound: a scope in flight may still write the slot it took, which a new scope would share.
+    // What was recorded before the origin is left out of the trace file instead.
+    m_origin_ns.store(get_clock_ns(Clock::now()), std::memory_order_relaxed);
+}
+size_t Profiler::get_trace_dropped() const
+{
+    const size_t recorded = m_trace_next.load();
+    return (recorded > m_trace.size())? recorded - m_trace.size() : 0;
+}
+void Profiler::write_summary(const std::string& path) const
+{
+    const ProfileSnapshot profile = snapshot();
+    std::FILE* out = open_for_writing(path);
+    if (path.ends_with(".json"))
+    {
+        std::println(out, "{{");
+        std::println(out, "  \"elapsed_s\": {:.6f},", profile.elapsed_s);
+        std::println(out, "  \"phases\": [");
+        for (size_t p = 0; p < PHASE_COUNT; p++)
+        {
+            const PhaseStats& stats = profile.phases[p];
+            std::println(out, "    {{\"phase\": \"{}\", \"calls\": {}, \"total_ms\": {:.6f}, \"mean_ms\": {:.6f}, \"min_ms\": {:.6f}, \"max_ms\": {:.6f}}}{}",
+                         get_phase_name(static_cast<PHASE>(p)), stats.calls, stats.total_ms, stats.mean_ms(), stats.min_ms, stats.max_ms, (p+1 < PHASE_COUNT)? "," : "");
+        }
+        std::println(out, "  ],");
+        std::println(out, "  \"counters\": {{");
+        for (size_t c = 0; c < COUNTER_COUNT; c++)
+        {
+            std::println(out, "    \"{}\": {},", get_counter_name(static_cast<COUNTER>(c)), profile.counters[c]);
+        }
+        std::println(out, "    \"norm_drift\": {:.6e}", profile.norm_drift);
+        std::println(out, "  }}");
+        std::println(out, "}}");
+    }
+    else
+    {
+        std::println(out, "kind,name,calls,total_ms,mean_ms,min_ms,max_ms,value");
+        for (size_t p = 0; p < PHASE_COUNT; p++)
+        {
+            const PhaseStats& stats = profile.phases[p];
+            std::println(out, "phase,{},{},{:.6f},{:.6f},{:.6f},{:.6f},", get_phase_name(static_cast<PHASE>(p)), stats.calls, stats.total_ms, stats.mean_ms(), stats.min_ms, stats.max_ms);
+        }
+        for (size_t c = 0; c < COUNTER_COUNT; c++)
+        {
+            std::println(out, "counter,{},,,,,,{}", get_counter_name(static_cast<COUNTER>(c)), profile.counters[c]);
+        }
+        std::println(out, "counter,norm_drift,,,,,,{:.6e}", profile.norm_drift);
+        std::println(out, "counter,elapsed_s,,,,,,{:.6f}", profile.elapsed_s);
+    }
+    close_after_writing(out, path);
+}
+void Profiler::write_trace(const std::string& path) const
+{
+    // Complete ("X") events, timestamps and durations in microseconds, from the origin on
+    const size_t count    = std::min(m_trace_next.load(), m_trace.size());
+    const int64_t origin  = m_origin_ns.load(std::memory_order_relaxed);
+    const char* separator = "";
+    std::FILE* out = open_for_writing(path);
+    std::println(out, "{{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    for (size_t k = 0; k < count; k++)
+    {
+        const TraceEvent& event = m_trace[k];
+        if (event.start_ns < origin)
+            continue;
+        std::print(out, "{}{{\"name\": \"{}\", \"ph\": \"X\", \"pid\": 1, \"tid\": {}, \"ts\": {:.3f}, \"dur\": {:.3f}}}",
+                   separator, get_phase_name(event.phase), event.thread, (event.start_ns - origin)*1e-3, event.duration_ns*1e-3);
+        separator = ",\n";
+    }
+    std::println(out, "\n]}}");
+    close_after_writing(out, path);
+}
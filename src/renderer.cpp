@@ -0,0 +1,46 @@
+#include "renderer.hpp"
+
+static_assert(sizeof(Rgba) == sizeof(Color), "the framebuffer is uploaded as an array of raylib Color");
+
+TextureRenderer::TextureRenderer(size_t Nx, size_t Ny, Rectangle destination)
+    : m_destination{destination}
+{
+    Image image = GenImageColor(static_cast<int>(Nx), static_cast<int>(Ny), BLACK);
+    m_texture   = LoadTextureFromImage(image);
+    UnloadImage(image);
+    SetTextureFilter(m_texture, TEXTURE_FILTER_POINT);  // one grid point = one sharp block of screen pixels
+}
+TextureRenderer::~TextureRenderer()
+{
+    UnloadTexture(m_texture);
+}
+void TextureRenderer::upload(std::span<const Rgba> pixels)
+{
+    UpdateTexture(m_texture, pixels.data());
+}
+void TextureRenderer::draw() const
+{
+    Rectangle source{0, 0, static_cast<float>(m_texture.width), static_cast<float>(m_texture.height)};
+    DrawTexturePro(m_texture, source, m_destination, Vector2{0, 0}, 0.f, WHITE);
+}
+void draw_profile_overlay(const ProfileSnapshot& profile, int x, int y, int font_size)
+{
+    const int line_height = font_size + 4;
+    const int lines       = static_cast<int>(PHASE_COUNT + COUNTER_COUNT) + 2;
+    DrawRectangle(x - 8, y - 8, 30*font_size, lines*line_height + 16, Color{0, 0, 0, 180});
+    DrawText(TextFormat("%-14s %8s %10s %10s", "phase", "calls", "mean[ms]", "max[ms]"), x, y, font_size, LIGHTGRAY);
+    for (size_t p = 0; p < PHASE_COUNT; p++)
+    {
+        const PhaseStats& stats = profile.phases[p];
+        y += line_height;
+        DrawText(TextFormat("%-14s %8llu %10.3f %10.3f", get_phase_name(static_cast<PHASE>(p)), static_cast<unsigned long long>(stats.calls), stats.mean_ms(), stats.max_ms),
+                 x, y, font_size, stats.calls? LIME : GRAY);
+    }
+    for (size_t c = 0; c < COUNTER_COUNT; c++)
+    {
+        y += line_height;
+        DrawText(TextFormat("%-14s %8llu", get_counter_name(static_cast<COUNTER>(c)), static_cast<unsigned long long>(profile.counters[c])), x, y, font_size, SKYBLUE);
+    }
+    y += line_height;
+    DrawText(TextFormat("%-14s %8.2e", "norm_drift", profile.norm_drift), x, y, font_size, SKYBLUE);
+}
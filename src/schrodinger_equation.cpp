@@ -1,41 +1,173 @@
 #include "schrodinger_equation.hpp"
+#include "profiler.hpp"
+
   
-SchodingerEquation::SchodingerEquation(size_t Nx_, size_t Ny_, const SparseMatrix& sparse_A, SparseMatrix&& sparse_M, Eigen::VectorXcf&& initial_wf)
-    : Nx{Nx_}, Ny{Ny_}, m_solver(sparse_A), m_sparse_M{sparse_M}, m_psi{initial_wf}
+template<typename Scalar>
+SchodingerEquation<Scalar>::SchodingerEquation(size_t Nx_, size_t Ny_, std::unique_ptr<ITimeStepper<Scalar>> stepper, VectorX<Scalar>&& initial_wf)
+    : Nx{Nx_}, Ny{Ny_}, m_stepper{std::move(stepper)}, m_psi{initial_wf}
 {
-    m_psi_backup = m_psi;
+    init_packets(1);
 }
-
-
-float SchodingerEquation::get_wf_modulus(size_t k) const
+template<typename Scalar>
+SchodingerEquation<Scalar>::SchodingerEquation(size_t Nx_, size_t Ny_, std::unique_ptr<ITimeStepper<Scalar>> stepper, const MatrixX<Scalar>& initial_packets)
+    : Nx{Nx_}, Ny{Ny_}, m_stepper{std::move(stepper)}, m_psi{initial_packets.reshaped()}
 {
-    std::complex<float> z = m_psi(k);
-    return sqrt(   pow(z.real(),2) + pow(z.imag(),2)   );
+    init_packets(static_cast<size_t>(initial_packets.cols()));
 }
-void SchodingerEquation::evolve()
+template<typename Scalar>
+void SchodingerEquation<Scalar>::init_packets(size_t packets)
 {
-    m_psi_temp.noalias() = m_sparse_M*m_psi;
-    m_psi = m_solver.solve(m_psi_temp);
+    m_packets     = packets;
+    m_packet_size = (Nx-2)*(Ny-2);
+    if (m_packets == 0 || static_cast<size_t>(m_psi.size()) != m_packets*m_packet_size)
+    {
+        throw std::invalid_argument("wavefunction of " + std::to_string(m_psi.size()) + " values for " + std::to_string(m_packets) + " packets of " + std::to_string(m_packet_size));
+    }
+    m_psi_backup = m_psi;
+    m_observables.resize(m_packets);
+    m_initial_norm.resize(m_packets);
+    m_observables_stale.assign(m_packets, true);
+    m_observed_windows.assign(m_packets, ActiveWindow{.width = Nx-2, .height = Ny-2});
+    for (size_t packet = 0; packet < m_packets; packet++)
+    {
+        m_initial_norm[packet] = get_packet(packet).template cast<std::complex<double>>().squaredNorm();
+        m_observables[packet].modulus.resize(m_packet_size);
+    }
 }
-void SchodingerEquation::interact(const Interferometer& double_slit)
+template<typename Scalar>
+auto SchodingerEquation<Scalar>::get_window(size_t packet) const -> ActiveWindow
 {
-    double_slit.activate_interaction(m_psi);
+    return m_stepper->get_active_window(packet).value_or(ActiveWindow{.width = Nx-2, .height = Ny-2});
 }
-float SchodingerEquation::get_max_amplitude() const
+
+
+template<typename Scalar>
+auto SchodingerEquation<Scalar>::observe(size_t packet) -> const Observables&
 {
-    float vmax{-1};
-    float value{};
-    for (size_t k = 0; k < (size_t)m_psi.size(); k++)
+    Observables& observables = m_observables[packet];
+    if (!m_observables_stale[packet])
+        return observables;
+    PROFILE_SCOPE(PHASE::OBSERVABLES);
+
+    // One read of psi (viewed as interleaved re, im reals) gives |psi|, the max and the norm.
+    // Not std::abs: its overflow-safe hypot is several times slower than the square root of the squared norm.
+    // The norm is summed in the precision of psi within a column and in double across columns, to keep its drift meaningful
+    // without paying for a double conversion per cell. |psi| is handed to the renderer as float either way.
+    // psi is zero outside the stepper's active window: only the window is swept, after clearing the modulus of the last one.
+    using Real = Real<Scalar>;
+    const Eigen::Index rows   = Ny-2;
+    const ActiveWindow window = get_window(packet);
+    ActiveWindow& observed    = m_observed_windows[packet];
+    const Real* raw           = reinterpret_cast<const Real*>(m_psi.data() + packet*m_packet_size);
+    float* modulus            = observables.modulus.data();
+    float vmax{};
+    double norm{};
+
+    if (window.get_cells() != m_packet_size)
+    {
+        for (size_t jx = observed.x0; jx < observed.x0 + observed.width; jx++)
+        {
+            std::fill_n(modulus + jx*rows + observed.y0, observed.height, 0.f);
+        }
+    }
+    observed = window;
+
+    const Eigen::Index x0 = window.x0;
+    const Eigen::Index x1 = window.x0 + window.width;
+    #pragma omp parallel for schedule(static) reduction(max:vmax) reduction(+:norm)
+    for (Eigen::Index jx = x0; jx < x1; jx++)
     {
-        value = get_wf_modulus(k);
-        if (value > vmax)
+        const Eigen::Index begin = jx*rows + window.y0;
+        const Eigen::Index end   = begin + window.height;
+        float column_max{};
+        Real column_norm{};
+        for (Eigen::Index k = begin; k < end; k++)
         {
-            vmax = value;
+            const Real re = raw[2*k];
+            const Real im = raw[2*k+1];
+            const Real n2 = re*re + im*im;
+            modulus[k]  = static_cast<float>(std::sqrt(n2));
+            column_max  = std::max(column_max, modulus[k]);
+            column_norm += n2;
         }
+        vmax  = std::max(vmax, column_max);
+        norm += column_norm;
     }
-    return vmax;
+
+    const double initial_norm = m_initial_norm[packet];
+    observables.max_modulus   = vmax;
+    observables.norm          = norm;
+    observables.norm_drift    = (initial_norm > 0)? std::abs(norm - initial_norm)/initial_norm : 0.0;
+    m_observables_stale[packet] = false;
+    if (packet == 0)
+        PROFILE_NORM_DRIFT(observables.norm_drift);
+    return observables;
 }
-void SchodingerEquation::reset()
+template<typename Scalar>
+void SchodingerEquation<Scalar>::mark_stale()
+{
+    m_observables_stale.assign(m_packets, true);
+}
+template<typename Scalar>
+void SchodingerEquation<Scalar>::evolve()
+{
+    PROFILE_SCOPE(PHASE::EVOLVE);
+    if (m_packets == 1)
+        m_stepper->step(m_psi);
+    else
+        m_stepper->step_batch(Eigen::Map<MatrixX<Scalar>>(m_psi.data(), m_packet_size, m_packets));
+    m_observables_stale.assign(m_packets, true);
+    PROFILE_COUNT(COUNTER::STEPS, 1);
+#ifdef DOUBLE_SLIT_PROFILING
+    for (size_t packet = 0; packet < m_packets; packet++)
+        PROFILE_COUNT(COUNTER::ACTIVE_CELLS, get_window(packet).get_cells());
+#endif
+    PROFILE_COUNT(COUNTER::SOLVER_ITERATIONS, m_stepper->get_iterations());
+}
+template<typename Scalar>
+void SchodingerEquation<Scalar>::interact(const Interferometer& double_slit)
+{
+    if (m_stepper->eliminates_obstacle())
+        return;
+    PROFILE_SCOPE(PHASE::INTERACT);
+    double_slit.activate_interaction(m_psi);
+    m_observables_stale.assign(m_packets, true);
+}
+template<typename Scalar>
+float SchodingerEquation<Scalar>::get_max_amplitude()
+{
+    return observe().max_modulus;
+}
+template<typename Scalar>
+size_t SchodingerEquation<Scalar>::get_solver_iterations() const
+{
+    return m_stepper->get_iterations();
+}
+template<typename Scalar>
+void SchodingerEquation<Scalar>::set_stepper(std::unique_ptr<ITimeStepper<Scalar>> stepper)
+{
+    m_stepper = std::move(stepper);
+    m_observables_stale.assign(m_packets, true);
+}
+template<typename Scalar>
+void SchodingerEquation<Scalar>::reset()
 {
     m_psi = m_psi_backup;
-}
\ No newline at end of file
+    m_stepper->restart();
+    m_observables_stale.assign(m_packets, true);
+}
+template<typename Scalar>
+void SchodingerEquation<Scalar>::restore(const VectorX<Scalar>& psi, std::span<const StepperPacketState> stepper_state)
+{
+    if (psi.size() != m_psi.size())
+    {
+        throw std::invalid_argument("wavefunction of " + std::to_string(psi.size()) + " values for " + std::to_string(m_packets) + " packets of " + std::to_string(m_packet_size));
+    }
+    m_psi = psi;
+    m_stepper->restart();
+    m_stepper->restore_state(stepper_state);
+    m_observables_stale.assign(m_packets, true);
+}
+
+template class SchodingerEquation<std::complex<float>>;
+template class SchodingerEquation<std::complex<double>>;
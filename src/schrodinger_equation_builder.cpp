@@ -3,71 +3,356 @@
 // #include "raylib.h"
 // #include "Eigen/SparseLU"
 #include "schrodinger_equation_builder.hpp"
+#include "crank_nicolson_stepper.hpp"
+#include "adi_stepper.hpp"
+#include "split_operator_stepper.hpp"
+#include "operator_cache.hpp"
+#include "profiler.hpp"
+#include <chrono>
+#include <stdexcept>
+#include <filesystem>
 // #include "schrodinger_equation.hpp"
 // #include "crank_nicolson_builder.hpp"
 // #include "schrodinger_equation_builder.hpp"
 
-constexpr float SIGMA_DEVIATION = 0.2f;
-constexpr std::complex<float> imaginary_unit{0, 1}; 
 
-SchodingerEquationBuilder::SchodingerEquationBuilder(const Vector2& L, const Vector2& dr, const Vector2& init_pos,
-                                                    std::unique_ptr<IMatrixBuilder> matrix_builder, 
-                                                    std::unique_ptr<IWaveFunctionBuilder> wf_builder)
+template<typename Scalar>
+SchodingerEquationBuilder<Scalar>::SchodingerEquationBuilder(const Vec2f& L, const Vec2f& dr, const Vec2f& init_pos,
+                                                    std::unique_ptr<IMatrixBuilder<Scalar>> matrix_builder, 
+                                                    std::unique_ptr<IWaveFunctionBuilder<Scalar>> wf_builder)
 
-    : m_initial_pos{init_pos}, m_Lx{L.x}, m_Ly{L.y}, m_Nx{get_num_elements(0, L.x, dr.x)}, m_Ny{get_num_elements(0, L.y, dr.y)}
+    : m_initial_pos{init_pos}, m_dx{dr.x}, m_dy{dr.y}, m_Lx{L.x}, m_Ly{L.y}, m_Nx{get_num_elements(0, L.x, dr.x)}, m_Ny{get_num_elements(0, L.y, dr.y)}
       ,m_sparse_mat_buidler{std::move(matrix_builder)}, m_wf_builder{std::move(wf_builder)}
 {
-    float dx = dr.x;
-    float dy = dr.y;
-    float dt = (dx*dx)/4.f;
-    m_rx = - dt / ( 2.f*imaginary_unit*(dx*dx));
-    m_ry = - dt / ( 2.f*imaginary_unit*(dy*dy));
-    m_a0 = (1.0f + 2.0f*m_rx + 2.0f*m_ry);
-    m_b0 = (1.0f - 2.0f*m_rx - 2.0f*m_ry);
+    using Real = Real<Scalar>;
+    Real dx = dr.x;
+    init_coefficients((dx*dx)/Real(4));
+}
+template<typename Scalar>
+void SchodingerEquationBuilder<Scalar>::init_coefficients(Real<Scalar> dt)
+{
+    // coefficients in the precision of the run: in double, rx and ry keep the digits a float dt would round off
+    using Real = Real<Scalar>;
+    const Scalar imaginary_unit{0, 1};
+    Real dx = m_dx;
+    Real dy = m_dy;
+    m_dt = static_cast<float>(dt);
+    m_exact_dt = dt;
+    m_rx = - dt / ( Real(2)*imaginary_unit*(dx*dx));
+    m_ry = - dt / ( Real(2)*imaginary_unit*(dy*dy));
+    m_a0 = (Real(1) + Real(2)*m_rx + Real(2)*m_ry);
+    m_b0 = (Real(1) - Real(2)*m_rx - Real(2)*m_ry);
 }
 
-void SchodingerEquationBuilder::init_wave_function()
+template<typename Scalar>
+auto SchodingerEquationBuilder<Scalar>::build_packet(const WavePacket& packet) -> VectorX<Scalar>
 {
-    float x0 = m_initial_pos.x;
-    float y0 = m_initial_pos.y;
     try 
     {
         m_wf_builder->set_system_size(m_Lx, m_Ly);
-        m_wf_builder->set_initial_pos(x0, y0);
-        m_wf_builder->set_deviation(SIGMA_DEVIATION);
-        auto psi_temp = m_wf_builder->build_wavefunction(m_Ny, m_Nx);
-        m_psi         = std::move(psi_temp);
-        std::println("Wavefunction allocated: size: {}byes.",  get_size(m_psi));
-
+        m_wf_builder->set_initial_pos(packet.position.x, packet.position.y);
+        m_wf_builder->set_deviation(packet.sigma);
+        m_wf_builder->set_wave_number(packet.wave_number);
+        auto psi = m_wf_builder->build_wavefunction(m_Ny, m_Nx);
+        std::println("Wavefunction allocated: size: {}byes.",  get_size(psi));
+        PROFILE_COUNT(COUNTER::BYTES_ALLOCATED, get_size(psi));
+        if (m_obstacle)
+        {
+            m_obstacle->apply(psi);     // the eliminated cells start at zero and are never touched again
+        }
+        return psi;
     }
     catch(const std::exception& e)
     {
-        std::println("Wavefunction allocation failure: {}", e.what());
-        exit(EXIT_FAILURE);
+        throw std::runtime_error(std::string("wavefunction allocation failure: ") + e.what());
+    }
+}
+template<typename Scalar>
+void SchodingerEquationBuilder<Scalar>::set_engine(ENGINE engine)
+{
+    m_engine = engine;
+}
+template<typename Scalar>
+void SchodingerEquationBuilder<Scalar>::set_solver_options(const SolverOptions& options)
+{
+    m_solver_options = options;
+}
+template<typename Scalar>
+void SchodingerEquationBuilder<Scalar>::set_obstacle(const ObstacleMask& obstacle)
+{
+    m_obstacle = obstacle;
+}
+template<typename Scalar>
+void SchodingerEquationBuilder<Scalar>::set_operator_cache(const std::string& directory)
+{
+    m_cache_directory = directory;
+}
+template<typename Scalar>
+void SchodingerEquationBuilder<Scalar>::set_operator_pool(std::shared_ptr<OperatorPool<Scalar>> pool)
+{
+    m_operator_pool = std::move(pool);
+}
+template<typename Scalar>
+void SchodingerEquationBuilder<Scalar>::set_wave_number(float k)
+{
+    m_wave_number = k;
+}
+template<typename Scalar>
+void SchodingerEquationBuilder<Scalar>::set_time_step(float dt)
+{
+    if (!(dt > 0.f))
+    {
+        throw std::invalid_argument("time step " + std::to_string(dt) + " is not greater than 0");
     }
+    init_coefficients(dt);
 }
-auto SchodingerEquationBuilder::build_equation() -> SchodingerEquation
+template<typename Scalar>
+void SchodingerEquationBuilder<Scalar>::set_absorbing_layer(const AbsorbingLayer& layer)
 {
-    init_wave_function();
+    m_absorbing_layer = layer;
+}
+template<typename Scalar>
+void SchodingerEquationBuilder<Scalar>::set_activity(const ActivityOptions& activity)
+{
+    m_activity = activity;
+}
+template<typename Scalar>
+void SchodingerEquationBuilder<Scalar>::retime(SchodingerEquation<Scalar>& equation, float dt)
+{
+    // A keeps its pattern whatever dt: the Crank-Nicolson solver is refactorized over its symbolic analysis.
+    // The other engines have no setup worth keeping and are rebuilt, carrying over what their stepper derived from
+    // the initial psi (ADI active windows and their cutoff, the norm dropped so far): found again from the current psi,
+    // it would change the trajectory and forget what was discarded.
+    if (m_engine != ENGINE::CRANK_NICOLSON)
+    {
+        const std::vector<StepperPacketState> state = equation.get_stepper().save_state();
+        set_time_step(dt);
+        equation.set_stepper(build_stepper());
+        equation.get_stepper().restore_state(state);
+        return;
+    }
+    auto* stepper = dynamic_cast<CrankNicolsonStepper<Scalar>*>(&equation.get_stepper());
+    if (!stepper)
+    {
+        throw std::invalid_argument("the equation is not stepped by Crank-Nicolson, it cannot be refactorized");
+    }
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    set_time_step(dt);
     init_sparse_matrices();
-    return SchodingerEquation(m_Nx, m_Ny, (m_sparse_A), std::move(m_sparse_M), std::move(m_psi) );
+    stepper->refactorize(m_sparse_A, make_stencil());
+    std::println("Time step {}: refactorized in {:.1f}ms.", m_dt, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
 }
-void SchodingerEquationBuilder::init_sparse_matrices()
+template<typename Scalar>
+auto SchodingerEquationBuilder<Scalar>::build_equation() -> SchodingerEquation<Scalar>
 {
+    VectorX<Scalar> psi = build_packet(WavePacket{.position = m_initial_pos, .wave_number = m_wave_number});
     try
     {
+        return SchodingerEquation<Scalar>(m_Nx, m_Ny, build_stepper(), std::move(psi) );
+    }
+    catch(const std::exception& e)
+    {
+        throw std::runtime_error(std::string("time stepper initialization failure: ") + e.what());
+    }
+}
+template<typename Scalar>
+auto SchodingerEquationBuilder<Scalar>::build_batch(std::span<const WavePacket> packets) -> SchodingerEquation<Scalar>
+{
+    MatrixX<Scalar> psi((m_Nx-2)*(m_Ny-2), packets.size());
+    for (size_t k = 0; k < packets.size(); k++)
+    {
+        psi.col(k) = build_packet(packets[k]);
+    }
+    try
+    {
+        return SchodingerEquation<Scalar>(m_Nx, m_Ny, build_stepper(), psi);
+    }
+    catch(const std::exception& e)
+    {
+        throw std::runtime_error(std::string("time stepper initialization failure: ") + e.what());
+    }
+}
+template<typename Scalar>
+auto SchodingerEquationBuilder<Scalar>::build_stepper() -> std::unique_ptr<ITimeStepper<Scalar>>
+{
+    switch (m_engine)
+    {
+    case ENGINE::ADI:
+        std::println("Engine: ADI (Peaceman-Rachford), matrix free, {} precision.", get_precision_name<Scalar>());
+        if (m_obstacle)
+        {
+            throw std::invalid_argument("obstacle elimination needs the Crank-Nicolson engine");
+        }
+        if (m_absorbing_layer.is_enabled())
+        {
+            throw std::invalid_argument("the absorbing layer needs the Crank-Nicolson or the split-operator engine");
+        }
+        if (m_activity.is_enabled())
+        {
+            std::println("Active windows: threshold {}, margin {} cells.", m_activity.threshold, m_activity.margin);
+        }
+        return std::make_unique<AdiStepper<Scalar>>(m_Nx, m_Ny, m_rx, m_ry, m_activity);
+    case ENGINE::SPLIT_OPERATOR:
+        std::println("Engine: split operator (sine transform by FFT), dt = {}, {} precision.", m_dt, get_precision_name<Scalar>());
+        if (m_obstacle)
+        {
+            throw std::invalid_argument("obstacle elimination needs the Crank-Nicolson engine");
+        }
+        if (m_activity.is_enabled())
+        {
+            throw std::invalid_argument("active windows need the ADI engine");
+        }
+    {
+        auto stepper = std::make_unique<SplitOperatorStepper<Scalar>>(m_Nx, m_Ny, m_dx, m_dy, m_exact_dt);
+        if (m_absorbing_layer.is_enabled())
+        {
+            stepper->set_absorption(m_absorbing_layer.get_potential<Scalar>(m_Nx, m_Ny), m_exact_dt);
+        }
+        return stepper;
+    }
+    case ENGINE::CRANK_NICOLSON:
+    default:
+    {
+        std::println("Engine: Crank-Nicolson, {} precision.", get_precision_name<Scalar>());
+        if (m_activity.is_enabled())
+        {
+            throw std::invalid_argument("active windows need the ADI engine");
+        }
+        std::optional<FreeCellMap> free_cells{};
+        if (m_obstacle)
+        {
+            free_cells.emplace((m_Nx-2)*(m_Ny-2), *m_obstacle);
+            m_sparse_mat_buidler->set_free_cells(*free_cells);
+            std::println("Obstacle eliminated: {} of {} unknowns left.", free_cells->size(), free_cells->get_full_size());
+        }
+        auto setup = [this]
+        {
+            auto solver = make_linear_solver<Scalar>(m_solver_options);
+            prepare_solver(*solver);
+            return solver;
+        };
+        auto solver = m_operator_pool? m_operator_pool->acquire(get_cache_key(), setup) : setup();
+        if (m_absorbing_layer.is_enabled())
+        {
+            std::println("Absorbing layer: {} cells, strength {}.", m_absorbing_layer.thickness, m_absorbing_layer.strength);
+        }
+        return std::make_unique<CrankNicolsonStepper<Scalar>>(make_stencil(), std::move(solver), std::move(free_cells));
+    }
+    }
+}
+template<typename Scalar>
+void SchodingerEquationBuilder<Scalar>::prepare_solver(ILinearSolver<Scalar>& solver)
+{
+    if (m_cache_directory.empty())
+    {
+        init_sparse_matrices();
+        PROFILE_SCOPE(PHASE::FACTORIZATION);
+        solver.compute(m_sparse_A);
+        return;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    auto elapsed_ms = [start = Clock::now()]{ return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+    const uint64_t key = get_cache_key();
+    const std::string path = get_operator_cache_path(m_cache_directory, key);
+    if (std::filesystem::exists(path))
+    {
+        try
+        {
+            OperatorCacheEntry entry{path};
+            if (entry.is_compatible(key))
+            {
+                m_sparse_A = entry.get_matrix<Scalar>();
+                PROFILE_SCOPE(PHASE::FACTORIZATION);
+                const bool restored = solver.load(m_sparse_A, entry);
+                if (!restored)
+                    solver.compute(m_sparse_A);
+                std::println("Operator cache hit: {} in {:.1f}ms ({}).", restored? "matrix and factorization loaded" : "matrix loaded, solver set up", elapsed_ms(), path);
+                return;
+            }
+        }
+        catch(const std::exception& e)
+        {
+            std::println("Operator cache entry ignored: {}", e.what());
+        }
+    }
+
+    init_sparse_matrices();
+    {
+        PROFILE_SCOPE(PHASE::FACTORIZATION);
+        solver.compute(m_sparse_A);
+    }
+    std::println("Operator cache miss: assembly and solver setup in {:.1f}ms.", elapsed_ms());
+    try
+    {
+        OperatorCacheWriter writer{};
+        writer.add_matrix(m_sparse_A);
+        solver.save(writer);
+        writer.write(path, key);
+        std::println("Operator cache written: {}.", path);
+    }
+    catch(const std::exception& e)
+    {
+        std::println("Operator cache not written: {}", e.what());
+    }
+}
+template<typename Scalar>
+auto SchodingerEquationBuilder<Scalar>::get_cache_key() const -> uint64_t
+{
+    CacheKey key{};
+    key.add(OPERATOR_CACHE_VERSION).add(sizeof(Scalar)).add(m_Nx).add(m_Ny).add(m_dt).add(m_a0).add(m_b0).add(m_rx).add(m_ry)
+       .add(m_solver_options.solver).add(m_solver_options.preconditioner).add(m_solver_options.tolerance).add(m_solver_options.max_iterations)
+       .add(m_solver_options.ordering);
+    if (m_obstacle)
+    {
+        key.add_all(m_obstacle->get_psi_spans());
+    }
+    if (m_absorbing_layer.is_enabled())
+    {
+        key.add(m_absorbing_layer.thickness).add(m_absorbing_layer.strength);
+    }
+    return key.get();
+}
+template<typename Scalar>
+auto SchodingerEquationBuilder<Scalar>::make_stencil() const -> StencilOperator<Scalar>
+{
+    StencilOperator<Scalar> stencil_M{m_Nx, m_Ny, m_b0, m_rx, m_ry};
+    if (m_absorbing_layer.is_enabled())
+    {
+        stencil_M.set_absorption(get_absorption(), m_absorbing_layer.thickness);
+    }
+    return stencil_M;
+}
+template<typename Scalar>
+auto SchodingerEquationBuilder<Scalar>::get_absorption() const -> VectorX<Scalar>
+{
+    return (m_exact_dt/Real<Scalar>(2))*m_absorbing_layer.get_potential<Scalar>(m_Nx, m_Ny);
+}
+template<typename Scalar>
+void SchodingerEquationBuilder<Scalar>::init_sparse_matrices()
+{
+    try
+    {
+        PROFILE_SCOPE(PHASE::ASSEMBLY);
         m_sparse_mat_buidler->set_num_elements(m_Nx, m_Ny);
         m_sparse_mat_buidler->set_diagonal_elements(m_a0, m_b0);
         m_sparse_mat_buidler->set_off_diag_elements(m_rx, m_ry);
-        auto[sparse_A, sparse_M] = m_sparse_mat_buidler->get_sparse_matrices();
-
+        if (m_absorbing_layer.is_enabled())
+        {
+            m_sparse_mat_buidler->set_absorption(get_absorption());
+        }
+        // M is applied matrix free by the StencilOperator: only A is assembled, for the factorization
+        auto sparse_A = m_sparse_mat_buidler->get_sparse_A();
         std::println("Sparse matrix allocated: {}bytes.", get_size(sparse_A) );  
-        m_sparse_A = std::move(sparse_A);                            
-        m_sparse_M = std::move(sparse_M);
+        PROFILE_COUNT(COUNTER::BYTES_ALLOCATED, get_size(sparse_A));
+        m_sparse_A = std::move(sparse_A);
     }
     catch(const std::exception& e)
     {
-        std::println("Sparse-Matrix allocation failure: {}", e.what());
-        exit(EXIT_FAILURE);
+        throw std::runtime_error(std::string("sparse matrix allocation failure: ") + e.what());
     }
-}
\ No newline at end of file
+}
+
+template class SchodingerEquationBuilder<std::complex<float>>;
+template class SchodingerEquationBuilder<std::complex<double>>;
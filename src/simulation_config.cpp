@@ -0,0 +1,405 @@
+#include "simulation_config.hpp"
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+namespace
+{
+    auto trim(const std::string& str) -> std::string
+    {
+        const char* blanks = " \t\r";
+        size_t first = str.find_first_not_of(blanks);
+        if (first == std::string::npos)
+            return {};
+        return str.substr(first, str.find_last_not_of(blanks) - first + 1);
+    }
+    // The whole value or an error: "1.2abc", "3x" or a negative size are rejected, not cut short or wrapped around
+    auto to_float(const std::string& key, const std::string& value) -> float
+    {
+        float number{};
+        const char* end = value.data() + value.size();
+        auto [last, error] = std::from_chars(value.data(), end, number);
+        if (error != std::errc{} || last != end || !std::isfinite(number))
+        {
+            throw std::invalid_argument("'" + key + "' expects a number, got '" + value + "'");
+        }
+        return number;
+    }
+    auto to_positive_float(const std::string& key, const std::string& value) -> float
+    {
+        float number = to_float(key, value);
+        if (number <= 0.f)
+        {
+            throw std::invalid_argument("'" + key + "' expects a number greater than 0, got '" + value + "'");
+        }
+        return number;
+    }
+    auto to_size(const std::string& key, const std::string& value) -> size_t
+    {
+        size_t number{};
+        const char* end = value.data() + value.size();
+        auto [last, error] = std::from_chars(value.data(), end, number);
+        if (error != std::errc{} || last != end)
+        {
+            throw std::invalid_argument("'" + key + "' expects a non-negative integer, got '" + value + "'");
+        }
+        return number;
+    }
+    auto to_bool(const std::string& key, const std::string& value) -> bool
+    {
+        if (value == "true"  || value == "on"  || value == "1") return true;
+        if (value == "false" || value == "off" || value == "0") return false;
+        throw std::invalid_argument("'" + key + "' expects true or false, got '" + value + "'");
+    }
+    auto split(const std::string& value, char separator) -> std::vector<std::string>
+    {
+        std::vector<std::string> items{};
+        size_t begin = 0;
+        while (begin <= value.size())
+        {
+            size_t end = std::min(value.find(separator, begin), value.size());
+            items.push_back(trim(value.substr(begin, end - begin)));
+            begin = end + 1;
+        }
+        return items;
+    }
+    auto to_float_list(const std::string& key, const std::string& value) -> std::vector<float>
+    {
+        std::vector<float> list{};
+        for (const auto& item : split(value, ','))
+            list.push_back(to_float(key, item));
+        return list;
+    }
+    auto to_size_list(const std::string& key, const std::string& value) -> std::vector<size_t>
+    {
+        std::vector<size_t> list{};
+        for (const auto& item : split(value, ','))
+            list.push_back(to_size(key, item));
+        return list;
+    }
+    auto to_region_list(const std::string& key, const std::string& value) -> std::vector<DetectorRegion>
+    {
+        std::vector<DetectorRegion> list{};
+        for (const auto& item : split(value, ','))
+        {
+            auto bounds = split(item, ':');
+            if (bounds.size() != 4)
+            {
+                throw std::invalid_argument("'" + key + "' expects x0:y0:width:height rectangles, got '" + item + "'");
+            }
+            list.push_back({to_size(key, bounds[0]), to_size(key, bounds[1]), to_size(key, bounds[2]), to_size(key, bounds[3])});
+        }
+        return list;
+    }
+}
+
+auto SimulationConfig::initial_pos() const -> Vec2f
+{
+    return {.x = x0.value_or(L.x/5.f), .y = y0.value_or(L.y/2.f)};
+}
+void SimulationConfig::set_option(const std::string& key, const std::string& value)
+{
+    if      (key == "Lx")               L.x = to_positive_float(key, value);
+    else if (key == "Ly")               L.y = to_positive_float(key, value);
+    else if (key == "dr")               dr  = {.x = to_positive_float(key, value), .y = to_positive_float(key, value)};
+    else if (key == "dx")               dr.x = to_positive_float(key, value);
+    else if (key == "dy")               dr.y = to_positive_float(key, value);
+    else if (key == "x0")               x0 = to_float(key, value);
+    else if (key == "y0")               y0 = to_float(key, value);
+    else if (key == "wave_number")      wave_number = to_float(key, value);
+    else if (key == "wave_numbers")     wave_numbers = to_float_list(key, value);
+    else if (key == "slit_thickness")   slit_thickness = to_float(key, value);
+    else if (key == "slit_width")       slit_width     = to_float(key, value);
+    else if (key == "slit_opening")     slit_opening   = to_float(key, value);
+    else if (key == "obstacle")         obstacle_path  = value;
+    else if (key == "eliminate_obstacle") eliminate_obstacle = to_bool(key, value);
+    else if (key == "absorbing_layer")    absorbing_layer.thickness = to_size(key, value);
+    else if (key == "absorbing_strength") absorbing_layer.strength  = to_float(key, value);
+    else if (key == "active_threshold")   activity.threshold = to_float(key, value);
+    else if (key == "active_margin")      activity.margin    = to_size(key, value);
+    else if (key == "steps")            steps = to_size(key, value);
+    else if (key == "dt")               dt    = to_positive_float(key, value);
+    else if (key == "tolerance")        solver_options.tolerance      = to_float(key, value);
+    else if (key == "max_iterations")   solver_options.max_iterations = to_size(key, value);
+    else if (key == "engine")
+    {
+        if      (value == "cn")  engine = ENGINE::CRANK_NICOLSON;
+        else if (value == "adi") engine = ENGINE::ADI;
+        else if (value == "fft") engine = ENGINE::SPLIT_OPERATOR;
+        else throw std::invalid_argument("unknown engine '" + value + "' (cn, adi, fft)");
+    }
+    else if (key == "precision")
+    {
+        if      (value == "single" || value == "float")  precision = PRECISION::SINGLE;
+        else if (value == "double")                      precision = PRECISION::DOUBLE;
+        else throw std::invalid_argument("unknown precision '" + value + "' (single, double)");
+    }
+    else if (key == "solver")
+    {
+        if      (value == "lu")       solver_options.solver = SOLVER::SPARSE_LU;
+        else if (value == "bicgstab") solver_options.solver = SOLVER::BICGSTAB;
+        else if (value == "cocg")     solver_options.solver = SOLVER::COCG;
+        else throw std::invalid_argument("unknown solver '" + value + "' (lu, bicgstab, cocg)");
+    }
+    else if (key == "ordering")
+    {
+        if      (value == "colamd")  solver_options.ordering = ORDERING::COLAMD;
+        else if (value == "amd")     solver_options.ordering = ORDERING::AMD;
+        else if (value == "natural") solver_options.ordering = ORDERING::NATURAL;
+        else if (value == "nd")      solver_options.ordering = ORDERING::NESTED_DISSECTION;
+        else throw std::invalid_argument("unknown ordering '" + value + "' (colamd, amd, natural, nd)");
+    }
+    else if (key == "preconditioner")
+    {
+        if      (value == "diagonal") solver_options.preconditioner = PRECONDITIONER::DIAGONAL;
+        else if (value == "ilut")     solver_options.preconditioner = PRECONDITIONER::ILUT;
+        else throw std::invalid_argument("unknown preconditioner '" + value + "' (diagonal, ilut)");
+    }
+    else if (key == "operator_cache")   operator_cache = value;
+    else if (key == "record")           record_path   = value;
+    else if (key == "record_every")     record_every  = std::max<size_t>(to_size(key, value), 1);
+    else if (key == "steps_per_frame")  steps_per_frame = std::max<size_t>(to_size(key, value), 1);
+    else if (key == "playback")         playback_path = value;
+    else if (key == "record_format")
+    {
+        if      (value == "complex") record_format = SNAPSHOT_FORMAT::COMPLEX_FLOAT32;
+        else if (value == "float")   record_format = SNAPSHOT_FORMAT::MODULUS_FLOAT32;
+        else if (value == "half")    record_format = SNAPSHOT_FORMAT::MODULUS_FLOAT16;
+        else if (value == "u8")      record_format = SNAPSHOT_FORMAT::MODULUS_UINT8;
+        else throw std::invalid_argument("unknown record format '" + value + "' (complex, float, half, u8)");
+    }
+    else if (key == "export")           export_options.path  = value;
+    else if (key == "export_every")     export_options.every = std::max<size_t>(to_size(key, value), 1);
+    else if (key == "export_fps")       export_options.fps   = std::max<size_t>(to_size(key, value), 1);
+    else if (key == "export_queue")     export_options.queue_depth = std::max<size_t>(to_size(key, value), 1);
+    else if (key == "export_size")
+    {
+        auto size = split(value, 'x');
+        if (size.size() != 2)
+        {
+            throw std::invalid_argument("'" + key + "' expects widthxheight, got '" + value + "'");
+        }
+        export_options.width  = to_size(key, size[0]);
+        export_options.height = to_size(key, size[1]);
+    }
+    else if (key == "export_colormap")
+    {
+        if      (value == "viewer") export_options.colormap = COLORMAP::VIEWER;
+        else if (value == "gray")   export_options.colormap = COLORMAP::GRAYSCALE;
+        else if (value == "heat")   export_options.colormap = COLORMAP::HEAT;
+        else throw std::invalid_argument("unknown colormap '" + value + "' (viewer, gray, heat)");
+    }
+    else if (key == "export_policy")
+    {
+        if      (value == "block") export_options.policy = EXPORT_POLICY::BLOCK;
+        else if (value == "drop")  export_options.policy = EXPORT_POLICY::DROP;
+        else throw std::invalid_argument("unknown export policy '" + value + "' (block, drop)");
+    }
+    else if (key == "checkpoint")       checkpoint_path = value;
+    else if (key == "checkpoint_interval") checkpoint_interval = std::max(to_float(key, value), 0.f);
+    else if (key == "resume")           resume_path = value;
+    else if (key == "detector_columns") detector_columns = to_size_list(key, value);
+    else if (key == "detector_regions") detector_regions = to_region_list(key, value);
+    else if (key == "detector_current") detector_current = to_bool(key, value);
+    else if (key == "detector_output")  detector_output  = value;
+    else if (key == "detector_every")   detector_every   = to_size(key, value);
+    else if (key == "profile")          profile_path = value;
+    else if (key == "trace")            trace_path   = value;
+    else if (key == "config")           load_file(value);
+    else throw std::invalid_argument("unknown option '" + key + "'");
+}
+void SimulationConfig::load_file(const std::string& path)
+{
+    std::ifstream file{path};
+    if (!file)
+    {
+        throw std::invalid_argument("cannot open config file '" + path + "'");
+    }
+    std::string line{};
+    while (std::getline(file, line))
+    {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty())
+            continue;
+
+        size_t equal = line.find('=');
+        if (equal == std::string::npos)
+        {
+            throw std::invalid_argument("'" + line + "' in '" + path + "' is not a 'key = value' pair");
+        }
+        set_option(trim(line.substr(0, equal)), trim(line.substr(equal + 1)));
+    }
+}
+
+auto parse_arguments(int argc, char* argv[]) -> SimulationConfig
+{
+    SimulationConfig config{};
+    for (int i = 1; i < argc; i += 2)
+    {
+        std::string key{argv[i]};
+        if (!key.starts_with("--") || i + 1 >= argc)
+        {
+            throw std::invalid_argument("expected '--key value' pairs, got '" + key + "'");
+        }
+        config.set_option(key.substr(2), argv[i+1]);
+    }
+    return config;
+}
+auto build_interferometer(const SimulationConfig& config, size_t Nx, size_t Ny) -> Interferometer
+{
+    if (config.obstacle)
+    {
+        // the barrier of a resumed run, whatever its geometry: an obstacle given again must be that one
+        if (!config.obstacle_path.empty() && get_obstacle_key(load_obstacle_mask(config.obstacle_path, Nx, Ny)) != get_obstacle_key(*config.obstacle))
+        {
+            throw std::invalid_argument("'" + config.resume_path + "' was taken with another obstacle than '" + config.obstacle_path + "'");
+        }
+        Interferometer obstacle{Nx, Ny};
+        obstacle.set_mask(*config.obstacle);
+        return obstacle;
+    }
+    if (!config.obstacle_path.empty())
+    {
+        Interferometer obstacle{Nx, Ny};
+        obstacle.set_mask(load_obstacle_mask(config.obstacle_path, Nx, Ny));
+        return obstacle;
+    }
+    const size_t thickness = static_cast<size_t>(config.slit_thickness*Nx); // thickness of interfero, along the x-axixs, in pixels
+    const size_t width     = static_cast<size_t>(config.slit_width*Ny);     // size of the part between the two slits (along the y-axis)
+    const size_t opening   = static_cast<size_t>(config.slit_opening*Ny);   // size of the two slits (along the y-axis)
+    if (width/2 + opening > Ny/2)
+    {
+        throw std::invalid_argument("the slits do not fit in the domain (slit_width/2 + slit_opening > 1/2)");
+    }
+    const size_t height{Ny/2 - width/2 - opening};                           // "height" from top/bottom until the slit.
+
+    Interferometer double_slit{Nx, Ny};
+    double_slit.set_param(thickness, width, height);
+    return double_slit;
+}
+auto build_detector_screen(const SimulationConfig& config, size_t Nx, size_t Ny, float dt) -> std::unique_ptr<DetectorScreen>
+{
+    if (config.detector_columns.empty() && config.detector_regions.empty())
+        return nullptr;
+    auto screen = std::make_unique<DetectorScreen>(Nx, Ny, config.dr.x, dt, config.detector_current);
+    for (size_t x : config.detector_columns)
+        screen->add_column(x);
+    for (const auto& region : config.detector_regions)
+        screen->add_region(region);
+    return screen;
+}
+void start_profiling(const SimulationConfig& config)
+{
+#ifndef DOUBLE_SLIT_PROFILING
+    if (!config.profile_path.empty() || !config.trace_path.empty())
+    {
+        std::println("Profiling requested, but compiled out (DOUBLE_SLIT_PROFILING): the files will hold no timing.");
+    }
+#endif
+    if (!config.trace_path.empty())
+    {
+        Profiler::get().enable_trace();
+    }
+    Profiler::get().reset();
+}
+void write_profile(const SimulationConfig& config)
+{
+    try
+    {
+        if (!config.profile_path.empty())
+        {
+            Profiler::get().write_summary(config.profile_path);
+            std::println("Profile written to {}.", config.profile_path);
+        }
+        if (!config.trace_path.empty())
+        {
+            Profiler::get().write_trace(config.trace_path);
+            std::println("Trace written to {} ({} events dropped).", config.trace_path, Profiler::get().get_trace_dropped());
+        }
+    }
+    catch(const std::exception& e)
+    {
+        std::println("Profile output failure: {}", e.what());
+    }
+}
+auto make_snapshot_header(const SimulationConfig& config, const Interferometer& double_slit, float dt) -> SnapshotHeader
+{
+    SnapshotHeader header{};
+    header.format          = config.record_format;
+    header.Nx              = double_slit.m_Nx;
+    header.Ny              = double_slit.m_Ny;
+    header.dx              = config.dr.x;
+    header.dy              = config.dr.y;
+    header.dt              = dt;
+    header.steps_per_frame = static_cast<uint32_t>(config.record_every);
+    header.slit_thickness  = double_slit.m_thickness;
+    header.slit_width      = double_slit.m_width;
+    header.slit_height     = double_slit.m_height;
+    return header;
+}
+auto make_checkpoint_header(const SimulationConfig& config, const Interferometer& double_slit, size_t packets) -> CheckpointHeader
+{
+    CheckpointHeader header{};
+    header.scalar_bytes        = (config.precision == PRECISION::DOUBLE)? sizeof(std::complex<double>) : sizeof(std::complex<float>);
+    header.Nx                  = double_slit.m_Nx;
+    header.Ny                  = double_slit.m_Ny;
+    header.packets             = packets;
+    header.Lx                  = config.L.x;
+    header.Ly                  = config.L.y;
+    header.dx                  = config.dr.x;
+    header.dy                  = config.dr.y;
+    header.dt                  = config.dt;
+    header.x0                  = config.initial_pos().x;
+    header.y0                  = config.initial_pos().y;
+    header.wave_number         = config.wave_number;
+    header.slit_thickness      = config.slit_thickness;
+    header.slit_width          = config.slit_width;
+    header.slit_opening        = config.slit_opening;
+    header.engine              = static_cast<uint32_t>(config.engine);
+    header.eliminate_obstacle  = config.eliminate_obstacle;
+    header.absorbing_thickness = static_cast<uint32_t>(config.absorbing_layer.thickness);
+    header.absorbing_strength  = config.absorbing_layer.strength;
+    header.active_threshold    = config.activity.threshold;
+    header.active_margin       = static_cast<uint32_t>(config.activity.margin);
+    header.solver              = static_cast<uint32_t>(config.solver_options.solver);
+    header.preconditioner      = static_cast<uint32_t>(config.solver_options.preconditioner);
+    header.ordering            = static_cast<uint32_t>(config.solver_options.ordering);
+    header.tolerance           = config.solver_options.tolerance;
+    header.max_iterations      = static_cast<uint32_t>(config.solver_options.max_iterations);
+    header.obstacle_key        = get_obstacle_key(double_slit.get_mask());
+    return header;
+}
+void apply_checkpoint(SimulationConfig& config, const Checkpoint& checkpoint)
+{
+    const CheckpointHeader& header = checkpoint.get_header();
+    if (header.engine > static_cast<uint32_t>(ENGINE::SPLIT_OPERATOR))
+    {
+        throw std::invalid_argument("checkpoint of an unknown engine " + std::to_string(header.engine));
+    }
+    if (header.solver > static_cast<uint32_t>(SOLVER::COCG) || header.preconditioner > static_cast<uint32_t>(PRECONDITIONER::ILUT)
+        || header.ordering > static_cast<uint32_t>(ORDERING::NESTED_DISSECTION))
+    {
+        throw std::invalid_argument("checkpoint of an unknown linear solver");
+    }
+    config.precision          = (header.scalar_bytes == sizeof(std::complex<double>))? PRECISION::DOUBLE : PRECISION::SINGLE;
+    config.L                  = {.x = header.Lx, .y = header.Ly};
+    config.dr                 = {.x = header.dx, .y = header.dy};
+    config.dt                 = header.dt;
+    config.x0                 = header.x0;
+    config.y0                 = header.y0;
+    config.wave_number        = header.wave_number;
+    config.wave_numbers.assign(checkpoint.get_wave_numbers().begin(), checkpoint.get_wave_numbers().end());
+    config.slit_thickness     = header.slit_thickness;
+    config.slit_width         = header.slit_width;
+    config.slit_opening       = header.slit_opening;
+    config.obstacle           = checkpoint.get_obstacle();
+    config.engine             = static_cast<ENGINE>(header.engine);
+    config.eliminate_obstacle = header.eliminate_obstacle != 0;
+    config.absorbing_layer    = {.thickness = header.absorbing_thickness, .strength = header.absorbing_strength};
+    config.activity           = {.threshold = header.active_threshold, .margin = header.active_margin};
+    config.solver_options     = {.solver = static_cast<SOLVER>(header.solver), .preconditioner = static_cast<PRECONDITIONER>(header.preconditioner),
+                                 .ordering = static_cast<ORDERING>(header.ordering), .tolerance = header.tolerance,
+                                 .max_iterations = header.max_iterations};
+}
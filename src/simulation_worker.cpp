@@ -0,0 +1,165 @@
+#include "simulation_worker.hpp"
+#include <chrono>
+#include <algorithm>
+
+// how often the steps/s figure is refreshed
+constexpr std::chrono::milliseconds RATE_WINDOW{500};
+// sleep of a paused worker between two looks at the command queue
+constexpr std::chrono::milliseconds PAUSE_POLL{5};
+
+template<typename Scalar>
+SimulationWorker<Scalar>::SimulationWorker(SchodingerEquation<Scalar>&& equation, const Interferometer& double_slit,
+                                           std::unique_ptr<SnapshotWriter> recorder, size_t record_every,
+                                           std::unique_ptr<FrameExporter> exporter, size_t export_every,
+                                           std::unique_ptr<CheckpointWriter> checkpoints, const CheckpointClock& clock, size_t steps_per_frame,
+                                           Retimer retime, float dt)
+    : m_equation{std::move(equation)}, m_retime{std::move(retime)}, m_dt{dt}, m_double_slit{double_slit}, m_recorder{std::move(recorder)},
+      m_record_every{std::max<size_t>(record_every, 1)}, m_exporter{std::move(exporter)}, m_export_every{std::max<size_t>(export_every, 1)},
+      m_checkpoints{std::move(checkpoints)}, m_start{clock}, m_steps_per_frame{std::max<size_t>(steps_per_frame, 1)},
+      m_frames{PublishedFrame{.modulus = std::vector<float>(m_equation.get_packet(0).size())}}   // sized once, publish() only copies
+{
+    m_equation.interact(m_double_slit);
+    publish(m_start.step);
+    m_commands.push_back(COMMAND::PAUSE);
+    m_thread = std::jthread([this](std::stop_token stop){ run(stop); });
+}
+template<typename Scalar>
+SimulationWorker<Scalar>::~SimulationWorker()
+{
+    m_thread.request_stop();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+template<typename Scalar>
+void SimulationWorker<Scalar>::send(COMMAND command)
+{
+    std::lock_guard lock{m_command_mutex};
+    m_commands.push_back(command);
+}
+template<typename Scalar>
+void SimulationWorker<Scalar>::run(std::stop_token stop)
+{
+    flush_denormals();
+    using Clock = std::chrono::steady_clock;
+    bool paused{false};
+    size_t step = m_start.step;
+    double time = m_start.time;
+    size_t window_steps{};
+    auto window_start = Clock::now();
+
+    while (!stop.stop_requested())
+    {
+        {
+            std::lock_guard lock{m_command_mutex};
+            while (!m_commands.empty())
+            {
+                switch (m_commands.front())
+                {
+                case COMMAND::PAUSE:  paused = true;  break;
+                case COMMAND::RESUME: paused = false; break;
+                case COMMAND::RESET:
+                    m_equation.reset();
+                    m_equation.interact(m_double_slit);
+                    step = 0;       // back at the initial state: a checkpoint taken from here starts a new trajectory
+                    time = 0.0;
+                    publish(step);
+                    break;
+                case COMMAND::LONGER_STEP:  retime(2.f*m_dt); break;
+                case COMMAND::SHORTER_STEP: retime(m_dt/2.f); break;
+                case COMMAND::CHECKPOINT:   checkpoint({step, time}); break;
+                }
+                m_commands.pop_front();
+            }
+        }
+        if (paused)
+        {
+            m_steps_per_second.store(0.f, std::memory_order_relaxed);
+            std::this_thread::sleep_for(PAUSE_POLL);
+            window_steps = 0;
+            window_start = Clock::now();
+            continue;
+        }
+
+        m_equation.evolve();
+        m_equation.interact(m_double_slit);
+        step++;
+        time += m_dt;
+        window_steps++;
+
+        if (m_recorder && step % m_record_every == 0)
+        {
+            m_recorder->push<Scalar>(m_equation.get_packet(0), step);
+        }
+        if (m_exporter && step % m_export_every == 0)
+        {
+            m_exporter->push<Scalar>(m_equation.get_packet(0), step);
+        }
+        if (m_checkpoints && m_checkpoints->is_due())
+        {
+            checkpoint({step, time});
+        }
+        if (step % m_steps_per_frame == 0)
+        {
+            publish(step);
+        }
+
+        auto now = Clock::now();
+        if (now - window_start >= RATE_WINDOW)
+        {
+            std::chrono::duration<float> elapsed = now - window_start;
+            m_steps_per_second.store(window_steps/elapsed.count(), std::memory_order_relaxed);
+            window_steps = 0;
+            window_start = now;
+        }
+    }
+    checkpoint({step, time});
+}
+template<typename Scalar>
+void SimulationWorker<Scalar>::retime(float dt)
+{
+    if (!m_retime || m_recorder)
+        return;
+    try
+    {
+        m_retime(m_equation, dt);
+        m_dt = dt;
+        if (m_checkpoints)
+            m_checkpoints->set_time_step(dt);
+    }
+    catch(const std::exception& e)
+    {
+        std::println("Time step change failure: {}", e.what());
+    }
+}
+template<typename Scalar>
+void SimulationWorker<Scalar>::checkpoint(const CheckpointClock& clock)
+{
+    if (!m_checkpoints)
+        return;
+    try
+    {
+        m_checkpoints->save<Scalar>(m_equation.get_wavefunction(), m_equation.get_stepper_state(), clock);
+    }
+    catch(const std::exception& e)
+    {
+        std::println("Checkpoint failure: {}", e.what());
+    }
+}
+template<typename Scalar>
+void SimulationWorker<Scalar>::publish(size_t step)
+{
+    const Observables& observables = m_equation.observe();
+    PublishedFrame& frame  = m_frames.get_back();
+    frame.modulus          = observables.modulus;   // same size every time: copied without reallocation
+    frame.max_modulus      = observables.max_modulus;
+    frame.norm_drift       = observables.norm_drift;
+    frame.step             = step;
+    frame.solver_iterations = m_equation.get_solver_iterations();
+    frame.dt               = m_dt;
+    m_frames.publish();
+}
+
+template class SimulationWorker<std::complex<float>>;
+template class SimulationWorker<std::complex<double>>;
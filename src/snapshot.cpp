@@ -0,0 +1,281 @@
+#include "snapshot.hpp"
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <bit>
+#include <stdexcept>
+#include <utility>
+#include <print>
+
+auto get_payload_bytes(SNAPSHOT_FORMAT format, size_t N) -> size_t
+{
+    switch (format)
+    {
+    case SNAPSHOT_FORMAT::COMPLEX_FLOAT32: return N*sizeof(std::complex<float>);
+    case SNAPSHOT_FORMAT::MODULUS_FLOAT32: return N*sizeof(float);
+    case SNAPSHOT_FORMAT::MODULUS_FLOAT16: return N*sizeof(uint16_t);
+    case SNAPSHOT_FORMAT::MODULUS_UINT8:   return N*sizeof(uint8_t);
+    }
+    throw std::invalid_argument("unknown snapshot format");
+}
+auto float_to_half(float value) -> uint16_t
+{
+    // Round to nearest even; values beyond the half range saturate to infinity, tiny ones flush through the subnormals to zero.
+    uint32_t bits     = std::bit_cast<uint32_t>(value);
+    uint16_t sign     = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+    uint32_t abs_bits = bits & 0x7fffffffu;
+
+    if (abs_bits >= 0x7f800000u)                            // inf or nan
+        return sign | 0x7c00u | (abs_bits > 0x7f800000u? 0x200u : 0u);
+    if (abs_bits >= 0x477ff000u)                            // overflows the half range
+        return sign | 0x7c00u;
+    if (abs_bits < 0x38800000u)                             // half subnormal or zero
+    {
+        if (abs_bits < 0x33000000u)
+            return sign;
+        uint32_t mantissa = (abs_bits & 0x007fffffu) | 0x00800000u;
+        uint32_t shift    = 126u - (abs_bits >> 23);
+        uint32_t half     = mantissa >> shift;
+        uint32_t rest     = mantissa & ((1u << shift) - 1u);
+        uint32_t midpoint = 1u << (shift - 1u);
+        if (rest > midpoint || (rest == midpoint && (half & 1u)))
+            half++;
+        return sign | static_cast<uint16_t>(half);
+    }
+    uint32_t half = ((abs_bits - 0x38000000u) >> 13);
+    uint32_t rest = abs_bits & 0x1fffu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u)))
+        half++;
+    return sign | static_cast<uint16_t>(half);
+}
+auto half_to_float(uint16_t half) -> float
+{
+    uint32_t sign     = static_cast<uint32_t>(half & 0x8000u) << 16;
+    uint32_t exponent = (half >> 10) & 0x1fu;
+    uint32_t mantissa = half & 0x3ffu;
+
+    if (exponent == 0)                                      // zero or subnormal
+    {
+        float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign? -magnitude : magnitude;
+    }
+    if (exponent == 0x1f)                                   // inf or nan
+        return std::bit_cast<float>(sign | 0x7f800000u | (mantissa << 13));
+    return std::bit_cast<float>(sign | ((exponent + 112u) << 23) | (mantissa << 13));
+}
+
+
+SnapshotWriter::SnapshotWriter(const std::string& path, const SnapshotHeader& header, const ObstacleMask& barrier, size_t queue_depth)
+    : m_header{header}, m_file{path, std::ios::binary | std::ios::trunc}, m_path{path}
+{
+    if (!m_file)
+    {
+        throw std::runtime_error("cannot open snapshot file '" + path + "' for writing");
+    }
+    const size_t N = (m_header.Nx-2)*(m_header.Ny-2);
+    std::memcpy(m_header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    m_header.version     = SNAPSHOT_VERSION;
+    m_header.frame_bytes = sizeof(FrameHeader) + get_payload_bytes(m_header.format, N);
+    const auto obstacle  = barrier.get_pixel_spans();
+    m_header.obstacle_spans = obstacle.size();
+    m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(SnapshotHeader));
+    m_file.write(reinterpret_cast<const char*>(obstacle.data()), static_cast<std::streamsize>(obstacle.size_bytes()));
+
+    m_buffer.resize(m_header.frame_bytes);
+    m_queue.start(queue_depth, Frame{.psi = Eigen::VectorXcf(N)}, [this](Frame& frame){ write(frame); });
+}
+SnapshotWriter::~SnapshotWriter()
+{
+    try
+    {
+        close();
+    }
+    catch(const std::exception& e)
+    {
+        std::println("Snapshot recording failure: {}", e.what());
+    }
+}
+template<typename Scalar>
+void SnapshotWriter::push(const Eigen::Ref<const VectorX<Scalar>>& psi, uint64_t step)
+{
+    Frame* frame = m_queue.acquire();
+    frame->step  = step;
+    frame->psi   = psi.template cast<std::complex<float>>();
+    m_queue.submit(frame);
+}
+template void SnapshotWriter::push(const Eigen::Ref<const VectorX<std::complex<float>>>&, uint64_t);
+template void SnapshotWriter::push(const Eigen::Ref<const VectorX<std::complex<double>>>&, uint64_t);
+void SnapshotWriter::close()
+{
+    m_queue.close();
+    if (m_file.is_open())
+    {
+        m_file.flush();
+        if (!m_file && m_error.empty())
+        {
+            m_error = "cannot write to snapshot file '" + m_path + "'";
+        }
+        m_file.close();     // reported once: a second close() finds nothing left to flush
+    }
+    if (!m_error.empty())
+    {
+        throw std::runtime_error(std::exchange(m_error, {}));
+    }
+}
+// Writer thread: after a failed write the frames are still taken off the queue, and dropped
+void SnapshotWriter::write(const Frame& frame)
+{
+    if (!m_error.empty())
+        return;
+    encode(frame);
+    m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+    if (m_file)
+        m_frames_written++;
+    else
+        m_error = "cannot write to snapshot file '" + m_path + "'";
+}
+void SnapshotWriter::encode(const Frame& frame)
+{
+    const Eigen::VectorXcf& psi = frame.psi;
+    const Eigen::Index N = psi.size();
+
+    FrameHeader frame_header{};
+    frame_header.step        = frame.step;
+    frame_header.max_modulus = psi.cwiseAbs().maxCoeff();
+    frame_header.norm        = psi.squaredNorm();
+    std::memcpy(m_buffer.data(), &frame_header, sizeof(FrameHeader));
+
+    char* payload = m_buffer.data() + sizeof(FrameHeader);
+    switch (m_header.format)
+    {
+    case SNAPSHOT_FORMAT::COMPLEX_FLOAT32:
+        std::memcpy(payload, psi.data(), N*sizeof(std::complex<float>));
+        break;
+    case SNAPSHOT_FORMAT::MODULUS_FLOAT32:
+        for (Eigen::Index k = 0; k < N; k++)
+        {
+            float modulus = std::abs(psi(k));
+            std::memcpy(payload + k*sizeof(float), &modulus, sizeof(float));
+        }
+        break;
+    case SNAPSHOT_FORMAT::MODULUS_FLOAT16:
+        for (Eigen::Index k = 0; k < N; k++)
+        {
+            uint16_t half = float_to_half(std::abs(psi(k)));
+            std::memcpy(payload + k*sizeof(uint16_t), &half, sizeof(uint16_t));
+        }
+        break;
+    case SNAPSHOT_FORMAT::MODULUS_UINT8:
+    {
+        const float scale = (frame_header.max_modulus > 0.f)? 255.f/frame_header.max_modulus : 0.f;
+        for (Eigen::Index k = 0; k < N; k++)
+        {
+            payload[k] = static_cast<char>(static_cast<uint8_t>(std::lround(scale*std::abs(psi(k)))));
+        }
+        break;
+    }
+    }
+}
+
+
+SnapshotReader::SnapshotReader(const std::string& path)
+    : m_file{path, ACCESS_PATTERN::SEQUENTIAL}, m_data{m_file.data()}
+{
+    if (m_file.size() < sizeof(SnapshotHeader))
+    {
+        throw std::runtime_error("'" + path + "' is too short to be a snapshot file");
+    }
+    std::memcpy(&m_header, m_data, sizeof(SnapshotHeader));
+    const size_t N = (m_header.Nx-2)*(m_header.Ny-2);
+    if (std::memcmp(m_header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 || m_header.version != SNAPSHOT_VERSION
+        || m_header.Nx < 3 || m_header.Ny < 3 || m_header.frame_bytes != sizeof(FrameHeader) + get_payload_bytes(m_header.format, N))
+    {
+        throw std::runtime_error("'" + path + "' is not a version " + std::to_string(SNAPSHOT_VERSION) + " snapshot file");
+    }
+    if (m_header.obstacle_spans > (m_file.size() - sizeof(SnapshotHeader))/sizeof(MaskSpan))
+    {
+        throw std::runtime_error("'" + path + "' is truncated");
+    }
+    m_obstacle_spans.resize(m_header.obstacle_spans);
+    std::memcpy(m_obstacle_spans.data(), m_data + sizeof(SnapshotHeader), m_obstacle_spans.size()*sizeof(MaskSpan));
+    for (const MaskSpan& span : m_obstacle_spans)
+    {
+        if (uint64_t{span.begin} + span.length > m_header.Nx*m_header.Ny)
+        {
+            throw std::runtime_error("'" + path + "' has an obstacle outside of the grid");
+        }
+    }
+    const size_t frames_offset = sizeof(SnapshotHeader) + m_obstacle_spans.size()*sizeof(MaskSpan);
+    m_data       += frames_offset;
+    m_frame_count = (m_file.size() - frames_offset)/m_header.frame_bytes;
+}
+auto SnapshotReader::get_obstacle() const -> ObstacleMask
+{
+    std::vector<uint8_t> cells(m_header.Nx*m_header.Ny, 0);
+    for (const MaskSpan& span : m_obstacle_spans)
+    {
+        std::fill_n(cells.begin() + span.begin, span.length, uint8_t{1});
+    }
+    return ObstacleMask{m_header.Nx, m_header.Ny, cells};
+}
+auto SnapshotReader::get_frame_header(size_t frame) const -> FrameHeader
+{
+    FrameHeader frame_header{};
+    std::memcpy(&frame_header, m_data + frame*m_header.frame_bytes, sizeof(FrameHeader));
+    return frame_header;
+}
+auto SnapshotReader::get_payload(size_t frame) const -> const std::byte*
+{
+    return m_data + frame*m_header.frame_bytes + sizeof(FrameHeader);
+}
+float SnapshotReader::get_modulus(size_t frame, size_t k) const
+{
+    const std::byte* payload = get_payload(frame);
+    switch (m_header.format)
+    {
+    case SNAPSHOT_FORMAT::COMPLEX_FLOAT32:
+    {
+        std::complex<float> z{};
+        std::memcpy(&z, payload + k*sizeof(std::complex<float>), sizeof(std::complex<float>));
+        return std::abs(z);
+    }
+    case SNAPSHOT_FORMAT::MODULUS_FLOAT32:
+    {
+        float modulus{};
+        std::memcpy(&modulus, payload + k*sizeof(float), sizeof(float));
+        return modulus;
+    }
+    case SNAPSHOT_FORMAT::MODULUS_FLOAT16:
+    {
+        uint16_t half{};
+        std::memcpy(&half, payload + k*sizeof(uint16_t), sizeof(uint16_t));
+        return half_to_float(half);
+    }
+    case SNAPSHOT_FORMAT::MODULUS_UINT8:
+        return static_cast<float>(static_cast<uint8_t>(payload[k]))*get_frame_header(frame).max_modulus/255.f;
+    }
+    return 0.f;
+}
+auto SnapshotReader::decode_modulus(size_t frame, std::span<float> scratch) const -> std::span<const float>
+{
+    const std::byte* payload = get_payload(frame);
+    const size_t N = (m_header.Nx-2)*(m_header.Ny-2);
+    switch (m_header.format)
+    {
+    case SNAPSHOT_FORMAT::MODULUS_FLOAT32:
+        // the headers and the mask spans are multiples of 8 bytes: the payload is float aligned in the mapping
+        return {reinterpret_cast<const float*>(payload), N};
+    case SNAPSHOT_FORMAT::MODULUS_UINT8:
+    {
+        const float scale = get_frame_header(frame).max_modulus/255.f;
+        for (size_t k = 0; k < N; k++)
+            scratch[k] = scale*static_cast<float>(static_cast<uint8_t>(payload[k]));
+        break;
+    }
+    default:
+        for (size_t k = 0; k < N; k++)
+            scratch[k] = get_modulus(frame, k);
+        break;
+    }
+    return scratch.first(N);
+}
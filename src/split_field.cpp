@@ -0,0 +1,87 @@
+#include "split_field.hpp"
+#include <algorithm>
+#include <cmath>
+
+// values of a SIMD packet, as aligned by Eigen
+template<typename Scalar>
+constexpr Eigen::Index PACKET_VALUES = std::max<Eigen::Index>(EIGEN_MAX_ALIGN_BYTES, 16)/sizeof(Real<Scalar>);
+
+template<typename Scalar>
+SplitField<Scalar>::SplitField(size_t Nx, size_t Ny)
+    : m_rows{static_cast<Eigen::Index>(Ny-2)}, m_cols{static_cast<Eigen::Index>(Nx-2)}
+{
+    constexpr Eigen::Index packet = PACKET_VALUES<Scalar>;
+    m_stride = (m_rows + 1 + packet - 1)/packet*packet;
+    m_real = VectorX<Real<Scalar>>::Zero((m_cols+2)*m_stride);
+    m_imag = VectorX<Real<Scalar>>::Zero((m_cols+2)*m_stride);
+}
+template<typename Scalar>
+void SplitField<Scalar>::assign(const VectorX<Scalar>& psi)
+{
+    const Eigen::Index rows = m_rows;
+    const Eigen::Index cols = m_cols;
+    const Real<Scalar>* raw = reinterpret_cast<const Real<Scalar>*>(psi.data());
+
+    #pragma omp parallel for schedule(static)
+    for (Eigen::Index jx = 0; jx < cols; jx++)
+    {
+        const Real<Scalar>* src = raw + 2*jx*rows;
+        Real<Scalar>* re = real(jx);
+        Real<Scalar>* im = imag(jx);
+        #pragma omp simd
+        for (Eigen::Index iy = 0; iy < rows; iy++)
+        {
+            re[iy] = src[2*iy];
+            im[iy] = src[2*iy+1];
+        }
+    }
+}
+template<typename Scalar>
+void SplitField<Scalar>::store(VectorX<Scalar>& psi) const
+{
+    const Eigen::Index rows = m_rows;
+    const Eigen::Index cols = m_cols;
+    psi.resize(rows*cols);
+    Real<Scalar>* raw = reinterpret_cast<Real<Scalar>*>(psi.data());
+
+    #pragma omp parallel for schedule(static)
+    for (Eigen::Index jx = 0; jx < cols; jx++)
+    {
+        Real<Scalar>* dst = raw + 2*jx*rows;
+        const Real<Scalar>* re = real(jx);
+        const Real<Scalar>* im = imag(jx);
+        #pragma omp simd
+        for (Eigen::Index iy = 0; iy < rows; iy++)
+        {
+            dst[2*iy]   = re[iy];
+            dst[2*iy+1] = im[iy];
+        }
+    }
+}
+template<typename Scalar>
+auto SplitField<Scalar>::reduce_modulus(float* modulus) const -> FieldSummary
+{
+    // As SchodingerEquation::observe(): the norm summed in the precision of psi within a column, in double across columns
+    using Real = Real<Scalar>;
+    const Eigen::Index rows = m_rows;
+    const Eigen::Index cols = m_cols;
+    float vmax{};
+    double norm{};
+
+    // Eigen's packet sqrt: a loop over std::sqrt is not vectorized, for its errno branch
+    #pragma omp parallel for schedule(static) reduction(max:vmax) reduction(+:norm)
+    for (Eigen::Index jx = 0; jx < cols; jx++)
+    {
+        Eigen::Map<const Eigen::Array<Real, Eigen::Dynamic, 1>, Eigen::Aligned> re(real(jx), rows);
+        Eigen::Map<const Eigen::Array<Real, Eigen::Dynamic, 1>, Eigen::Aligned> im(imag(jx), rows);
+        Eigen::Map<Eigen::ArrayXf> column(modulus + jx*rows, rows);
+        // the modulus is only kept in float: the root is taken in float whatever the precision of psi
+        column = (re.square() + im.square()).template cast<float>().sqrt();
+        vmax   = std::max(vmax, column.maxCoeff());
+        norm  += (re.square() + im.square()).sum();
+    }
+    return FieldSummary{.max_modulus = vmax, .norm = norm};
+}
+
+template class SplitField<std::complex<float>>;
+template class SplitField<std::complex<double>>;
@@ -0,0 +1,203 @@
+#include "split_operator_stepper.hpp"
+#include <numbers>
+#include <bit>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// KissFFT butterflies of a prime factor p cost O(p) per value: past this factor Bluestein's convolution is cheaper
+constexpr size_t MAX_DIRECT_FACTOR = 13;
+
+namespace
+{
+    auto get_thread_index() -> size_t
+    {
+#ifdef _OPENMP
+        return static_cast<size_t>(omp_get_thread_num());
+#else
+        return 0;
+#endif
+    }
+    auto get_thread_count() -> size_t
+    {
+#ifdef _OPENMP
+        return static_cast<size_t>(omp_get_max_threads());
+#else
+        return 1;
+#endif
+    }
+    auto get_smooth_length(size_t m) -> size_t      // smallest 2^a 3^b 5^c >= m, the lengths KissFFT does best
+    {
+        size_t best = std::bit_ceil(m);
+        for (size_t p5 = 1; p5 < best; p5 *= 5)
+            for (size_t p35 = p5; p35 < best; p35 *= 3)
+                best = std::min(best, p35*std::bit_ceil((m + p35 - 1)/p35));
+        return best;
+    }
+    auto get_largest_prime_factor(size_t m) -> size_t
+    {
+        size_t largest = 1;
+        for (size_t p = 2; p*p <= m; p++)
+        {
+            for (; m % p == 0; m /= p)
+                largest = p;
+        }
+        return std::max(largest, m);
+    }
+    // eigenvalues of -D/d^2 on n interior points with Dirichlet walls, k = 1..n
+    auto get_eigenvalue(size_t k, size_t n, double d) -> double
+    {
+        const double s = std::sin(std::numbers::pi*k/(2.0*(n+1)));
+        return 4.0*s*s/(d*d);
+    }
+}
+
+template<typename Scalar>
+SplitOperatorStepper<Scalar>::SplitOperatorStepper(size_t Nx, size_t Ny, Real<Scalar> dx, Real<Scalar> dy, Real<Scalar> dt)
+    : m_rows{Ny-2}, m_cols{Nx-2}, m_x_line{make_line_transform(Nx-2)}, m_y_line{make_line_transform(Ny-2)}
+{
+    // Phases computed in double, dt mu reaching tens of radians at the top of the spectrum for a large dt.
+    // Both line transforms of a direction multiply by (-2i)^2 (n+1)/2 = -2(n+1), undone here once for all.
+    const double scale = 1.0/(4.0*(m_cols+1)*(m_rows+1));
+    m_phase.resize(m_cols, m_rows);
+    for (size_t ky = 0; ky < m_rows; ky++)
+    {
+        const double mu_y = get_eigenvalue(ky+1, m_rows, dy);
+        for (size_t kx = 0; kx < m_cols; kx++)
+        {
+            const double mu = get_eigenvalue(kx+1, m_cols, dx) + mu_y;
+            m_phase(kx, ky) = static_cast<Scalar>(std::polar(scale, -static_cast<double>(dt)*mu));
+        }
+    }
+    m_transposed.resize(m_cols, m_rows);
+}
+template<typename Scalar>
+void SplitOperatorStepper<Scalar>::set_absorption(const VectorX<Scalar>& potential, Real<Scalar> dt)
+{
+    m_damping = (-dt*potential.real()).array().exp().template cast<Scalar>();
+}
+template<typename Scalar>
+void SplitOperatorStepper<Scalar>::step(VectorX<Scalar>& psi)
+{
+    propagate(psi.data());
+}
+template<typename Scalar>
+void SplitOperatorStepper<Scalar>::step_batch(Eigen::Map<MatrixX<Scalar>> psi)
+{
+    // Packets are contiguous columns, propagated in place one after the other
+    for (Eigen::Index k = 0; k < psi.cols(); k++)
+    {
+        propagate(psi.col(k).data());
+    }
+}
+template<typename Scalar>
+auto SplitOperatorStepper<Scalar>::make_line_transform(size_t n) -> LineTransform
+{
+    LineTransform transform{.n = n};
+    const size_t length = 2*(n+1);
+    if (get_largest_prime_factor(length) <= MAX_DIRECT_FACTOR)
+        return transform;
+
+    // X_k = c_k sum_j (x_j c_j) conj(c_{k-j}), c_j = exp(-i pi j^2/M): a convolution, circular once padded to P >= 2M-1,
+    // P having no factor but 2, 3 and 5.
+    // j^2 is reduced modulo 2M before the division, c_j being 2M periodic in j^2, to keep the angles accurate.
+    transform.padded = get_smooth_length(2*length - 1);
+    transform.chirp.resize(length);
+    std::vector<Scalar> filter(transform.padded, Scalar{});
+    for (size_t j = 0; j < length; j++)
+    {
+        const double angle = std::numbers::pi*static_cast<double>((j*j) % (2*length))/length;
+        transform.chirp[j] = static_cast<Scalar>(std::polar(1.0, -angle));
+        filter[j] = std::conj(transform.chirp[j]);
+        if (j > 0)
+            filter[transform.padded - j] = filter[j];
+    }
+    transform.filter_spectrum.resize(transform.padded);
+    Eigen::FFT<Real<Scalar>> fft{};
+    fft.fwd(transform.filter_spectrum.data(), filter.data(), static_cast<Eigen::Index>(transform.padded));
+    return transform;
+}
+template<typename Scalar>
+void SplitOperatorStepper<Scalar>::sine_transform(Workspace& workspace, const LineTransform& transform, Scalar* line)
+{
+    // FFT of the odd extension (0, x1..xn, 0, -xn..-x1): X_k = -2i sum_j x_j sin(pi j k/(n+1))
+    const size_t n      = transform.n;
+    const size_t length = 2*(n+1);
+    const size_t size   = std::max(length, transform.padded);
+    workspace.extended.assign(size, Scalar{});
+    workspace.spectrum.resize(size);
+    Scalar* extended = workspace.extended.data();
+    Scalar* spectrum = workspace.spectrum.data();
+    if (transform.padded == 0)
+    {
+        for (size_t j = 1; j <= n; j++)
+        {
+            extended[j]        =  line[j-1];
+            extended[length-j] = -line[j-1];
+        }
+        workspace.fft.fwd(spectrum, extended, static_cast<Eigen::Index>(length));
+        for (size_t k = 1; k <= n; k++)
+        {
+            line[k-1] = spectrum[k];
+        }
+        return;
+    }
+
+    const Scalar* chirp = transform.chirp.data();
+    const Eigen::Index padded = transform.padded;
+    for (size_t j = 1; j <= n; j++)
+    {
+        extended[j]        =  chirp[j]*line[j-1];
+        extended[length-j] = -chirp[length-j]*line[j-1];
+    }
+    workspace.fft.fwd(spectrum, extended, padded);
+    for (Eigen::Index k = 0; k < padded; k++)
+    {
+        spectrum[k] *= transform.filter_spectrum[k];
+    }
+    workspace.fft.inv(extended, spectrum, padded);     // scaled by 1/P
+    for (size_t k = 1; k <= n; k++)
+    {
+        line[k-1] = chirp[k]*extended[k];
+    }
+}
+template<typename Scalar>
+void SplitOperatorStepper<Scalar>::propagate(Scalar* psi)
+{
+    // y lines are the columns of psi; x lines are made contiguous by a transposition, transformed, multiplied
+    // by the phases and transformed back while in cache, then transposed back for the inverse y transform.
+    const Eigen::Index rows = m_rows;
+    const Eigen::Index cols = m_cols;
+    if (m_workspaces.size() < get_thread_count())
+    {
+        m_workspaces.resize(get_thread_count());
+    }
+    Eigen::Map<MatrixX<Scalar>> grid(psi, rows, cols);
+
+    #pragma omp parallel for schedule(static)
+    for (Eigen::Index jx = 0; jx < cols; jx++)
+    {
+        sine_transform(m_workspaces[get_thread_index()], m_y_line, psi + jx*rows);
+    }
+    #pragma omp parallel for schedule(static)
+    for (Eigen::Index iy = 0; iy < rows; iy++)
+    {
+        Workspace& workspace = m_workspaces[get_thread_index()];
+        m_transposed.col(iy) = grid.row(iy).transpose();
+        Scalar* line = m_transposed.col(iy).data();
+        sine_transform(workspace, m_x_line, line);
+        m_transposed.col(iy).array() *= m_phase.col(iy).array();
+        sine_transform(workspace, m_x_line, line);
+    }
+    #pragma omp parallel for schedule(static)
+    for (Eigen::Index jx = 0; jx < cols; jx++)
+    {
+        grid.col(jx) = m_transposed.row(jx).transpose();
+        sine_transform(m_workspaces[get_thread_index()], m_y_line, psi + jx*rows);
+        if (m_damping.size() != 0)
+            grid.col(jx).array() *= m_damping.segment(jx*rows, rows).array();
+    }
+}
+
+template class SplitOperatorStepper<std::complex<float>>;
+template class SplitOperatorStepper<std::complex<double>>;
@@ -0,0 +1,131 @@
+#include "stencil_operator.hpp"
+#include <stdexcept>
+#include <string>
+
+template<typename Scalar>
+StencilOperator<Scalar>::StencilOperator(size_t Nx, size_t Ny, Scalar diag, Scalar rx, Scalar ry)
+    : m_rows{static_cast<Eigen::Index>(Ny-2)}, m_cols{static_cast<Eigen::Index>(Nx-2)}, m_diag{diag}, m_rx{rx}, m_ry{ry}
+{
+}
+template<typename Scalar>
+void StencilOperator<Scalar>::set_absorption(const VectorX<Scalar>& absorption, size_t layer)
+{
+    if (static_cast<size_t>(absorption.size()) != size())
+    {
+        throw std::invalid_argument("absorption of " + std::to_string(absorption.size()) + " cells for " + std::to_string(size()) + " unknowns");
+    }
+    m_absorption = absorption;
+    m_layer      = static_cast<Eigen::Index>(layer);
+}
+template<typename Scalar>
+void StencilOperator<Scalar>::apply(const VectorX<Scalar>& in, VectorX<Scalar>& out) const
+{
+    out.resize(m_rows*m_cols);
+    apply(in.data(), out.data());
+}
+template<typename Scalar>
+void StencilOperator<Scalar>::apply(const Scalar* in, Scalar* out) const
+{
+    const Eigen::Index rows = m_rows;
+    const Eigen::Index cols = m_cols;
+    Eigen::Map<const MatrixX<Scalar>> src(in,  rows, cols);
+    Eigen::Map<MatrixX<Scalar>>       dst(out, rows, cols);
+    Eigen::Map<const MatrixX<Scalar>> absorption(m_absorption.data(), m_absorption.size()? rows : 0, m_absorption.size()? cols : 0);
+    const Eigen::Index layer = m_absorption.size()? m_layer : 0;
+
+    #pragma omp parallel for schedule(static)
+    for (Eigen::Index jx = 0; jx < cols; jx++)
+    {
+        // (x,y) -> (x,y) and (x,y+-1): a single fused pass over the interior of the column
+        if (rows == 1)
+        {
+            dst.col(jx) = m_diag*src.col(jx);   // Ny = 3: both y neighbours are on the boundary
+        }
+        else
+        {
+            dst.col(jx).segment(1, rows-2) = m_diag*src.col(jx).segment(1, rows-2)
+                                           + m_ry*(src.col(jx).segment(0, rows-2) + src.col(jx).segment(2, rows-2));
+            dst(0,      jx) = m_diag*src(0,      jx) + m_ry*src(1,      jx);
+            dst(rows-1, jx) = m_diag*src(rows-1, jx) + m_ry*src(rows-2, jx);
+        }
+
+        // (x,y) -> (x+-1,y)
+        if (jx != 0)
+            dst.col(jx) += m_rx*src.col(jx-1);
+        if (jx != cols-1)
+            dst.col(jx) += m_rx*src.col(jx+1);
+
+        if (layer == 0)
+            continue;
+        if (jx < layer || jx >= cols - layer || 2*layer >= rows)
+        {
+            dst.col(jx) -= absorption.col(jx).cwiseProduct(src.col(jx));
+            continue;
+        }
+        dst.col(jx).head(layer) -= absorption.col(jx).head(layer).cwiseProduct(src.col(jx).head(layer));
+        dst.col(jx).tail(layer) -= absorption.col(jx).tail(layer).cwiseProduct(src.col(jx).tail(layer));
+    }
+}
+template<typename Scalar>
+void StencilOperator<Scalar>::apply(const SplitField<Scalar>& in, SplitField<Scalar>& out) const
+{
+    using Real = Real<Scalar>;
+    const Eigen::Index rows = m_rows;
+    const Eigen::Index cols = m_cols;
+    if (in.get_rows() != rows || in.get_cols() != cols || out.get_rows() != rows || out.get_cols() != cols)
+    {
+        throw std::invalid_argument("split field of " + std::to_string(in.size()) + " cells for " + std::to_string(size()) + " unknowns");
+    }
+    const Real dr  = m_diag.real(), di  = m_diag.imag();
+    const Real rxr = m_rx.real(),   rxi = m_rx.imag();
+    const Real ryr = m_ry.real(),   ryi = m_ry.imag();
+    const Eigen::Index layer = m_absorption.size()? m_layer : 0;
+
+    #pragma omp parallel for schedule(static)
+    for (Eigen::Index jx = 0; jx < cols; jx++)
+    {
+        const Real* cr = in.real(jx);
+        const Real* ci = in.imag(jx);
+        const Real* lr = in.real(jx-1);
+        const Real* li = in.imag(jx-1);
+        const Real* rr = in.real(jx+1);
+        const Real* ri = in.imag(jx+1);
+        Real* out_r = out.real(jx);
+        Real* out_i = out.imag(jx);
+
+        // rows -1 and rows are the zero padding of the neighbouring columns: no edge case
+        #pragma omp simd
+        for (Eigen::Index iy = 0; iy < rows; iy++)
+        {
+            const Real yr = cr[iy-1] + cr[iy+1];
+            const Real yi = ci[iy-1] + ci[iy+1];
+            const Real xr = lr[iy] + rr[iy];
+            const Real xi = li[iy] + ri[iy];
+            out_r[iy] = dr*cr[iy] - di*ci[iy] + ryr*yr - ryi*yi + rxr*xr - rxi*xi;
+            out_i[iy] = dr*ci[iy] + di*cr[iy] + ryr*yi + ryi*yr + rxr*xi + rxi*xr;
+        }
+
+        if (layer == 0)
+            continue;
+        const Scalar* absorption = m_absorption.data() + jx*rows;
+        auto absorb = [&](Eigen::Index begin, Eigen::Index end)
+        {
+            for (Eigen::Index iy = begin; iy < end; iy++)
+            {
+                const Scalar a = absorption[iy]*Scalar{cr[iy], ci[iy]};
+                out_r[iy] -= a.real();
+                out_i[iy] -= a.imag();
+            }
+        };
+        if (jx < layer || jx >= cols - layer || 2*layer >= rows)
+        {
+            absorb(0, rows);
+            continue;
+        }
+        absorb(0, layer);
+        absorb(rows - layer, rows);
+    }
+}
+
+template class StencilOperator<std::complex<float>>;
+template class StencilOperator<std::complex<double>>;
@@ -0,0 +1,283 @@
+#include <iostream>
+#include <print>
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+#include "crank_nicolson_builder.hpp"
+#include "gaussian_wavefunction_builder.hpp"
+#include "schrodinger_equation_builder.hpp"
+#include "schrodinger_equation.hpp"
+#include "simulation_config.hpp"
+#include "operator_pool.hpp"
+#include "work_stealing_pool.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Parameter sweep: every combination of the listed values, each case run headless to completion,
+// the cases spread over a work-stealing pool of all the cores.
+// Usage: double_slit_sweep [--threads N] [--results sweep.csv] [--key value | --key v1,v2,...]...
+// A comma separated value makes its key an axis of the sweep, e.g.
+//      --slit_width 0.1,0.18,0.25 --slit_opening 0.03,0.04 --wave_number 40,47,54 --steps 500
+// every other pair applies to all the cases, as for the headless runner (wave_numbers, a batch per case, included).
+// Cases with the same operator (grid, engine, solver, eliminated obstacle) share a single factorization,
+// the barrier itself being no part of the operator unless it is eliminated.
+// The results file has one row per case and packet: the axis values, timings and final observables.
+
+struct SweepAxis
+{
+    std::string key{};
+    std::vector<std::string> values{};
+};
+
+struct SweepCase
+{
+    std::vector<std::string> values{};  // one per axis
+    SimulationConfig config{};
+};
+
+struct PacketResult
+{
+    float wave_number{};
+    float max_modulus{};
+    double norm{};
+    double norm_drift{};
+};
+
+struct CaseResult
+{
+    double setup_s{};
+    double run_s{};
+    std::vector<PacketResult> packets{};
+    std::string error{};
+};
+
+auto split_list(const std::string& value) -> std::vector<std::string>
+{
+    std::vector<std::string> items{};
+    size_t begin = 0;
+    while (begin <= value.size())
+    {
+        size_t end = std::min(value.find(',', begin), value.size());
+        items.push_back(value.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return items;
+}
+
+// Body of a quoted CSV field: quotes doubled, line breaks turned into spaces so that a row stays on one line
+auto escape_csv(const std::string& value) -> std::string
+{
+    std::string escaped{};
+    escaped.reserve(value.size());
+    for (char c : value)
+    {
+        if (c == '"')
+            escaped += "\"\"";
+        else if (c == '\n' || c == '\r')
+            escaped += ' ';
+        else
+            escaped += c;
+    }
+    return escaped;
+}
+auto make_cases(const SimulationConfig& base, const std::vector<SweepAxis>& axes) -> std::vector<SweepCase>
+{
+    std::vector<SweepCase> cases{{{}, base}};
+    for (const auto& axis : axes)
+    {
+        std::vector<SweepCase> expanded{};
+        for (const auto& sweep_case : cases)
+        {
+            for (const auto& value : axis.values)
+            {
+                SweepCase next{sweep_case};
+                next.values.push_back(value);
+                next.config.set_option(axis.key, value);
+                expanded.push_back(std::move(next));
+            }
+        }
+        cases = std::move(expanded);
+    }
+    return cases;
+}
+
+template<typename Scalar>
+auto run_case(const SimulationConfig& config, const std::shared_ptr<OperatorPool<Scalar>>& operator_pool) -> CaseResult
+{
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    SchodingerEquationBuilder<Scalar> eq_builder {config.L, config.dr, config.initial_pos(), std::make_unique<CrankNicolsonBuilder<Scalar>>(), std::make_unique<GaussianWfBuilder<Scalar>>()};
+    eq_builder.set_engine(config.engine);
+    if (config.dt != 0.f)
+        eq_builder.set_time_step(config.dt);
+    eq_builder.set_absorbing_layer(config.absorbing_layer);
+    eq_builder.set_activity(config.activity);
+    eq_builder.set_solver_options(config.solver_options);
+    eq_builder.set_operator_cache(config.operator_cache);
+    eq_builder.set_operator_pool(operator_pool);
+    eq_builder.set_wave_number(config.wave_number);
+
+    Interferometer double_slit = build_interferometer(config, eq_builder.get_Nx(), eq_builder.get_Ny());
+    if (config.eliminate_obstacle)
+    {
+        eq_builder.set_obstacle(double_slit.get_mask());
+    }
+    std::vector<WavePacket> packets{};
+    for (float k : config.wave_numbers)
+    {
+        packets.push_back({.position = config.initial_pos(), .wave_number = k});
+    }
+    SchodingerEquation<Scalar> schrodinger{packets.empty()? eq_builder.build_equation() : eq_builder.build_batch(packets)};
+
+    CaseResult result{};
+    result.setup_s = std::chrono::duration<double>(Clock::now() - start).count();
+    start = Clock::now();
+    for (size_t n = 0; n < config.steps; n++)
+    {
+        schrodinger.interact(double_slit);
+        schrodinger.evolve();
+    }
+    result.run_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    for (size_t packet = 0; packet < schrodinger.get_packet_count(); packet++)
+    {
+        const Observables& observables = schrodinger.observe(packet);
+        const float k = packets.empty()? config.wave_number : config.wave_numbers[packet];
+        result.packets.push_back({k, observables.max_modulus, observables.norm, observables.norm_drift});
+    }
+    return result;
+}
+
+void write_results(std::FILE* out, const std::vector<SweepAxis>& axes, const std::vector<SweepCase>& cases, const std::vector<CaseResult>& results)
+{
+    std::print(out, "case,");
+    for (const auto& axis : axes)
+        std::print(out, "{},", axis.key);
+    std::println(out, "packet,wave_number,setup_s,run_s,steps_per_s,max_modulus,norm,norm_drift,error");
+
+    for (size_t c = 0; c < cases.size(); c++)
+    {
+        const CaseResult& result = results[c];
+        auto print_case = [&]
+        {
+            std::print(out, "{},", c);
+            for (const auto& value : cases[c].values)
+                std::print(out, "{},", value);
+        };
+        if (!result.error.empty())
+        {
+            print_case();
+            std::println(out, ",,,,,,,,\"{}\"", escape_csv(result.error));
+            continue;
+        }
+        for (size_t packet = 0; packet < result.packets.size(); packet++)
+        {
+            const PacketResult& p = result.packets[packet];
+            print_case();
+            std::println(out, "{},{:.4f},{:.4f},{:.4f},{:.1f},{:.6f},{:.6e},{:.3e},", packet, p.wave_number, result.setup_s, result.run_s,
+                         cases[c].config.steps/result.run_s, p.max_modulus, p.norm, p.norm_drift);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    SimulationConfig base{};
+    std::vector<SweepAxis> axes{};
+    std::vector<SweepCase> cases{};
+    size_t threads = std::thread::hardware_concurrency();
+    std::string results_path{"sweep.csv"};
+    try
+    {
+        for (int i = 1; i < argc; i += 2)
+        {
+            std::string key{argv[i]};
+            if (!key.starts_with("--") || i + 1 >= argc)
+            {
+                throw std::invalid_argument("expected '--key value' pairs, got '" + key + "'");
+            }
+            key = key.substr(2);
+            std::string value{argv[i+1]};
+            if      (key == "threads")  threads      = std::stoul(value);
+            else if (key == "results")  results_path = value;
+            else if (value.find(',') != std::string::npos && key != "wave_numbers")
+                axes.push_back({key, split_list(value)});
+            else
+                base.set_option(key, value);
+        }
+        cases = make_cases(base, axes);
+    }
+    catch(const std::exception& e)
+    {
+        std::println("Invalid parameters: {}", e.what());
+        return EXIT_FAILURE;
+    }
+
+    // Dealt in increasing cost: each worker starts on the largest of its cases, and what the others steal
+    // from the front of its queue are the small ones, which even out the end of the sweep.
+    std::vector<size_t> order(cases.size());
+    for (size_t c = 0; c < cases.size(); c++)
+        order[c] = c;
+    auto cost = [&](size_t c)
+    {
+        const SimulationConfig& config = cases[c].config;
+        return config.L.x/config.dr.x * config.L.y/config.dr.y * config.steps * std::max<size_t>(config.wave_numbers.size(), 1);
+    };
+    std::ranges::stable_sort(order, {}, cost);
+
+    flush_denormals();      // inherited by the worker threads
+    start_profiling(base);
+    WorkStealingPool pool{threads};
+    auto single_pool = std::make_shared<OperatorPool<std::complex<float>>>();
+    auto double_pool = std::make_shared<OperatorPool<std::complex<double>>>();
+    std::vector<CaseResult> results(cases.size());
+    std::vector<WorkStealingPool::Task> tasks{};
+    for (size_t c : order)
+    {
+        tasks.push_back([&, c]
+        {
+#ifdef _OPENMP
+            if (pool.get_thread_count() > 1)
+                omp_set_num_threads(1);     // the cases are the parallelism, no OpenMP team per worker
+#endif
+            const SimulationConfig& config = cases[c].config;
+            try
+            {
+                results[c] = (config.precision == PRECISION::DOUBLE)? run_case<std::complex<double>>(config, double_pool)
+                                                                     : run_case<std::complex<float>>(config, single_pool);
+                std::println("Case {} done: setup {:.2f}s, {} steps in {:.2f}s.", c, results[c].setup_s, config.steps, results[c].run_s);
+            }
+            catch(const std::exception& e)
+            {
+                results[c].error = e.what();
+                std::println("Case {} failed: {}", c, e.what());
+            }
+        });
+    }
+
+    std::println("Sweep: {} cases over {} axes, {} threads.", cases.size(), axes.size(), pool.get_thread_count());
+    auto start = std::chrono::steady_clock::now();
+    pool.run(std::move(tasks));
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double busy{};
+    for (const auto& result : results)
+        busy += result.setup_s + result.run_s;
+    std::println("Elapsed: {:.2f}s, {:.2f}s of cases, {:.0f}% of {} threads busy, {} steals.", elapsed.count(), busy,
+                 100.0*busy/(elapsed.count()*pool.get_thread_count()), pool.get_thread_count(), pool.get_steals());
+    std::println("Operators: {} set up, {} reused.", single_pool->get_setups() + double_pool->get_setups(), single_pool->get_reuses() + double_pool->get_reuses());
+
+    write_profile(base);
+
+    std::FILE* out = std::fopen(results_path.c_str(), "w");
+    if (!out)
+    {
+        std::println("Cannot open '{}' for writing", results_path);
+        return EXIT_FAILURE;
+    }
+    write_results(out, axes, cases, results);
+    std::fclose(out);
+    std::println("Results written to {}.", results_path);
+    return EXIT_SUCCESS;
+}
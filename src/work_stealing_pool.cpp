@@ -0,0 +1,73 @@
+#include "work_stealing_pool.hpp"
+#include <exception>
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(size_t threads)
+    : m_thread_count{std::max<size_t>(threads, 1)}, m_queues(m_thread_count)
+{
+}
+void WorkStealingPool::run(std::vector<Task> tasks)
+{
+    for (size_t k = 0; k < tasks.size(); k++)
+    {
+        m_queues[k % m_thread_count].tasks.push_back(std::move(tasks[k]));
+    }
+
+    // No task is added once the workers start: a worker finding every queue empty is done
+    std::mutex error_mutex{};
+    std::exception_ptr error{};
+    auto work = [&](size_t worker)
+    {
+        Task task{};
+        while (pop(worker, task) || steal(worker, task))
+        {
+            try
+            {
+                task();
+            }
+            catch(...)
+            {
+                std::lock_guard lock{error_mutex};
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+    };
+    {
+        std::vector<std::jthread> threads{};
+        for (size_t worker = 1; worker < m_thread_count; worker++)
+        {
+            threads.emplace_back(work, worker);
+        }
+        work(0);
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+bool WorkStealingPool::pop(size_t worker, Task& task)
+{
+    Queue& queue = m_queues[worker];
+    std::lock_guard lock{queue.mutex};
+    if (queue.tasks.empty())
+        return false;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+bool WorkStealingPool::steal(size_t thief, Task& task)
+{
+    for (size_t offset = 1; offset < m_thread_count; offset++)
+    {
+        Queue& victim = m_queues[(thief + offset) % m_thread_count];
+        std::lock_guard lock{victim.mutex};
+        if (victim.tasks.empty())
+            continue;
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        m_steals++;
+        return true;
+    }
+    return false;
+}
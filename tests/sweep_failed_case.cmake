@@ -0,0 +1,22 @@
+# A case that fails to set up is a row of the results, the other cases of the sweep still run.
+# cmake -DSWEEP=<double_slit_sweep> -DRESULTS=<csv> -P sweep_failed_case.cmake
+# The ADI engine has no absorbing layer: case 0 fails, case 1 (Crank-Nicolson) runs.
+execute_process(COMMAND ${SWEEP} --threads 2 --results ${RESULTS} --Lx 1.2 --Ly 0.8 --steps 5 --absorbing_layer 4 --engine adi,cn
+                RESULT_VARIABLE status)
+if(NOT status EQUAL 0)
+    message(FATAL_ERROR "the sweep exited with ${status}")
+endif()
+
+file(STRINGS ${RESULTS} rows)
+list(LENGTH rows row_count)
+if(NOT row_count EQUAL 3)
+    message(FATAL_ERROR "expected a header and 2 rows, got ${row_count} lines")
+endif()
+list(GET rows 1 failed)
+list(GET rows 2 done)
+if(NOT failed MATCHES "^0,adi,,,,,,,,,\".*absorbing layer.*\"$")
+    message(FATAL_ERROR "case 0 is not a failed row: ${failed}")
+endif()
+if(NOT done MATCHES "^1,cn,0,[0-9.]+,.*,$")
+    message(FATAL_ERROR "case 1 is not a result row: ${done}")
+endif()